@@ -3,10 +3,16 @@
 #include <cstddef>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <limits>
 
+#include "consts.h"
+#include "utils/interleave.h"
+#include "utils/status.h"
+
 /* Block
 ----------------------------------------------------------------------------------------------------
 |             Data Section             |              Offset Section | Extra |
@@ -14,12 +20,15 @@
 | Entry #1 | Entry #2 | ... | Entry #N | Offset #1 | Offset #2 | ... | Offset
 #N| num_of_elements |
 ----------------------------------------------------------------------------------------------------
+v1 格式中 Offset 和 num_of_elements 均为 16 位, Block 不能超过 64KB;
+v2 格式中二者均为 32 位。
 
 -----------------------------------------------------------------------
 |                           Entry #1                            | ... |
 -----------------------------------------------------------------------
 | key_len (2B) | key (keylen) | value_len (2B) | value (varlen) | ... |
 -----------------------------------------------------------------------
+v3 格式中 value_len 为 4 字节，v1/v2 中 value 不能超过 64KB。
 */
 
 class BlockIterator;
@@ -29,30 +38,54 @@ class BlockIterator;
 class Block : public std::enable_shared_from_this<Block> {
  public:
   Block() : capacity_(std::numeric_limits<size_t>::max()) {}
-  explicit Block(size_t capacity);
+  // format_version 决定 entry 中 value_len 的宽度，Encode 时须使用同样
+  // value_len 宽度的格式。
+  explicit Block(size_t capacity, uint32_t format_version = kFormatV1);
 
-  // 不包括hash
-  std::vector<uint8_t> Encode() const;
+  // 不包括hash，默认按 v1 格式编码；v1 下偏移超出 16 位会抛出异常。
+  std::vector<uint8_t> Encode(uint32_t format_version = kFormatV1) const;
 
   // 解码一个编码后的 Block。如果 with_hash 为 true，表示编码末尾附带
   // 了 4 字节的 hash，需要在解码时做校验并剥离。
   static std::shared_ptr<Block> Decode(const std::vector<uint8_t>& encoded);
 
   static std::shared_ptr<Block> Decode(const std::vector<uint8_t>& encoded,
-                                       bool with_hash);
+                                       bool with_hash,
+                                       uint32_t format_version = kFormatV1);
 
   std::string GetFirstKey() const;
 
   // 获取idx索引位置的entry在data_中的偏移
   size_t GetOffsetAt(size_t idx) const;
 
+  // 追加一条记录，block 已满时返回 false。key 超过 64KB 或 value 超出
+  // 格式能表示的长度时抛出异常。
   bool AddEntry(const std::string& key, const std::string& value);
 
   std::optional<size_t> GetIdxBinary(const std::string& key) const;
 
+  // 返回第一个 key >= target 的 entry 下标，不存在时返回 entry 个数。
+  size_t LowerBoundIdx(std::string_view target) const;
+
+  // 返回第一个 key > target 的 entry 下标，不存在时返回 entry 个数。
+  size_t UpperBoundIdx(std::string_view target) const;
+
+  // entry 个数
+  size_t num_entries() const { return offsets_.size(); }
+
   std::optional<std::string> GetValueBinary(const std::string& key) const;
 
-  // Block所占字节数(Data Section + Offset Secton + Num elements)
+  // 精确查找 key，命中时写入 value 并返回 OK，不存在时返回 NotFound。
+  Status Get(const std::string& key, std::string* value) const;
+
+  // 批量二分查找：每个 key 的查找是一个协程，比较前先预取 mid 处的 entry
+  // 再让出，多个查找交错执行以隐藏访存延迟。结果与 keys 一一对应。
+  std::vector<std::optional<std::string>> MultiGetValueBinary(
+      std::span<const std::string> keys,
+      size_t group_size = kDefaultInterleaveGroupSize) const;
+
+  // Block所占字节数(Data Section + Offset Secton + Num elements)，
+  // 按偏移更宽的 v2 格式估算，因此用任一格式编码都不会超过该值。
   size_t size() const;
 
   bool IsEmpty() const;
@@ -70,18 +103,24 @@ class Block : public std::enable_shared_from_this<Block> {
 
   Entry GetEntryAt(size_t offset) const;
 
-  // 从data_指定偏移处获取entry的key
-  std::string GetKeyAt(size_t offset) const;
+  // 从data_指定偏移处获取entry的key，返回的视图指向data_，不拷贝
+  std::string_view GetKeyAt(size_t offset) const;
 
-  // 从data_指定偏移处获取entry的value
-  std::string GetValueAt(size_t offset) const;
+  // 从data_指定偏移处获取entry的value，返回的视图指向data_，不拷贝
+  std::string_view GetValueAt(size_t offset) const;
 
   // key_at.compare(target)
-  int CompareKeyAt(size_t offset, const std::string& target) const;
+  int CompareKeyAt(size_t offset, std::string_view target) const;
+
+  // GetValueBinary 的可挂起版本，供 MultiGetValueBinary 交错调度。
+  InterleavedTask<std::optional<std::string>> GetValueInterleaved(
+      const std::string& key) const;
 
   // 上面的 Data Section
   std::vector<uint8_t> data_;
   // Offset Section（N 个 entry 的起始偏移）
-  std::vector<uint16_t> offsets_;
+  std::vector<uint32_t> offsets_;
   size_t capacity_;
+  // entry 中 value_len 的字节数
+  size_t value_len_width_ = sizeof(uint16_t);
 };
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+class Block;
+
+// BlockCache 是按字节容量淘汰的 LRU 缓存，缓存已解码的 Block，
+// 以 (sst_id, block_idx) 为键，多个 SST 可以共享同一个实例，线程安全。
+// 被淘汰的 Block 若仍被迭代器持有，会在最后一个引用释放时才析构。
+class BlockCache {
+ public:
+  explicit BlockCache(size_t capacity);
+
+  // 命中时返回 block 并将其移到 LRU 头部，否则返回 nullptr。
+  std::shared_ptr<Block> Lookup(size_t sst_id, size_t block_idx);
+
+  // 插入或替换一个 block，超出容量时淘汰最久未使用的 block。
+  void Insert(size_t sst_id, size_t block_idx, std::shared_ptr<Block> block);
+
+  // 删除某个 SST 的所有 block，SST 文件被删除时调用。
+  void EraseSst(size_t sst_id);
+
+  size_t capacity() const { return capacity_; }
+  size_t usage() const;
+  size_t hits() const;
+  size_t misses() const;
+
+ private:
+  using Key = std::pair<size_t, size_t>;
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return key.first * 0x9e3779b97f4a7c15ULL ^ key.second;
+    }
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<Block> block;
+    size_t charge;
+  };
+
+  void EvictIfNeeded();
+
+  size_t capacity_;
+  size_t usage_ = 0;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  // 头部为最近使用
+  std::list<Entry> lru_;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+  mutable std::mutex mutex_;
+};
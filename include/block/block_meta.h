@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+#include "consts.h"
+
 /*
  * -------------------------------------------------------------------------------------------
  * |         Block Section         |          Meta Section         | Extra |
@@ -30,6 +32,7 @@
  * --------------------------------------------------------------------------------------------------------------
  * 其中, num_entries 表示 metadata 数组的长度, Hash 是 metadata
  数组的哈希值(只包括数组部分, 不包括 num_entries ), 用于校验 metadata 的完整性
+ * v2 格式中 MetaEntry 的 offset 为 64 位, 其余字段不变。
  */
 
 // Block 信息的元数据描述，用于在 SST 中记录每个数据块的文件偏移和首尾 key，
@@ -68,11 +71,17 @@ class BlockMeta {
 
   // 将一组BlockMeta序列化成字节数组
   static std::vector<uint8_t> EncodeMetasToSlice(
-      std::span<const BlockMeta> meta_entries);
+      std::span<const BlockMeta> meta_entries,
+      uint32_t format_version = kFormatV1);
+
+  // 一组BlockMeta序列化后的字节数(包括 num_entries 和 hash)
+  static size_t EncodedSize(std::span<const BlockMeta> meta_entries,
+                            uint32_t format_version = kFormatV1);
 
   // 从字节数组反序列化出BlockMeta
   static std::vector<BlockMeta> DecodeMetasFromSlice(
-      std::span<const uint8_t> meta_data);
+      std::span<const uint8_t> meta_data,
+      uint32_t format_version = kFormatV1);
 
   // Block在文件中的偏移量
   size_t offset_;
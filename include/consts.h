@@ -1,5 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 constexpr int kMemSizeLimit = 64 * 1024 * 1024; // 64MB
 constexpr int kTableSizeLimit = 4 * 1024 * 1024;
- 
+constexpr size_t kBlockSize = 4096;
+constexpr size_t kBlockCacheCapacity = 64 * 1024 * 1024; // 64MB
+constexpr size_t kWalSegmentSize = 16 * 1024 * 1024; // 16MB
+constexpr size_t kNumLevels = 7;
+
+// 磁盘格式版本。v1: Block 内偏移 16 位、BlockMeta 偏移 32 位、SST 尾部只有
+// 32 位的 meta offset；v2: Block 内偏移 32 位、BlockMeta 偏移 64 位、
+// SST 尾部带 magic number 和版本号；v3: Block entry 的 value_len 为 32 位，
+// value 按 utils/value_encoding.h 编码，更早的版本保存的是原始的值。
+constexpr uint32_t kFormatV1 = 1;
+constexpr uint32_t kFormatV2 = 2;
+constexpr uint32_t kFormatV3 = 3;
+constexpr uint32_t kLatestFormatVersion = kFormatV3;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "iterator/iterator.h"
+
+// AnyIterator 是满足 KVIterator 的任意迭代器的类型擦除包装，
+// 用于子迭代器类型只有运行期才能确定的场景（例如层数不定的读路径）。
+// 每次调用多一次虚调用，性能敏感的组合应直接使用模板。
+class AnyIterator final : public BaseIterator {
+ public:
+  // 构造一个无效的迭代器。
+  AnyIterator() = default;
+
+  template <KVIterator It>
+    requires(!std::same_as<std::remove_cvref_t<It>, AnyIterator>)
+  explicit AnyIterator(It it) {
+    if constexpr (std::derived_from<It, BaseIterator>) {
+      impl_ = std::make_unique<It>(std::move(it));
+    } else {
+      impl_ = std::make_unique<Model<It>>(std::move(it));
+    }
+  }
+
+  AnyIterator(AnyIterator&&) noexcept = default;
+  AnyIterator& operator=(AnyIterator&&) noexcept = default;
+
+  bool Valid() const override { return impl_ && impl_->Valid(); }
+  void SeekToFirst() override {
+    if (impl_) {
+      impl_->SeekToFirst();
+    }
+  }
+  void SeekToLast() override {
+    if (impl_) {
+      impl_->SeekToLast();
+    }
+  }
+  Status Seek(std::string_view target) override {
+    return impl_ ? impl_->Seek(target) : Status::NotFound();
+  }
+  Status SeekForPrev(std::string_view target) override {
+    return impl_ ? impl_->SeekForPrev(target) : Status::NotFound();
+  }
+  void Next() override { impl_->Next(); }
+  void Prev() override { impl_->Prev(); }
+  std::string_view key() const override { return impl_->key(); }
+  std::string_view value() const override { return impl_->value(); }
+
+ private:
+  // 把不继承 BaseIterator 的模板迭代器适配为虚接口
+  template <typename It>
+  class Model final : public BaseIterator {
+   public:
+    explicit Model(It it) : it_(std::move(it)) {}
+
+    bool Valid() const override { return it_.Valid(); }
+    void SeekToFirst() override { it_.SeekToFirst(); }
+    void SeekToLast() override { it_.SeekToLast(); }
+    Status Seek(std::string_view target) override { return it_.Seek(target); }
+    Status SeekForPrev(std::string_view target) override {
+      return it_.SeekForPrev(target);
+    }
+    void Next() override { it_.Next(); }
+    void Prev() override { it_.Prev(); }
+    std::string_view key() const override { return it_.key(); }
+    std::string_view value() const override { return it_.value(); }
+
+   private:
+    It it_;
+  };
+
+  std::unique_ptr<BaseIterator> impl_;
+};
@@ -1,11 +1,41 @@
 #pragma once
 
+#include <concepts>
 #include <string>
+#include <string_view>
+#include <utility>
 
-// BaseIterator 是所有 KV 迭代器的抽象基类，定义了解引用、相等比较和
-// 结束判定等最小接口，便于在不同存储层之间复用遍历逻辑。
+#include "utils/status.h"
+
+// BaseIterator 是所有 KV 迭代器的抽象基类。遍历协议为
+// Valid()/Next()/Prev()/Seek()/key()/value()：key() 和 value() 返回指向迭代器
+// 底层数据的 std::string_view，不做拷贝，在下一次移动迭代器之前保持有效。
+// 解引用、相等比较和 IsEnd 保留给按 STL 风格遍历的旧代码使用。
 class BaseIterator {
  public:
+  virtual ~BaseIterator() = default;
+
+  // 是否指向一条有效记录。
+  virtual bool Valid() const = 0;
+  // 移动到第一条记录。
+  virtual void SeekToFirst() = 0;
+  // 移动到第一个 key >= target 的记录，没有这样的记录时返回 NotFound
+  // 且 Valid() 为 false。
+  virtual Status Seek(std::string_view target) = 0;
+  // 移动到最后一条记录。
+  virtual void SeekToLast() = 0;
+  // 移动到最后一个 key <= target 的记录，没有这样的记录时返回 NotFound
+  // 且 Valid() 为 false。
+  virtual Status SeekForPrev(std::string_view target) = 0;
+  // 移动到下一条记录，要求 Valid()。
+  virtual void Next() = 0;
+  // 移动到上一条记录，要求 Valid()；已是第一条时 Valid() 变为 false。
+  virtual void Prev() = 0;
+  // 当前记录的 key / value，要求 Valid()。
+  virtual std::string_view key() const = 0;
+  virtual std::string_view value() const = 0;
+
+  // 拷贝出当前记录的 (key, value)，迭代器无效时抛出异常。
   virtual std::pair<std::string, std::string> operator*() const;
   virtual bool operator==(const BaseIterator& other) const {
     return this == &other;
@@ -13,9 +43,40 @@ class BaseIterator {
   virtual bool operator!=(const BaseIterator& other) const {
     return !(*this == other);
   }
-  virtual bool IsEnd() const;
+  virtual bool IsEnd() const { return !Valid(); }
 };
 
+// KVIterator 描述与 BaseIterator 相同的遍历协议，但不要求继承它。
+// 归并、分层等组合迭代器以模板参数接收子迭代器并用该 concept 约束，
+// 子迭代器的类型在编译期确定，热路径上是可内联的直接调用而非虚调用；
+// 需要运行期多态时再用 AnyIterator 包装。
+template <typename It>
+concept KVIterator = std::movable<It> && requires(It it, const It cit,
+                                                  std::string_view target) {
+  { cit.Valid() } -> std::convertible_to<bool>;
+  it.SeekToFirst();
+  it.SeekToLast();
+  { it.Seek(target) } -> std::same_as<Status>;
+  { it.SeekForPrev(target) } -> std::same_as<Status>;
+  it.Next();
+  it.Prev();
+  { cit.key() } -> std::convertible_to<std::string_view>;
+  { cit.value() } -> std::convertible_to<std::string_view>;
+};
+
+// 按从新到旧的顺序对 it 当前 key 的每个版本调用 visit(value)，visit 返回
+// false 时停止，返回值表示是否访问完了所有版本。要求 it.Valid()。
+// 归并迭代器只在移动时才跳过旧版本，当前 key 的所有版本都停在该 key 上，
+// 由它们的 ForEachVersion 递归访问；其余迭代器只有一个版本。
+template <KVIterator It, typename Visitor>
+bool VisitVersions(const It& it, Visitor&& visit) {
+  if constexpr (requires { it.ForEachVersion(visit); }) {
+    return it.ForEachVersion(visit);
+  } else {
+    return visit(std::string_view(it.value()));
+  }
+}
+
 // SearchItem 是用于优先队列/归并场景的辅助结构，
 // 按 (key, idx) 进行有序比较以稳定地合并多个有序流。
 struct SearchItem {
@@ -26,4 +87,4 @@ struct SearchItem {
 
 bool operator<(const SearchItem& a, const SearchItem& b);
 bool operator>(const SearchItem& a, const SearchItem& b);
-bool operator==(const SearchItem& a, const SearchItem& b);
\ No newline at end of file
+bool operator==(const SearchItem& a, const SearchItem& b);
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "iterator/iterator.h"
+#include "utils/status.h"
+
+// MergeIterator 用败者树 (loser tree) 按 key 有序地多路归并任意个同类型的
+// 有序子迭代器，例如 L0 的多个 SST、整个引擎的各层或 compaction 的输入。
+// 与 SearchItem 的约定一致，下标越小的子迭代器数据越新：同一个 key 出现在
+// 多个子迭代器中时只返回下标最小的版本，其余旧版本在 Next 时跳过。
+// 每前进一步只需沿叶子到根重赛一次，约 log2(N) 次比较，遍历过程中不分配内存。
+// 反向遍历时败者树改为 key 大者胜出，Next/Prev 之间切换方向时把所有子迭代器
+// 重新定位到当前 key 的另一侧，之后每一步的代价与正向相同。
+// 删除标记（空 value）原样返回，由上层决定是否过滤。
+template <KVIterator Child>
+class MergeIterator {
+ public:
+  MergeIterator() = default;
+
+  explicit MergeIterator(std::vector<Child> children)
+      : children_(std::move(children)),
+        tree_(children_.size()),
+        winners_(children_.size()) {
+    Build();
+  }
+
+  bool Valid() const {
+    return !children_.empty() && children_[tree_[0]].Valid();
+  }
+
+  void SeekToFirst() {
+    for (auto& child : children_) {
+      child.SeekToFirst();
+    }
+    forward_ = true;
+    Build();
+  }
+
+  void SeekToLast() {
+    for (auto& child : children_) {
+      child.SeekToLast();
+    }
+    forward_ = false;
+    Build();
+  }
+
+  Status Seek(std::string_view target) {
+    for (auto& child : children_) {
+      child.Seek(target);
+    }
+    forward_ = true;
+    Build();
+    return Valid() ? Status::OK() : Status::NotFound();
+  }
+
+  Status SeekForPrev(std::string_view target) {
+    for (auto& child : children_) {
+      child.SeekForPrev(target);
+    }
+    forward_ = false;
+    Build();
+    return Valid() ? Status::OK() : Status::NotFound();
+  }
+
+  void Next() { Step(true); }
+  void Prev() { Step(false); }
+
+  std::string_view key() const { return children_[tree_[0]].key(); }
+  std::string_view value() const { return children_[tree_[0]].value(); }
+
+  // 当前记录来自哪个子迭代器，下标越小数据越新。
+  size_t current_child() const { return tree_[0]; }
+  size_t num_children() const { return children_.size(); }
+
+  // 按从新到旧的顺序访问当前 key 在各子迭代器中的所有版本，见 VisitVersions。
+  template <typename Visitor>
+  bool ForEachVersion(Visitor& visit) const {
+    std::string_view current = key();
+    for (const auto& child : children_) {
+      if (child.Valid() && child.key() == current &&
+          !VisitVersions(child, visit)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  // 按 forward 方向移动到下一条不同的 key
+  void Step(bool forward) {
+    if (!Valid()) {
+      return;
+    }
+    // 子迭代器移动后 key() 失效，先保存当前 key 用于跳过旧版本
+    current_key_.assign(key());
+    if (forward != forward_) {
+      // 切换方向：其余子迭代器停在当前 key 的另一侧，全部重新定位到
+      // 严格越过当前 key 的位置后重建整棵树
+      forward_ = forward;
+      for (auto& child : children_) {
+        if (forward) {
+          child.Seek(current_key_);
+          if (child.Valid() && child.key() == current_key_) {
+            child.Next();
+          }
+        } else {
+          child.SeekForPrev(current_key_);
+          if (child.Valid() && child.key() == current_key_) {
+            child.Prev();
+          }
+        }
+      }
+      Build();
+      return;
+    }
+    Advance(tree_[0]);
+    while (Valid() && key() == current_key_) {
+      Advance(tree_[0]);
+    }
+  }
+
+  // a 是否应排在 b 之前：无效的子迭代器排在最后，正向时 key 小者优先、
+  // 反向时 key 大者优先，key 相同时新的优先
+  bool Less(size_t a, size_t b) const {
+    const Child& ca = children_[a];
+    const Child& cb = children_[b];
+    if (!ca.Valid()) {
+      return false;
+    }
+    if (!cb.Valid()) {
+      return true;
+    }
+    int cmp = std::string_view(ca.key()).compare(cb.key());
+    if (!forward_) {
+      cmp = -cmp;
+    }
+    return cmp < 0 || (cmp == 0 && a < b);
+  }
+
+  // 自底向上重建整棵树。叶子 i 位于位置 n + i，内部节点 p 的孩子是 2p 和
+  // 2p + 1，tree_[p] 记录该节点比赛的败者，tree_[0] 记录最终胜者。
+  void Build() {
+    size_t n = children_.size();
+    if (n == 0) {
+      return;
+    }
+    auto winner_of = [&](size_t pos) {
+      return pos >= n ? pos - n : winners_[pos];
+    };
+    for (size_t p = n - 1; p >= 1; p--) {
+      size_t left = winner_of(2 * p);
+      size_t right = winner_of(2 * p + 1);
+      if (Less(left, right)) {
+        winners_[p] = left;
+        tree_[p] = right;
+      } else {
+        winners_[p] = right;
+        tree_[p] = left;
+      }
+    }
+    tree_[0] = n == 1 ? 0 : winners_[1];
+  }
+
+  // 按当前方向移动第 i 个子迭代器，并沿它的叶子到根重新比赛
+  void Advance(size_t i) {
+    if (forward_) {
+      children_[i].Next();
+    } else {
+      children_[i].Prev();
+    }
+    size_t winner = i;
+    for (size_t p = (i + children_.size()) / 2; p > 0; p /= 2) {
+      if (Less(tree_[p], winner)) {
+        std::swap(tree_[p], winner);
+      }
+    }
+    tree_[0] = winner;
+  }
+
+  std::vector<Child> children_;
+  // 败者树的内部节点，tree_[0] 为当前胜者
+  std::vector<size_t> tree_;
+  // Build 时暂存每个内部节点的胜者，复用以避免重复分配
+  std::vector<size_t> winners_;
+  // Next/Prev 时保存的上一条记录的 key，复用其缓冲区
+  std::string current_key_;
+  // 当前遍历方向
+  bool forward_ = true;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "iterator/iterator.h"
+#include "utils/status.h"
+
+// TwoMergeIterator 按 key 有序地合并两个有序迭代器，A 中的数据比 B 新：
+// 同一个 key 同时出现在两边时只返回 A 的版本，B 中的旧版本被跳过。
+// 子迭代器以值的形式持有、类型在编译期确定，逐 key 的调用都是直接调用。
+// 支持双向遍历，Next/Prev 之间切换方向时会重新定位落后的子迭代器。
+// 删除标记（空 value）原样返回，由上层决定是否过滤。
+template <KVIterator A, KVIterator B>
+class TwoMergeIterator {
+ public:
+  TwoMergeIterator(A a, B b) : a_(std::move(a)), b_(std::move(b)) {
+    Choose();
+  }
+
+  bool Valid() const { return a_.Valid() || b_.Valid(); }
+
+  void SeekToFirst() {
+    a_.SeekToFirst();
+    b_.SeekToFirst();
+    forward_ = true;
+    Choose();
+  }
+
+  void SeekToLast() {
+    a_.SeekToLast();
+    b_.SeekToLast();
+    forward_ = false;
+    Choose();
+  }
+
+  Status Seek(std::string_view target) {
+    a_.Seek(target);
+    b_.Seek(target);
+    forward_ = true;
+    Choose();
+    return Valid() ? Status::OK() : Status::NotFound();
+  }
+
+  Status SeekForPrev(std::string_view target) {
+    a_.SeekForPrev(target);
+    b_.SeekForPrev(target);
+    forward_ = false;
+    Choose();
+    return Valid() ? Status::OK() : Status::NotFound();
+  }
+
+  void Next() {
+    if (!Valid()) {
+      return;
+    }
+    if (!forward_) {
+      // 反向时另一侧停在当前 key 之前，先把两侧都定位到当前 key 之后
+      std::string current(key());
+      SkipTo(a_, current, true);
+      SkipTo(b_, current, true);
+      forward_ = true;
+    } else {
+      Advance();
+    }
+    Choose();
+  }
+
+  void Prev() {
+    if (!Valid()) {
+      return;
+    }
+    if (forward_) {
+      std::string current(key());
+      SkipTo(a_, current, false);
+      SkipTo(b_, current, false);
+      forward_ = false;
+    } else {
+      Advance();
+    }
+    Choose();
+  }
+
+  std::string_view key() const { return choose_a_ ? a_.key() : b_.key(); }
+  std::string_view value() const {
+    return choose_a_ ? a_.value() : b_.value();
+  }
+
+  // 按从新到旧的顺序访问当前 key 在两侧的所有版本，见 VisitVersions。
+  template <typename Visitor>
+  bool ForEachVersion(Visitor& visit) const {
+    std::string_view current = key();
+    if (a_.Valid() && a_.key() == current && !VisitVersions(a_, visit)) {
+      return false;
+    }
+    return !b_.Valid() || b_.key() != current || VisitVersions(b_, visit);
+  }
+
+ private:
+  // 按当前方向移动一步
+  template <KVIterator It>
+  void Step(It& it) {
+    if (forward_) {
+      it.Next();
+    } else {
+      it.Prev();
+    }
+  }
+
+  // 按当前方向移动被选中的一侧；选中 A 且 B 停在同一个 key 上时，
+  // B 的旧版本一起跳过
+  void Advance() {
+    if (choose_a_) {
+      if (b_.Valid() && b_.key() == a_.key()) {
+        Step(b_);
+      }
+      Step(a_);
+    } else {
+      Step(b_);
+    }
+  }
+
+  // 把 it 定位到严格大于（forward）或严格小于 target 的第一条记录
+  template <KVIterator It>
+  static void SkipTo(It& it, std::string_view target, bool forward) {
+    if (forward) {
+      it.Seek(target);
+      if (it.Valid() && it.key() == target) {
+        it.Next();
+      }
+    } else {
+      it.SeekForPrev(target);
+      if (it.Valid() && it.key() == target) {
+        it.Prev();
+      }
+    }
+  }
+
+  // key 相同时选择 A
+  void Choose() {
+    if (!a_.Valid() || !b_.Valid()) {
+      choose_a_ = a_.Valid();
+      return;
+    }
+    int cmp = std::string_view(a_.key()).compare(b_.key());
+    choose_a_ = forward_ ? cmp <= 0 : cmp >= 0;
+  }
+
+  A a_;
+  B b_;
+  // 当前记录是否来自 A
+  bool choose_a_ = false;
+  // 当前遍历方向
+  bool forward_ = true;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "consts.h"
+#include "lsm/merge_operator.h"
+#include "lsm/version.h"
+#include "sst/level_iterator.h"
+#include "sst/table_cache.h"
+#include "utils/rate_limiter.h"
+#include "utils/read_options.h"
+#include "utils/status.h"
+
+class ThreadPool;
+
+enum class CompactionStyle {
+  // 每层大小是上一层的固定倍数，读放大和空间放大小，写放大大
+  kLeveled,
+  // 所有数据都是 L0 中的有序段 (sorted run)，合并大小相近的段，写放大小，
+  // 读放大和空间放大较大，适合以写入为主的场景
+  kUniversal,
+  // 不合并数据，按 TTL 或总大小整文件删除最旧的 SST，适合只追加、有保留期
+  // 的时序数据；可以选择只合并同一时间窗口内的文件
+  kFifo,
+};
+
+struct CompactionOptions {
+  CompactionStyle style = CompactionStyle::kLeveled;
+  // L0 的文件数（universal 下为有序段数）达到该值时触发 compaction
+  size_t l0_compaction_trigger = 4;
+  // L1 的目标大小，之后每层是上一层的 level_size_multiplier 倍
+  uint64_t max_bytes_for_level_base = 10 * kTableSizeLimit;
+  uint64_t level_size_multiplier = 10;
+  // 输出 SST 的目标大小，写满后切换到新文件
+  size_t target_file_size = kTableSizeLimit;
+  // 后台 compaction 线程数，为 0 时不做后台 compaction
+  size_t max_background_compactions = 1;
+  // 一个输出到 L1 及以下的 compaction 最多按 key 范围切成多少个子任务并行
+  // 执行，为 1 时不切分。所有 compaction 共用 max_subcompactions - 1 个
+  // 额外的线程
+  size_t max_subcompactions = 1;
+
+  // 以下只用于 universal：
+  // 相邻的段累计大小的 (100 + size_ratio)% 不小于下一个段时把它们一起合并
+  uint32_t universal_size_ratio = 1;
+  // 一次至少 / 至多合并多少个段
+  size_t universal_min_merge_width = 2;
+  size_t universal_max_merge_width = std::numeric_limits<size_t>::max();
+  // 除最旧的段以外的数据量超过最旧段的该百分比时做一次全量合并
+  uint64_t universal_max_size_amplification_percent = 200;
+
+  // 以下只用于 FIFO：
+  // creation_time 早于该秒数之前的文件被整个删除，为 0 时不按时间删除
+  uint64_t fifo_ttl_seconds = 0;
+  // 所有文件的总大小超过该值时从最旧的文件开始删除，为 0 时不限制
+  uint64_t fifo_max_table_files_size = 0;
+  // 不为 0 时按 creation_time 把时间划分成该秒数的窗口，同一窗口内相邻的
+  // 文件合并成一个；仍在写入的当前窗口不合并
+  uint64_t fifo_time_window_seconds = 0;
+  // 上面两个按时间的选项生效时，后台每隔该毫秒数调度一次 compaction，没有
+  // 新的写入时过期的文件和结束的窗口也会被处理
+  uint32_t fifo_check_interval_ms = 1000;
+};
+
+// 一次 compaction 的输入：level 层的 inputs 与 output_level 层中与之重叠
+// 的 output_level_inputs 合并后写到 output_level。
+struct Compaction {
+  size_t level = 0;
+  size_t output_level = 1;
+  std::vector<LevelFileMeta> inputs;
+  std::vector<LevelFileMeta> output_level_inputs;
+  // 选中时该层的得分
+  double score = 0;
+  // 输出文件的大小上限，超过后切换到新文件
+  uint64_t max_output_file_size = std::numeric_limits<uint64_t>::max();
+  // 输入之外还有更旧的同层数据时为 false，此时必须保留所有删除标记
+  bool may_drop_deletions = true;
+  // 为 true 时直接删除所有输入文件，不读也不写任何数据
+  bool deletion_only = false;
+
+  // 只有一个输入文件且与下一层没有重叠时，直接把文件移到下一层，不用重写。
+  bool IsTrivialMove() const {
+    return output_level != level && inputs.size() == 1 &&
+           output_level_inputs.empty();
+  }
+  // 所有输入文件的 id
+  std::vector<size_t> InputIds() const;
+};
+
+// 返回 files 中 key 范围与 [smallest, largest] 重叠的文件。
+std::vector<LevelFileMeta> OverlappingFiles(
+    const std::vector<LevelFileMeta>& files, std::string_view smallest,
+    std::string_view largest);
+
+// CompactionPicker 根据当前 Version 决定下一个 compaction，不是线程安全的。
+class CompactionPicker {
+ public:
+  virtual ~CompactionPicker() = default;
+
+  // 挑选下一个 compaction，输入文件都不能在 being_compacted 中。没有需要
+  // 做的 compaction 时返回 nullopt。
+  virtual std::optional<Compaction> Pick(
+      const Version& version,
+      const std::unordered_set<size_t>& being_compacted) = 0;
+};
+
+// 按 options.style 创建对应的 picker。
+std::unique_ptr<CompactionPicker> NewCompactionPicker(
+    const CompactionOptions& options);
+
+// LeveledCompactionPicker 按得分挑选 compaction：L0 的得分是文件数与
+// l0_compaction_trigger 之比，L1 及以下是该层大小与目标大小之比。得分
+// 不小于 1 的层中得分最高的优先。L1 及以下每次只挑一个文件，按
+// compact pointer 在层内轮转，保证整层的 key 范围都会被轮到。
+class LeveledCompactionPicker final : public CompactionPicker {
+ public:
+  explicit LeveledCompactionPicker(const CompactionOptions& options)
+      : options_(options), compact_pointer_(kNumLevels) {}
+
+  uint64_t MaxBytesForLevel(size_t level) const;
+  double Score(const Version& version, size_t level) const;
+
+  std::optional<Compaction> Pick(
+      const Version& version,
+      const std::unordered_set<size_t>& being_compacted) override;
+
+ private:
+  std::optional<Compaction> PickLevel(
+      const Version& version, size_t level,
+      const std::unordered_set<size_t>& being_compacted);
+
+  CompactionOptions options_;
+  // 每层上一次 compaction 的最大 key
+  std::vector<std::string> compact_pointer_;
+};
+
+// UniversalCompactionPicker 把 L0 的每个文件看作一个有序段，按从新到旧
+// 依次检查：
+// 1. 段数未达到 l0_compaction_trigger 时不做 compaction；
+// 2. 空间放大超过 universal_max_size_amplification_percent 时合并所有段；
+// 3. 从最新的段开始，把累计大小与下一个段相近的一串段合并成一个；
+// 4. 仍然没有可合并的段时合并最新的若干段，使段数回到 trigger 以下。
+// 输出仍然是 L0 中的一个文件，epoch 取输入中最大的，保持段之间的新旧次序。
+class UniversalCompactionPicker final : public CompactionPicker {
+ public:
+  explicit UniversalCompactionPicker(const CompactionOptions& options)
+      : options_(options) {}
+
+  std::optional<Compaction> Pick(
+      const Version& version,
+      const std::unordered_set<size_t>& being_compacted) override;
+
+ private:
+  // 合并 runs 中 [begin, end) 的段，runs 从新到旧排列
+  Compaction MakeCompaction(const std::vector<LevelFileMeta>& runs,
+                            size_t begin, size_t end, double score) const;
+
+  CompactionOptions options_;
+};
+
+// FifoCompactionPicker 只处理 L0，文件按 epoch 从旧到新排列，依次检查：
+// 1. creation_time 超过 fifo_ttl_seconds 的文件，以及使总大小超过
+//    fifo_max_table_files_size 的最旧的文件，一起整文件删除；
+// 2. 设置了 fifo_time_window_seconds 时，把已经结束的时间窗口中相邻的多个
+//    文件合并成一个，输出仍在 L0 并继承输入的 epoch 和 creation_time。
+// 删除只需要一条 VersionEdit，代价与删除的文件数成正比，没有任何重写。
+class FifoCompactionPicker final : public CompactionPicker {
+ public:
+  explicit FifoCompactionPicker(const CompactionOptions& options)
+      : options_(options) {}
+
+  // 以当前时间调用 PickAt
+  std::optional<Compaction> Pick(
+      const Version& version,
+      const std::unordered_set<size_t>& being_compacted) override;
+
+  // now 是以秒为单位的 Unix 时间
+  std::optional<Compaction> PickAt(
+      const Version& version,
+      const std::unordered_set<size_t>& being_compacted, uint64_t now) const;
+
+ private:
+  CompactionOptions options_;
+};
+
+// CompactionJob 归并一个 Compaction 的所有输入，按 max_output_file_size 切分
+// 写出新的 SST。输出层以下都没有某个 key 时，该 key 的删除标记被丢弃。
+// 设置了 MergeOperator 时，同一个 key 的 Merge 操作数与输入中更旧的值合并
+// 成一个值；输入中没有更旧的值时合成一个操作数，除非输出层以下也没有该 key。
+// 执行期间 version 必须保持不变（由调用方持有）。
+//
+// options.max_subcompactions 大于 1 且输出层不是 L0 时，按输入文件的
+// BlockMeta 边界把 key 空间切成互不相交的子范围，各自归并、写出自己的文件，
+// 所有输出最后记录在同一个 edit 中一起生效。第一个子范围在调用线程执行，
+// 其余的交给 SetThreadPool 设置的线程池，此时 new_file_number 会被并发
+// 调用；没有线程池时依次在调用线程执行。
+class CompactionJob {
+ public:
+  CompactionJob(const Compaction& compaction,
+                std::shared_ptr<const Version> version,
+                std::shared_ptr<TableCache> table_cache,
+                std::function<size_t()> new_file_number,
+                const CompactionOptions& options);
+
+  // 输出文件以低优先级经过 rate_limiter 限速写出。
+  void SetRateLimiter(std::shared_ptr<RateLimiter> rate_limiter) {
+    rate_limiter_ = std::move(rate_limiter);
+  }
+
+  // 没有设置时遇到 Merge 操作数返回错误，不丢弃任何数据。
+  void SetMergeOperator(std::shared_ptr<const MergeOperator> merge_operator) {
+    merge_operator_ = std::move(merge_operator);
+  }
+
+  // 执行子范围的线程池，由调用方持有并在 Run 期间保持存活。多个 job 可以
+  // 共用一个，子范围的总线程数就不会随并发的 job 增长。
+  void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+
+  // 执行 compaction，把删除输入文件、加入输出文件记录到 edit 中。失败时
+  // 删除已经写出的输出文件。
+  Status Run(VersionEdit* edit);
+
+  // 写出的记录数和丢弃的删除标记数
+  uint64_t num_output_entries() const { return num_output_entries_; }
+  uint64_t num_dropped_deletions() const { return num_dropped_deletions_; }
+  // 被合并掉的 Merge 操作数个数
+  uint64_t num_merged_operands() const { return num_merged_operands_; }
+  // 实际执行的子任务数
+  size_t num_subcompactions() const { return num_subcompactions_; }
+
+ private:
+  // 一个子范围的执行状态，子范围之间不共享任何可变状态
+  struct Subcompaction {
+    // 只用到其中的 lower_bound / upper_bound
+    ReadOptions range;
+    std::vector<LevelFileMeta> outputs;
+    // IsBottommost 在 output_level 以下各层中的当前文件下标
+    std::vector<size_t> level_ptrs;
+    uint64_t num_output_entries = 0;
+    uint64_t num_dropped_deletions = 0;
+    uint64_t num_merged_operands = 0;
+  };
+
+  // 返回子范围之间的切分点，不切分时为空
+  std::vector<std::string> SplitKeyRange() const;
+  // 归并 sub->range 内的数据并写出输出文件
+  Status ProcessRange(Subcompaction* sub);
+  // 把 iter 中的记录合并 Merge 操作数、丢弃无用的删除标记后写成输出文件。
+  // 按输入的组成静态选择 iter 的类型，避免逐条记录的虚函数调用
+  template <KVIterator Iter>
+  Status WriteOutputs(Iter& iter, Subcompaction* sub);
+  // key 在 output_level 以下的各层中都不存在时返回 true。同一个 level_ptrs
+  // 上 key 必须递增调用。
+  bool IsBottommost(std::string_view key,
+                    std::vector<size_t>* level_ptrs) const;
+
+  const Compaction& compaction_;
+  std::shared_ptr<const Version> version_;
+  std::shared_ptr<TableCache> table_cache_;
+  std::function<size_t()> new_file_number_;
+  CompactionOptions options_;
+  std::shared_ptr<RateLimiter> rate_limiter_;
+  std::shared_ptr<const MergeOperator> merge_operator_;
+  ThreadPool* pool_ = nullptr;
+  size_t num_subcompactions_ = 0;
+  uint64_t num_output_entries_ = 0;
+  uint64_t num_dropped_deletions_ = 0;
+  uint64_t num_merged_operands_ = 0;
+};
@@ -1,34 +1,280 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
-#include <filesystem>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "iterator/merge_iterator.h"
+#include "iterator/two_merge_iterator.h"
+#include "lsm/compaction.h"
+#include "lsm/merge_operator.h"
+#include "lsm/super_version.h"
+#include "lsm/version.h"
 #include "memtable/memtable.h"
+#include "memtable/memtable_iterator.h"
+#include "sst/l0_iterator.h"
+#include "sst/level_iterator.h"
 #include "sst/sst.h"
+#include "sst/table_cache.h"
+#include "utils/rate_limiter.h"
+#include "utils/read_options.h"
+#include "utils/status.h"
+#include "utils/thread_pool.h"
+#include "wal/wal.h"
+
+// ParallelScan 的选项。
+struct ScanOptions {
+  // 工作线程数，0 表示使用硬件并发数。
+  size_t num_threads = 0;
+  // 后台预读 block 的线程数，为 0 时不使用后台预读。所有分片共享同一个
+  // 预读器，每个 SstIterator 在读取当前 block 时预读其后的若干 block。
+  size_t prefetch_threads = 0;
+  // 为 true 时回调在调用线程上按 key 顺序执行，各分片先在工作线程上扫描到
+  // 缓冲区中，同时最多缓冲 num_threads 个分片；为 false 时回调直接在工作
+  // 线程上并发执行，只保证同一分片内有序，回调需要自行保证线程安全。
+  bool ordered = false;
+};
+
+// LSMEngine 的选项。
+struct EngineOptions {
+  WalOptions wal;
+  CompactionOptions compaction;
+  // 启动时并行打开所有 SST 的线程数，为 0 时不预先打开，每个文件在第一次
+  // 被访问时才打开。
+  size_t open_threads = 0;
+  // Flush（高优先级）和 compaction（低优先级）写 SST 时共用的限速器，为空
+  // 时不限速。自动调整模式下 Get 的延迟会反馈给它。WAL 在前台写入路径上，
+  // 不经过限速。
+  std::shared_ptr<RateLimiter> rate_limiter;
+  // Merge 写入使用的合并函数，为空时不能调用 Merge。打开已经写入过 Merge
+  // 操作数的数据时必须提供同样语义的合并函数。
+  std::shared_ptr<const MergeOperator> merge_operator;
+};
+
+// 扫描回调，返回 false 时停止整个扫描。
+using ScanCallback =
+    std::function<bool(std::string_view key, std::string_view value)>;
+
+class EngineIterator;
 
 class LSMEngine {
  public:
-  explicit LSMEngine(std::filesystem::path path);
-  ~LSMEngine() = default;
+  // 打开数据目录：从 MANIFEST 恢复各层的文件列表，再回放其中尚未写入 SST
+  // 的 WAL 恢复 memtable。
+  explicit LSMEngine(std::filesystem::path path,
+                     const EngineOptions& options = {});
+  // 等待正在执行的 compaction 结束，尚未开始的不再执行。
+  ~LSMEngine();
 
+  // key 不存在或已删除时返回 nullopt，读到损坏数据时抛出异常。
   std::optional<std::string> Get(std::string_view key) const;
+  // 不抛异常的点查：命中返回 OK，不存在或已删除返回 NotFound，
+  // 数据损坏等错误通过其余状态返回。
+  Status Get(std::string_view key, std::string* value) const;
+  // 先追加到 WAL 再写入 memtable，写 WAL 失败时抛出异常。
   void Put(std::string_view key, std::string_view value);
   void Remove(std::string_view key);
+  // 把 operand 记为 key 的一次增量修改，不读取 SST 中的旧值。memtable 中每个
+  // key 只有一个节点，所以 memtable 中已有的同一个 key 在写入时立即与
+  // operand 合并（查一次 memtable 并调用 merge_operator），与 SST 中更旧的
+  // 数据在读取和 compaction 时再合并。没有设置 merge_operator 时抛出异常。
+  void Merge(std::string_view key, std::string_view operand);
+  // 冻结活跃的 memtable 并写成 L0 的 SST，记录到 MANIFEST 后释放已经持久化
+  // 的 WAL segment，最后按需调度后台 compaction。刷盘期间读写照常进行。
   void Flush();
 
+  // 等待后台 compaction 全部完成，返回后台出现过的第一个错误。
+  Status WaitForCompactions();
+
+  // 按 L0 中各 SST 的 block 边界和更深层各文件的边界把 [start, end) 切成
+  // 至多 num_partitions 个数据量相近的分片，返回分片之间的切分点（严格位于
+  // start 和 end 之间，升序）。end 为空表示没有上界。
+  std::vector<std::string> SplitRange(std::string_view start,
+                                      std::string_view end,
+                                      size_t num_partitions) const;
+
+  // 并行扫描 [start, end) 内的有效记录（不含删除标记），end 为空表示没有上界。
+  // 范围由 SplitRange 切分后交给工作线程，每个分片使用独立的迭代器栈。
+  // 所有分片共用开始扫描时的 SuperVersion，扫描期间的 Flush 和 compaction
+  // 不影响结果。这不是快照：对活跃 memtable 的并发写入可能只被部分分片
+  // 看到。
+  Status ParallelScan(std::string_view start, std::string_view end,
+                      const ScanOptions& options,
+                      const ScanCallback& callback) const;
+
+  // 返回合并活跃和冻结的 memtable 以及各层 SST 的迭代器，不返回删除标记
+  // 和被覆盖的旧版本，只返回 options 上下界内的记录。
+  // 创建后指向第一条记录。打开 SST 失败时抛出异常。迭代器固定创建时的
+  // memtable 和 SST 集合，但不是快照：memtable 中的 key 没有多版本，之后
+  // 对活跃 memtable 的写入可能看到也可能看不到。
+  EngineIterator NewIterator(const ReadOptions& options = {}) const;
+
+  // 把 [begin, end) 内至多 limit 条有效记录按 key 升序追加到 result，
+  // end 为空表示没有上界。
+  Status Scan(std::string_view begin, std::string_view end, size_t limit,
+              std::vector<std::pair<std::string, std::string>>* result) const;
+
+  // 合并 memtable、L0 和 L1 及以下各层的内部迭代器，保留删除标记和 Merge
+  // 操作数，新数据覆盖旧数据，被覆盖的旧版本可以通过 VisitVersions 访问。
+  // 每个 memtable 是一个独立的子迭代器，活跃 memtable 中的操作数才能看到
+  // 冻结 memtable 中的旧值。迭代器持有创建时的 Version，期间被 compaction
+  // 删除的文件会在迭代器销毁后才真正删除。
+  using InternalIterator = TwoMergeIterator<
+      TwoMergeIterator<MergeIterator<MemTableIterator>, L0Iterator>,
+      MergeIterator<LevelIterator>>;
+  InternalIterator NewInternalIterator(const ReadOptions& options) const;
+  // 在给定的 SuperVersion 上创建内部迭代器，ParallelScan 的各分片共用一个
+  InternalIterator NewInternalIterator(
+      const std::shared_ptr<const SuperVersion>& super_version,
+      const ReadOptions& options) const;
+
   std::filesystem::path SstPath(size_t sst_id) const;
+  std::filesystem::path WalDir() const;
+
+  // Get 的实现，不记录延迟
+  Status GetImpl(std::string_view key, std::string* value) const;
+  // 分配 seq 并写入 WAL 和活跃 memtable，返回 memtable 是否已满。memtable
+  // 按 seq 的顺序更新：有 WAL 时由 group commit 按 WAL 中的顺序分配 seq 并
+  // 更新，否则在 write_order_mutex_ 下串行完成。
+  bool Write(WalRecordType type, std::string_view key, std::string_view value);
+  // 在 mem 中把 operand 与 key 已有的值或操作数合并，WAL 回放时也使用。
+  // 要求对 mem 的写入已经串行化（见 Write），合并函数在 memtable 的锁外执行
+  void MergeInto(MemTable* mem, const std::string& key,
+                 std::string_view operand, uint64_t seq) const;
+
+  // only_if_full 为 true 时只在活跃 memtable 达到大小上限时冻结它，避免多个
+  // 写入线程同时触发时重复刷出很小的 memtable。之后按从旧到新的顺序刷出
+  // pending_flushes_ 中所有冻结的 memtable，失败时抛出异常。
+  void FlushMemTable(bool only_if_full);
+  // 把一个冻结的 memtable 写成 L0 的 SST 并记录到 MANIFEST，然后从
+  // SuperVersion 中去掉它并释放 wal_log_number 之前的 WAL segment
+  void WriteLevel0Table(const std::shared_ptr<MemTable>& imm,
+                        uint64_t wal_log_number);
+
+  // 取得当前 SuperVersion 的一份引用，不加锁
+  std::shared_ptr<const SuperVersion> GetSuperVersion() const;
+  // 复制当前 SuperVersion，用 update 修改 memtable 列表后换上最新的
+  // Version 并安装。Flush 和 compaction 在 LogAndApply 之后调用。
+  void InstallSuperVersion(
+      const std::function<void(SuperVersion*)>& update = nullptr);
+
+  // 在 compaction_mutex_ 下挑选并提交后台 compaction，直到没有可做的或达到
+  // 并发上限
+  void MaybeScheduleCompaction();
+  void MaybeScheduleCompactionLocked();
+  void BackgroundCompaction(const Compaction& compaction);
+  // FIFO 按时间删除或合并文件时由 compaction_timer_ 执行，定期调度
+  // compaction，直到 shutting_down_
+  void CompactionTimerLoop();
+  Status DoCompaction(const Compaction& compaction);
+  // 删除不再被任何 Version 引用的 compaction 输入文件
+  void DeleteObsoleteFiles();
+  // 打开时删除目录中不属于恢复出的 Version 的 SST：崩溃前写完但没来得及
+  // 记录到 MANIFEST 的 Flush 或 compaction 输出
+  void DeleteOrphanFiles();
 
   // sst文件目录
   std::filesystem::path data_dir_;
-  // 内存写入
-  MemTable memtable_;
-  // L0层所有的sst的id，最新文件在尾部
-  std::list<size_t> l0_sst_ids_;
-  // sst_id -> SST
-  std::unordered_map<size_t, std::shared_ptr<SST>> ssts_;
+  // 读者看到的 memtable 和 SST 文件集合，整体原子替换
+  std::atomic<std::shared_ptr<const SuperVersion>> super_version_;
+  // 串行化 SuperVersion 的安装
+  std::mutex super_version_mutex_;
+  // 写入持有共享锁，冻结活跃 memtable 时持有独占锁
+  std::shared_mutex write_mutex_;
+  // 没有 WAL 时串行化 seq 的分配和 memtable 的更新
+  std::mutex write_order_mutex_;
+  // 同一时刻只有一个 Flush
+  std::mutex flush_mutex_;
+  // 已冻结、尚未写入 SST 的 memtable 及其之后的写入所在的 WAL segment，
+  // 从旧到新排列，由 flush_mutex_ 保护
+  std::deque<std::pair<std::shared_ptr<MemTable>, uint64_t>> pending_flushes_;
+  // 所有 SST 共享的 block 缓存
+  std::shared_ptr<BlockCache> block_cache_;
+  // 已打开的 SST，按需打开
+  std::shared_ptr<TableCache> table_cache_;
+  // 各层的文件列表和 MANIFEST
+  VersionSet versions_;
+  // 预写日志，WalOptions::enabled 为 false 时为空
+  std::unique_ptr<Wal> wal_;
+  // 下一条写入的序列号
+  std::atomic<uint64_t> next_seq_{1};
+  // 后台写 SST 的限速器，可以为空
+  std::shared_ptr<RateLimiter> rate_limiter_;
+  // Merge 的合并函数，可以为空
+  std::shared_ptr<const MergeOperator> merge_operator_;
+
+  CompactionOptions compaction_options_;
+  // 以下状态由 compaction_mutex_ 保护
+  std::mutex compaction_mutex_;
+  std::condition_variable compaction_cv_;
+  std::unique_ptr<CompactionPicker> picker_;
+  // 正在参与 compaction 的文件
+  std::unordered_set<size_t> being_compacted_;
+  size_t running_compactions_ = 0;
+  bool shutting_down_ = false;
+  // 后台出现过的第一个错误，之后不再调度 compaction
+  Status bg_error_;
+  // 已经从 Version 中删除、等待读者释放后删除的文件
+  std::vector<size_t> obsolete_files_;
+  // 串行化 DeleteObsoleteFiles，一次调用放回的仍在使用的文件一定能被之后
+  // 的调用看到
+  std::mutex delete_files_mutex_;
+  // 执行 compaction 的子范围，max_subcompactions 不大于 1 时为空。在
+  // compaction_pool_ 之后停止，正在执行的 compaction 还会用到它
+  std::unique_ptr<ThreadPool> subcompaction_pool_;
+  // 放在最后，析构时最先停止
+  std::unique_ptr<ThreadPool> compaction_pool_;
+  // 只负责定时调度，compaction 仍在 compaction_pool_ 中执行
+  std::thread compaction_timer_;
+};
+
+// EngineIterator 在 LSMEngine 的内部迭代器上跳过删除标记和上下界之外的
+// 记录，Merge 操作数与旧版本合并后返回。内部迭代器持有创建时各 memtable
+// 的 SkipList 和 Version，遍历期间的 Flush 和 compaction 不影响它看到的数据；
+// 对活跃 memtable 的并发写入可能看到也可能看不到。遇到 Merge 操作数但没有
+// merge_operator 时抛出异常。
+class EngineIterator final : public BaseIterator {
+ public:
+  EngineIterator(LSMEngine::InternalIterator iter, const ReadOptions& options,
+                 std::shared_ptr<const MergeOperator> merge_operator = nullptr);
+
+  bool Valid() const override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  Status Seek(std::string_view target) override;
+  Status SeekForPrev(std::string_view target) override;
+  void Next() override;
+  void Prev() override;
+  std::string_view key() const override;
+  std::string_view value() const override;
+
+ private:
+  // 计算当前 key 的值，已删除时返回 false
+  bool Resolve();
+  void SkipDeletionsForward();
+  void SkipDeletionsBackward();
+
+  LSMEngine::InternalIterator iter_;
+  ReadOptions options_;
+  std::shared_ptr<const MergeOperator> merge_operator_;
+  // 当前 key 是 Merge 操作数时合并后的值
+  bool merged_ = false;
+  std::string merged_value_;
+  // 合并时收集的操作数，复用缓冲区
+  std::vector<std::string> operands_;
 };
 
 class LSM {
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "iterator/iterator.h"
+#include "utils/value_encoding.h"
+
+// MergeOperator 定义 LSMEngine::Merge 写入的操作数如何作用在已有的值上，
+// 例如计数器加一、向列表追加元素。写入时不读旧值，操作数作为增量保存在
+// memtable 和 SST 中，在 Get、遍历、Flush 前的 memtable 写入和 compaction
+// 时才与更旧的值合并。
+//
+// Merge 必须满足结合律：对操作数 a、b，先把 a 作用在 existing 上再作用 b，
+// 与先用 Merge(key, a, b) 把两个操作数合成一个再作用在 existing 上结果相同。
+// 引擎据此把相邻的操作数提前合并，而不必保留每一个。Merge 可能被多个线程
+// 并发调用。
+class MergeOperator {
+ public:
+  virtual ~MergeOperator() = default;
+
+  // 把 operand 作用在 existing 上返回新值。existing 为 nullopt 表示 key
+  // 不存在或已被删除；existing 也可能是另一个（更旧的）操作数。与 Put 一致，
+  // 最终得到空值时等同于删除。
+  virtual std::string Merge(std::string_view key,
+                            std::optional<std::string_view> existing,
+                            std::string_view operand) const = 0;
+
+  virtual const char* Name() const = 0;
+};
+
+// 把从新到旧排列的 operands 依次作用在 base 上，返回最终的值。
+std::string FullMerge(const MergeOperator& op, std::string_view key,
+                      std::optional<std::string_view> base,
+                      const std::vector<std::string>& operands);
+// 没有更旧的值时把从新到旧排列的 operands 合成一个操作数，operands 非空。
+std::string PartialMerge(const MergeOperator& op, std::string_view key,
+                         const std::vector<std::string>& operands);
+
+// 从新到旧访问 it 当前 key 的各个版本（见 VisitVersions），把 Merge 操作数
+// 依次追加到 operands，直到遇到值或删除标记为止。遇到时返回 true，遇到的是
+// 值时 *base 指向它，只在 it 移动之前有效。
+template <KVIterator It>
+bool CollectMergeOperands(const It& it, std::vector<std::string>* operands,
+                          std::optional<std::string_view>* base) {
+  bool has_base = false;
+  VisitVersions(it, [&](std::string_view version) {
+    std::string_view payload;
+    switch (DecodeValue(version, &payload)) {
+      case ValueType::kMerge:
+        operands->emplace_back(payload);
+        return true;
+      case ValueType::kValue:
+        *base = payload;
+        break;
+      case ValueType::kDeletion:
+        break;
+    }
+    has_base = true;
+    return false;
+  });
+  return has_base;
+}
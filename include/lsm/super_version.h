@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "lsm/version.h"
+#include "memtable/memtable.h"
+
+// SuperVersion 把某一时刻读取所需的全部数据打包成一个不可变的快照：活跃的
+// memtable、已冻结等待刷盘的 memtable 和 SST 文件集合。读者原子地取得一份
+// 引用后不再持有任何锁；Flush 和 compaction 安装新的 SuperVersion，旧的在
+// 最后一个读者释放后销毁，其引用的 Version 中已删除的文件随之可以删除。
+struct SuperVersion {
+  // 仍在接受写入的 memtable
+  std::shared_ptr<MemTable> mem;
+  // 已冻结、正在刷盘的 memtable，从新到旧排列，不再有写入
+  std::vector<std::shared_ptr<MemTable>> imm;
+  std::shared_ptr<const Version> current;
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "consts.h"
+#include "sst/level_iterator.h"
+#include "utils/status.h"
+
+/*
+ * MANIFEST 是 VersionEdit 的日志, 每条记录:
+ * ------------------------------------------
+ * | Hash (32) | length (32) | VersionEdit |
+ * ------------------------------------------
+ * VersionEdit 由若干个字段组成, 每个字段以一个字节的 tag 开头:
+ * kLogNumber:      | tag | log_number (64) |
+ * kNextFileNumber: | tag | next_file_number (64) |
+ * kDeletedFile:    | tag | level (32) | sst_id (64) |
+ * kNewFile:        | tag | level (32) | sst_id (64) | file_size (64) |
+ *                  | first_key_len (32) | first_key | last_key_len (32) |
+ *                  | last_key |
+ * kNewFileEpoch:   同 kNewFile, 末尾追加 | epoch (64) |; 旧的 kNewFile 记录
+ *                  的 epoch 取 sst_id
+ * kNewFileTime:    同 kNewFileEpoch, 末尾再追加 | creation_time (64) |; 更旧
+ *                  的记录 creation_time 为 0
+ * kLastSequence:   | tag | last_sequence (64) |
+ * 回放时遇到长度不足或 Hash 不匹配的记录认为是写了一半的尾部, 之后的内容
+ * 被忽略。
+ */
+
+// VersionEdit 描述两个 Version 之间的差异：新增和删除的文件，以及已经
+// 持久化到 SST 的 WAL 位置。
+struct VersionEdit {
+  // log_number 之前的 WAL segment 中的数据都已经写入 SST
+  std::optional<uint64_t> log_number;
+  std::optional<uint64_t> next_file_number;
+  // 已经写入 SST 的最大序列号
+  std::optional<uint64_t> last_sequence;
+  // (level, sst_id)
+  std::vector<std::pair<size_t, size_t>> deleted_files;
+  // (level, meta)
+  std::vector<std::pair<size_t, LevelFileMeta>> new_files;
+
+  void AddFile(size_t level, LevelFileMeta meta) {
+    new_files.emplace_back(level, std::move(meta));
+  }
+  void DeleteFile(size_t level, size_t sst_id) {
+    deleted_files.emplace_back(level, sst_id);
+  }
+
+  std::string Encode() const;
+  // 解析失败时返回 false
+  static bool Decode(std::string_view src, VersionEdit* edit);
+};
+
+// Version 是某一时刻各层文件的不可变快照。L0 的文件按 epoch 从旧到新排列，
+// 最新的在尾部；L1 及以下每层按 first_key 升序排列且互不重叠。L0 的文件
+// 范围互相重叠，另外按 key 范围建一个区间索引，点查只访问包含 key 的文件。
+class Version {
+ public:
+  explicit Version(size_t num_levels = kNumLevels) : levels_(num_levels) {}
+
+  size_t num_levels() const { return levels_.size(); }
+  const std::vector<LevelFileMeta>& files(size_t level) const {
+    return levels_[level];
+  }
+  size_t num_files() const;
+  uint64_t level_size(size_t level) const;
+
+  // 把 L0 中 key 范围包含 key 的文件在 files(0) 中的下标按从新到旧的顺序
+  // 写入 result。
+  void L0FilesContaining(std::string_view key,
+                         std::vector<size_t>* result) const;
+
+ private:
+  friend class VersionBuilder;
+
+  // 在 VersionBuilder::Finish 中 L0 排好序之后调用
+  void BuildL0Index();
+  // 计算 [lo, hi) 子树的 l0_max_last_，返回其中 last_key 最大的文件下标
+  size_t BuildL0Subtree(size_t lo, size_t hi);
+  void QueryL0Index(std::string_view key, size_t lo, size_t hi,
+                    std::vector<size_t>* result) const;
+
+  std::vector<std::vector<LevelFileMeta>> levels_;
+  // L0 的区间索引：按 first_key 排序的文件下标构成一棵隐式的平衡二叉树，
+  // [lo, hi) 的根是中点，l0_max_last_[mid] 是子树中 last_key 最大的文件
+  // 下标。子树的最大 last_key 小于 key 时整棵子树都不包含 key。
+  std::vector<size_t> l0_by_first_key_;
+  std::vector<size_t> l0_max_last_;
+};
+
+// VersionBuilder 在一个 Version 上累积应用多个 VersionEdit，最后一次性生成
+// 新的 Version，恢复成千上万条 edit 时不会为每条 edit 复制整个 Version。
+class VersionBuilder {
+ public:
+  explicit VersionBuilder(const Version& base);
+
+  void Apply(const VersionEdit& edit);
+  std::shared_ptr<Version> Finish();
+
+ private:
+  struct LevelState {
+    // 按加入顺序排列，可能包含已删除的文件
+    std::vector<LevelFileMeta> files;
+    std::vector<size_t> deleted;
+  };
+  std::vector<LevelState> levels_;
+};
+
+// VersionSet 维护当前 Version 和 MANIFEST。启动时从 MANIFEST 恢复各层的
+// 文件列表（不打开任何 SST、不扫描目录），之后每次 LogAndApply 先把 edit
+// 追加到 MANIFEST 并落盘再安装新 Version。
+class VersionSet {
+ public:
+  explicit VersionSet(std::filesystem::path dir);
+  VersionSet(const VersionSet&) = delete;
+  VersionSet& operator=(const VersionSet&) = delete;
+  ~VersionSet();
+
+  // 回放 MANIFEST，不存在时从空 Version 开始。恢复后把当前状态写成一个新的
+  // MANIFEST 替换旧文件，避免日志无限增长。只有文件末尾写了一半或被置零的
+  // 记录会被忽略，此时截掉尾部而不重写；损坏的记录之后还有有效记录时返回
+  // Corruption。
+  Status Recover();
+
+  // 上次 Recover 是否忽略了不完整的尾部记录。此时可能有写好了 SST 但 edit
+  // 没有落盘的文件，调用方不应据此删除未被引用的文件。
+  bool recovered_torn_tail() const { return torn_tail_; }
+
+  // 把 edit 写入 MANIFEST 并 fdatasync，成功后安装新的 Version。
+  // edit 会被补上 next_file_number。
+  Status LogAndApply(VersionEdit* edit);
+
+  std::shared_ptr<const Version> current() const;
+
+  // 把当前 Version 以及仍被读者持有的旧 Version 引用的文件加入 live，
+  // 不在其中的文件可以安全删除。
+  void AddLiveFiles(std::unordered_set<size_t>* live);
+
+  // 分配一个新的 SST 文件编号
+  uint64_t NewFileNumber();
+  uint64_t log_number() const;
+  // 已经写入 SST 的最大序列号，之后的写入必须使用更大的序列号
+  uint64_t last_sequence() const;
+
+  std::filesystem::path ManifestPath() const;
+
+ private:
+  Status WriteSnapshot();
+  Status AppendRecord(const std::string& record);
+
+  std::filesystem::path dir_;
+
+  mutable std::mutex mutex_;
+  std::shared_ptr<const Version> current_;
+  // 安装过的所有 Version，过期的在 LogAndApply 时清理
+  std::vector<std::weak_ptr<const Version>> versions_;
+  uint64_t next_file_number_ = 0;
+  uint64_t log_number_ = 0;
+  uint64_t last_sequence_ = 0;
+  int manifest_fd_ = -1;
+  bool torn_tail_ = false;
+};
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <list>
 #include <shared_mutex>
+#include <span>
 #include <unordered_map>
 
 #include "../skiplist/skiplist.h"
+#include "utils/read_options.h"
+#include "utils/status.h"
 
 class MemTableIterator;
 // MemTable 负责维护内存中的有序 KV 数据，封装底层 SkipList，
@@ -14,9 +19,17 @@ class MemTable {
   MemTable();
   ~MemTable();
 
-  void Put(const std::string& key, const std::string& value);
+  // seq 不为 0 时计入 min_seq / max_seq，下同
+  void Put(const std::string& key, const std::string& value, uint64_t seq = 0);
   std::optional<std::string> Get(const std::string& key) const;
-  void Remove(const std::string& key);
+  // 与上面不同，删除标记也算命中：返回 OK 且 value 为空，调用方据此停止
+  // 向更旧的数据查找；完全没有该 key 时返回 NotFound。
+  Status Get(const std::string& key, std::string* value) const;
+  // 批量查找，活跃表和各冻结表依次用 SkipList::MultiGet 交错查找，
+  // 只有仍未命中的 key 才会继续查更旧的表。结果与 keys 一一对应。
+  std::vector<std::optional<std::string>> MultiGet(
+      std::span<const std::string> keys) const;
+  void Remove(const std::string& key, uint64_t seq = 0);
   void Clear();
   void Flush();
   void FrozenCurrentTable();
@@ -24,15 +37,26 @@ class MemTable {
   size_t current_size() const;
   size_t frozen_size() const;
   size_t total_size() const;
+  // 写入过的最小 / 最大序列号，没有带序列号的写入时 min_seq > max_seq
+  uint64_t min_seq() const;
+  uint64_t max_seq() const;
 
   MemTableIterator begin() const;
   MemTableIterator end() const;
+  // 只返回 options 上下界范围内记录的迭代器。
+  // keep_deletions 为 true 时迭代器也返回删除标记。
+  MemTableIterator NewIterator(const ReadOptions& options,
+                               bool keep_deletions = false) const;
 
  private:
   friend class MemTableIterator;
 
+  void RecordSeqLocked(uint64_t seq);
+
   std::shared_ptr<SkipList> table_;
   std::list<std::shared_ptr<SkipList>> frozen_tables_;
   size_t frozen_bytes_;
+  uint64_t min_seq_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_seq_ = 0;
   mutable std::shared_mutex rw_mutex_;
 };
\ No newline at end of file
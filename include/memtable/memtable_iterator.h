@@ -1,24 +1,50 @@
 #pragma once
 
-#include <queue>
+#include <memory>
+#include <string>
+#include <string_view>
 
 #include "iterator/iterator.h"
+#include "iterator/merge_iterator.h"
 #include "memtable/memtable.h"
 #include "skiplist/skiplist.h"
 
-
-
 // MemTableIterator 以 key 有序的方式遍历 MemTable 中所有活跃/冻结 SkipList
 // 合并后的 KV 记录，作为上层顺序读和刷盘的统一入口。
-class MemTableIterator : public BaseIterator {
+// 每个 SkipList 一个子迭代器，持有 SkipList 和当前节点的 shared_ptr 在跳表
+// 上原地遍历，用 MergeIterator 合并，不拷贝数据。构造后 MemTable 冻结或
+// 新建的 SkipList 不在遍历范围内；遍历期间对活跃表的并发写入可能看到也可能
+// 看不到。
+class MemTableIterator final : public BaseIterator {
  public:
   // 默认构造一个 end 迭代器。
   MemTableIterator();
   // 从给定 MemTable 构造迭代器，指向合并后所有表的第一个 key。
   MemTableIterator(const MemTable& memtable);
+  // 只返回 options 上下界范围内的记录。keep_deletions 为 true 时保留删除
+  // 标记（空 value），供刷盘和与更旧的数据归并时遮蔽旧版本。
+  // 调用方需持有 memtable 的读锁。
+  MemTableIterator(const MemTable& memtable, const ReadOptions& options,
+                   bool keep_deletions = false);
 
-  // 解引用得到当前最小 key 对应的 (key, value) 对。
-  std::pair<std::string, std::string> operator*() const override;
+  bool Valid() const override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  // 移动到第一个 key >= target 的记录，不存在时指向 end 并返回 NotFound。
+  Status Seek(std::string_view target) override;
+  // 移动到最后一个 key <= target 的记录，不存在时指向 end 并返回 NotFound。
+  Status SeekForPrev(std::string_view target) override;
+  void Next() override;
+  void Prev() override;
+  // key()/value() 指向 SkipList 节点内的数据，在下一次移动迭代器之前有效。
+  std::string_view key() const override;
+  std::string_view value() const override;
+
+  // 按从新到旧的顺序访问当前 key 在各 SkipList 中的版本，见 VisitVersions。
+  template <typename Visitor>
+  bool ForEachVersion(Visitor& visit) const {
+    return iter_.ForEachVersion(visit);
+  }
 
   // 前置 ++，推进到下一条合并后的记录。
   MemTableIterator& operator++();
@@ -27,11 +53,35 @@ class MemTableIterator : public BaseIterator {
 
   bool operator==(const MemTableIterator& other) const;
   bool operator!=(const MemTableIterator& other) const;
-  // 判断是否已经遍历完所有活跃/冻结 SkipList。
-  bool IsEnd() const override;
 
  private:
-  std::priority_queue<SearchItem, std::vector<SearchItem>,
-                      std::greater<SearchItem>>
-      items_;
+  // 在一个 SkipList 上原地遍历
+  class TableIterator {
+   public:
+    explicit TableIterator(std::shared_ptr<const SkipList> table);
+
+    bool Valid() const { return node_ != nullptr; }
+    void SeekToFirst();
+    void SeekToLast();
+    Status Seek(std::string_view target);
+    Status SeekForPrev(std::string_view target);
+    void Next();
+    void Prev();
+    std::string_view key() const { return node_->key; }
+    std::string_view value() const { return node_->value; }
+
+   private:
+    std::shared_ptr<const SkipList> table_;
+    std::shared_ptr<const SkipListNode> node_;
+  };
+
+  // 当前记录是否在上下界范围内
+  bool InRange() const;
+  // 不保留删除标记时，沿 forward 方向跳过删除标记
+  void SkipDeletions(bool forward);
+
+  // 下标越小的表越新：活跃表在前，之后是从新到旧的冻结表
+  MergeIterator<TableIterator> iter_;
+  ReadOptions options_;
+  bool keep_deletions_ = false;
 };
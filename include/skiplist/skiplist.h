@@ -6,14 +6,23 @@
 #include <optional>
 #include <random>
 #include <shared_mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "utils/interleave.h"
+
+// 节点链入跳表后 key 和 value 不再修改（Put 已有的 key 时换成新节点），
+// 持有节点的 shared_ptr 即可在没有锁的情况下读取它们。
 struct SkipListNode {
   std::string key;
   std::string value;
   // 不同层级的下一个节点指针
   std::vector<std::shared_ptr<SkipListNode>> forward;
+  // 最底层的前一个节点，第一个节点为空；用 weak_ptr 避免与 forward 成环
+  std::weak_ptr<SkipListNode> backward;
 
   SkipListNode(const std::string &k, const std::string &v, int level)
       : key(k), value(v), forward(level, nullptr) {}
@@ -29,7 +38,8 @@ class SkipListIterator {
 
   // SkipListIterator() : current_(nullptr), lock(nullptr) {}
 
-  explicit SkipListIterator(std::shared_ptr<SkipListNode> node) : current_(node) {}
+  explicit SkipListIterator(std::shared_ptr<const SkipListNode> node)
+      : current_(std::move(node)) {}
   
   SkipListIterator() : current_(nullptr) {}
 
@@ -39,16 +49,22 @@ class SkipListIterator {
 
   SkipListIterator operator++(int);
 
+  // 沿 backward 指针回退一个节点，越过第一个节点后等于 end()。
+  SkipListIterator &operator--();
+
+  SkipListIterator operator--(int);
+
   bool operator==(const SkipListIterator &other) const;
 
   bool operator!=(const SkipListIterator &other) const;
 
-  std::string key() const;
-  std::string value() const;
+  // key()/value() 指向节点内的数据，节点被迭代器持有期间有效
+  std::string_view key() const;
+  std::string_view value() const;
   bool valid() const;
 
  private:
-  std::shared_ptr<SkipListNode> current_;
+  std::shared_ptr<const SkipListNode> current_;
 
   // 迭代有效期间持有整个skiplist的读锁
   // std::shared_ptr<std::shared_lock<std::shared_mutex>> lock;
@@ -56,6 +72,9 @@ class SkipListIterator {
 
 // SkipList 是一个支持按 key 有序插入/查询/删除的跳表实现，
 // 作为 MemTable 底层的数据结构，用于维护内存中的有序 KV 集合。
+// 写入持有跳表的写锁；Seek 系列和 NextNode/PrevNode 持有读锁，可以与写入
+// 并发，供迭代器原地遍历。Get/MultiGet/Flush 不加锁，由 MemTable 的锁保证
+// 没有并发写入。
 class SkipList {
  public:
   explicit SkipList(int max_level);
@@ -71,6 +90,18 @@ class SkipList {
 
   std::optional<std::string> Get(const std::string &key) const;
 
+  // 批量查找：多个 key 的查找以协程方式交错执行，每次下探前先预取下一个
+  // 节点，再预取它的 key 和 forward 数组，每次预取后让出，以隐藏指针追逐
+  // 带来的 cache miss。结果与 keys 一一对应。
+  std::vector<std::optional<std::string>> MultiGet(
+      std::span<const std::string> keys,
+      size_t group_size = kDefaultInterleaveGroupSize) const;
+  // 只查找 keys 中下标在 indices 里的 key，结果与 indices 一一对应，
+  // 不拷贝 key。
+  std::vector<std::optional<std::string>> MultiGet(
+      std::span<const std::string> keys, std::span<const size_t> indices,
+      size_t group_size = kDefaultInterleaveGroupSize) const;
+
   // 删除(置空的话要使用Put)
   void Remove(const std::string &key);
 
@@ -84,10 +115,36 @@ class SkipList {
   SkipListIterator begin() const;
   SkipListIterator end() const;
 
+  // 返回指向第一个 key >= target 的节点的迭代器，不存在时返回 end()。
+  SkipListIterator Seek(const std::string &target) const;
+  // 返回指向最后一个 key <= target 的节点的迭代器，不存在时返回 end()。
+  SkipListIterator SeekForPrev(const std::string &target) const;
+  // 返回指向最后一个节点的迭代器，跳表为空时返回 end()。
+  SkipListIterator SeekToLast() const;
+
+  // 与上面的 begin/Seek/SeekForPrev/SeekToLast 相同，但直接返回节点，
+  // 不存在时返回空。
+  std::shared_ptr<const SkipListNode> FirstNode() const;
+  std::shared_ptr<const SkipListNode> SeekNode(std::string_view target) const;
+  std::shared_ptr<const SkipListNode> SeekForPrevNode(
+      std::string_view target) const;
+  std::shared_ptr<const SkipListNode> LastNode() const;
+  // node 在最底层的下一个 / 上一个节点，不存在时返回空。node 可能已被并发的
+  // 写入替换或摘除，此时仍能继续遍历，但不保证看到遍历期间写入的数据。
+  std::shared_ptr<const SkipListNode> NextNode(const SkipListNode &node) const;
+  std::shared_ptr<const SkipListNode> PrevNode(const SkipListNode &node) const;
+
  private:
   // 生成的新节点的随机层数
   int random_level();
 
+  // 返回最后一个 key < target 的节点，不存在时返回头节点。
+  std::shared_ptr<SkipListNode> FindLessThan(std::string_view target) const;
+
+  // Get 的可挂起版本，供 MultiGet 交错调度。
+  InterleavedTask<std::optional<std::string>> GetInterleaved(
+      std::string_view key) const;
+
   // 头节点，不存放数据
   std::shared_ptr<SkipListNode> head_;
   // 最大层级数
@@ -96,6 +153,6 @@ class SkipList {
   int current_level_;
   // 跳表当前所占字节数
   size_t size_bytes_ = 0;
-  
-  // mutable std::shared_mutex rw_mutex_;
+
+  mutable std::shared_mutex rw_mutex_;
 };
\ No newline at end of file
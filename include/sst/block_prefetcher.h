@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "block/block.h"
+#include "utils/thread_pool.h"
+
+class SST;
+
+// BlockPrefetcher 在后台线程池中提前读取并解码扫描即将用到的 block，
+// 结果放入 SST 的 block cache，使 I/O 和解码与扫描线程的处理重叠。
+// 同一个 block 同时只会有一个读取任务；扫描线程取 block 时若该 block
+// 正在预读则等待其完成，而不是重复读取。多个迭代器（例如多路归并中的
+// 各个 SstIterator）可以共享同一个 BlockPrefetcher。
+class BlockPrefetcher {
+ public:
+  explicit BlockPrefetcher(size_t num_threads);
+
+  // 异步预读第 block_idx 个 block。SST 没有 block cache、block 已在缓存中
+  // 或正在读取时直接返回。
+  void Prefetch(const std::shared_ptr<SST>& sst, size_t block_idx);
+
+  // 取得第 block_idx 个 block：正在预读时等待结果，否则同步读取（通过
+  // block cache）。读取失败的异常在这里重新抛出。
+  std::shared_ptr<Block> Fetch(const std::shared_ptr<SST>& sst,
+                               size_t block_idx);
+
+ private:
+  using Key = std::pair<size_t, size_t>;
+
+  std::mutex mutex_;
+  // 正在读取中的 block，读取完成并放入缓存后删除
+  std::map<Key, std::shared_future<std::shared_ptr<Block>>> inflight_;
+  // 放在最后，析构时先等待所有任务结束，再销毁它们访问的成员
+  ThreadPool pool_;
+};
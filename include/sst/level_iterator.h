@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "iterator/iterator.h"
+#include "sst/sst.h"
+#include "sst/sst_iterator.h"
+#include "utils/read_options.h"
+#include "utils/status.h"
+
+// LevelFileMeta 描述一层中的一个 SST 文件，只包含定位所需的 key 范围和
+// 文件大小，不需要打开文件即可构造，也会记录在 MANIFEST 中。
+struct LevelFileMeta {
+  size_t sst_id;
+  std::string first_key;
+  std::string last_key;
+  uint64_t file_size = 0;
+  // 数据的新旧次序，L0 按它从旧到新排列。Flush 的文件取 sst_id，
+  // compaction 的输出继承输入中最大的 epoch
+  uint64_t epoch = 0;
+  // 数据写入的时间（秒），FIFO compaction 据此判断是否过期。Flush 的文件取
+  // SST properties 中的 creation_time，合并的输出继承输入中最大的值；为 0
+  // 表示未知
+  uint64_t creation_time = 0;
+
+  // epoch 取 sst_id，creation_time 取 properties 中的值
+  static LevelFileMeta FromSst(const SST& sst);
+};
+
+// 按 sst_id 打开 SST，由调用方决定是从缓存中取还是打开并 mmap 文件。
+using SstOpener = std::function<std::shared_ptr<SST>(size_t sst_id)>;
+
+// LevelIterator 顺序遍历一组按 key 有序且互不重叠的 SST（L1 及以下的一层，
+// 或 compaction 的一路输入）。任意时刻只打开一个 SstIterator：Seek 时按文件
+// 的 key 范围二分查找目标文件，遍历到文件末尾（反向时为开头）时才通过
+// opener 打开相邻的文件，
+// 因此一层有成千上万个文件时也不需要提前打开它们。
+class LevelIterator final : public BaseIterator {
+ public:
+  // files 必须按 first_key 升序排列且 key 范围互不重叠。构造后指向第一条记录。
+  // 整个落在 options 上下界之外的文件不会被打开。
+  LevelIterator(std::vector<LevelFileMeta> files, SstOpener opener,
+                const ReadOptions& options = {});
+
+  bool Valid() const override;
+  void SeekToFirst() override;
+  void SeekToLast() override;
+  // 移动到第一个 key >= target 的记录，不存在时指向 end 并返回 NotFound。
+  Status Seek(std::string_view target) override;
+  // 移动到最后一个 key <= target 的记录，不存在时指向 end 并返回 NotFound。
+  Status SeekForPrev(std::string_view target) override;
+  void Next() override;
+  void Prev() override;
+  std::string_view key() const override;
+  std::string_view value() const override;
+
+  // 当前打开的文件下标，等于文件数时表示 end。
+  size_t file_idx() const { return file_idx_; }
+
+ private:
+  // 打开第 idx 个文件但不定位，idx 越界时置为 end 并返回 false
+  bool OpenFile(size_t idx);
+  // 当前文件遍历完时依次打开后面的文件，直到找到一条记录或到达 end
+  void SkipEmptyFiles();
+  // 反向遍历时的 SkipEmptyFiles：依次打开前面的文件并定位到最后一条
+  void SkipEmptyFilesBackward();
+  void SetEnd();
+
+  std::vector<LevelFileMeta> files_;
+  SstOpener opener_;
+  ReadOptions options_;
+  size_t file_idx_ = 0;
+  // 当前文件上的迭代器，同一时刻只持有一个
+  SstIterator sst_iter_;
+};
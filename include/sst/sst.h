@@ -1,16 +1,22 @@
 #pragma once
 
 /*
- * ------------------------------------------------------------------------
- * |         Block Section         |  Meta Section |       Extra          |
- * ------------------------------------------------------------------------
- * | data block | ... | data block |    metadata   | metadata offset (64) |
- * ------------------------------------------------------------------------
+ * -----------------------------------------------------------------------------
+ * |         Block Section         |  Meta Section | Properties Section | Extra |
+ * -----------------------------------------------------------------------------
+ * | data block | ... | data block |    metadata   |     properties     | footer|
+ * -----------------------------------------------------------------------------
+
+ * footer 随格式版本不同而不同:
+ * v1: | meta offset (32) |
+ * v2: | meta offset (64) | version (32) | magic (64) |
+ * 打开文件时先检查末尾 8 字节是否为 kSstMagic, 是则按 footer 中的版本解析,
+ * 否则按 v1 解析。v3 的 footer 与 v2 相同。
 
  * 其中, metadata 是一个数组加上一些描述信息, 数组每个元素由一个 BlockMeta
  编码形成 MetaEntry, MetaEntry 结构如下:
  * ---------------------------------------------------------------------------------------------------
- * | offset(32) | 1st_key_len(16) | 1st_key(1st_key_len) | last_key_len(16) |
+ * | offset(32/64) | 1st_key_len(16) | 1st_key(1st_key_len) | last_key_len(16) |
  last_key(last_key_len) |
  * ---------------------------------------------------------------------------------------------------
 
@@ -20,17 +26,31 @@
  * ---------------------------------------------------------------
  * 其中, num_entries 表示 metadata 数组的长度, Hash 是 metadata
  数组的哈希值(只包括数组部分, 不包括 num_entries ), 用于校验 metadata 的完整性
+
+ * Properties Section 的结构见 sst/table_properties.h。旧文件没有该段,
+ * Meta Section 之后直接就是 footer, 此时 properties 保持默认值。
  */
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "block/block.h"
+#include "block/block_cache.h"
 #include "block/block_meta.h"
+#include "sst/table_properties.h"
 #include "utils/file.h"
+#include "utils/rate_limiter.h"
+#include "utils/status.h"
 
 class SstIterator;
 
+// v2 及以后格式 footer 末尾的 magic number。
+constexpr uint64_t kSstMagic = 0x88e241b785f4cff7ULL;
+// v2 footer 字节数: meta offset(64) + version(32) + magic(64)。
+constexpr size_t kSstFooterSizeV2 =
+    sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
 // SST 表示一个已经落盘的 SSTable 文件视图，负责：
 // - 按 block 读取数据；
 // - 根据 key 在元数据中定位所属 block；
@@ -39,10 +59,14 @@ class SST : public std::enable_shared_from_this<SST> {
  public:
   // SSTBuilder 负责构建 SST 文件，需要直接访问 SST 的私有成员。
   friend class SSTBuilder;
+  friend class SstIterator;
 
   // 从已经存在的文件句柄中打开一个 SST。
-  // 会读取文件尾部的 meta offset，再解析 Meta Section 得到 BlockMeta 数组。
-  static SST Open(size_t sst_id, File file);
+  // 会读取文件尾部的 footer 得到格式版本和 meta offset，
+  // 再解析 Meta Section 得到 BlockMeta 数组。v1 文件同样可以打开。
+  // block_cache 不为空时 ReadBlock 先查缓存，读取的 block 也会放入缓存。
+  static SST Open(size_t sst_id, File file,
+                  std::shared_ptr<BlockCache> block_cache = nullptr);
 
   // 仅根据元数据信息构造一个逻辑上的 SST 描述（不真正读取文件内容）。
   // 通常用于仅依赖 first/last key 和文件大小的场景，比如元信息索引。
@@ -50,16 +74,37 @@ class SST : public std::enable_shared_from_this<SST> {
                                 std::string_view first_key,
                                 std::string_view last_key);
 
-  // 根据 block 的索引读取并解码指定的数据块。
+  // 根据 block 的索引读取并解码指定的数据块，设置了 block cache 时优先从
+  // 缓存中取。可以被多个线程并发调用。
   std::shared_ptr<Block> ReadBlock(size_t block_idx);
 
-  // 在元数据中根据 key 二分查找其所在的 block 下标。
-  // 若 key 超出整个 SST 的 key 范围，会抛出 std::runtime_error。
-  size_t FindBlockIdx(std::string_view key);
+  // 返回该 SST 使用的 block cache，没有时为空。
+  const std::shared_ptr<BlockCache>& block_cache() const {
+    return block_cache_;
+  }
+
+  // 在元数据中二分查找第一个可能包含 >= key 的记录的 block，即第一个
+  // last_key >= key 的 block 下标；key 大于整个 SST 的最大 key 时返回
+  // num_blocks()。
+  size_t FindBlockIdx(std::string_view key) const;
+
+  // 在元数据中二分查找最后一个可能包含 <= key 的记录的 block，即最后一个
+  // first_key <= key 的 block 下标；key 小于整个 SST 的最小 key 时返回
+  // num_blocks()。
+  size_t FindBlockIdxForPrev(std::string_view key) const;
+
+  // 点查 key，不存在时返回 NotFound 而不抛异常；命中时写入 value 并返回
+  // OK，value 为空表示删除标记。只有数据损坏时才会抛出异常。
+  // 与 SstIterator 一致，v3 之前的文件中的值转成 value_encoding.h 的编码
+  // 后返回。
+  Status Get(std::string_view key, std::string* value);
 
   // 返回 SST 中包含的 block 数量。
   size_t num_blocks() const { return meta_entries_.size(); }
 
+  // 返回每个 block 的元信息，按 key 有序，可用于估算数据分布和切分范围。
+  const std::vector<BlockMeta>& block_metas() const { return meta_entries_; }
+
   // 返回整个 SST 的最小 key（第一个 block 的 first_key_）。
   std::string_view first_key() const { return first_key_; }
 
@@ -72,7 +117,21 @@ class SST : public std::enable_shared_from_this<SST> {
   // 返回 SST 的标识 id。
   size_t sst_id() const { return sst_id_; }
 
-  SstIterator Iterator(const std::string& key);
+  // 返回文件的磁盘格式版本。
+  uint32_t format_version() const { return format_version_; }
+
+  // 文件中的 value 是否已按 value_encoding.h 编码，否则保存的是原始的值。
+  bool values_encoded() const { return format_version_ >= kFormatV3; }
+
+  // 返回 SSTBuilder 写入的统计信息；旧格式文件没有该段，返回默认值。
+  const TableProperties& properties() const { return properties_; }
+
+  // 设置文件映射的访问模式：compaction 输入等整文件顺序读使用 kSequential，
+  // 以点查为主的文件使用 kRandom 关闭内核预读。
+  void SetAccessHint(AccessHint hint) { file_.Advise(hint); }
+
+  // 返回指向第一个 key >= 给定 key 的迭代器，不存在时返回 end()。
+  SstIterator Iterator(std::string_view key);
 
   SstIterator begin();
 
@@ -80,30 +139,50 @@ class SST : public std::enable_shared_from_this<SST> {
   
 
  private:
+  // 第 block_idx 个 block（含校验和）在文件中的结束偏移。
+  uint64_t BlockEnd(size_t block_idx) const;
+  // 提示内核预读 [begin, end) 范围内的 block。
+  void PrefetchBlocks(size_t begin, size_t end);
+
   // 底层文件封装，负责 mmap/读取原始字节。
   File file_;
   // 每个 block 的元信息（偏移量、首尾 key）。
   std::vector<BlockMeta> meta_entries_;
   // Meta Section 在文件中的起始偏移（Block Section 的总长度）。
-  uint32_t meta_block_offset_;
+  uint64_t meta_block_offset_;
+  // 文件的磁盘格式版本，决定 Block / BlockMeta 中偏移的宽度。
+  uint32_t format_version_ = kLatestFormatVersion;
   // SST 的唯一标识。
   size_t sst_id_;
   // 整个 SST 范围内的最小 / 最大 key。
   std::string first_key_;
   std::string last_key_;
+  // 文件的统计信息。
+  TableProperties properties_;
+  // 解码后的 block 缓存，可为空。
+  std::shared_ptr<BlockCache> block_cache_;
 };
 
 // SSTBuilder 负责将一串有序的 KV 流切分成若干 Block，
 // 编码并写出到磁盘，最终生成一个可被 SST 打开的 SSTable 文件。
 class SSTBuilder {
  public:
-  // 指定目标 block 大小（字节），用于控制何时切分 block。
-  explicit SSTBuilder(size_t block_size);
+  // 指定目标 block 大小（字节），用于控制何时切分 block，
+  // 以及写出的磁盘格式版本（默认最新版本）。
+  explicit SSTBuilder(size_t block_size,
+                      uint32_t format_version = kLatestFormatVersion);
 
   // 向当前 SST 中追加一条有序的 key/value 记录。
   // 若当前 block 容量不足，会先 FinishBlock 再开启新 block。
   void Add(std::string_view key, std::string_view value);
 
+  // 同 Add，并把 seq 计入 properties 中的序列号范围。
+  void Add(std::string_view key, std::string_view value, uint64_t seq);
+
+  // 把 [min_seq, max_seq] 计入 properties 中的序列号范围，用于只知道整批
+  // 记录的序列号范围的场景（Flush、compaction）。min_seq > max_seq 时忽略。
+  void AddSeqRange(uint64_t min_seq, uint64_t max_seq);
+
   // 将当前正在构建的 block 封板：
   // - 调用 Block::Encode 得到字节序列；
   // - 追加到 data_；
@@ -113,8 +192,16 @@ class SSTBuilder {
   // 估算当前已经累积的 Block Section 大小（不含元数据）。
   size_t estimated_size() const { return data_.size(); }
 
+  // Build 写文件时经过 rate_limiter 限速，不设置时不限速。
+  void SetRateLimiter(std::shared_ptr<RateLimiter> rate_limiter,
+                      IOPriority priority) {
+    rate_limiter_ = std::move(rate_limiter);
+    io_priority_ = priority;
+  }
+
   // 将内存中的数据编码并写入 SST 文件，返回构造好的 SST 视图。
-  SST Build(size_t sst_id, std::string_view path);
+  SST Build(size_t sst_id, std::string_view path,
+            std::shared_ptr<BlockCache> block_cache = nullptr);
 
  private:
   // 正在写入的 block。
@@ -128,6 +215,13 @@ class SSTBuilder {
   std::vector<uint8_t> data_;
   // 目标 block 大小（字节）。
   size_t block_size_;
+  // 写出的磁盘格式版本。
+  uint32_t format_version_;
   // 记录所有 key 的哈希值，后续可用于构建 BloomFilter 等结构。
   std::vector<uint32_t> key_hashes_;
+  // 构建过程中累计的统计信息。
+  TableProperties properties_;
+  // 写文件时的限速器及优先级。
+  std::shared_ptr<RateLimiter> rate_limiter_;
+  IOPriority io_priority_ = IOPriority::kLow;
 };
@@ -1,52 +1,102 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <string_view>
 
 #include "block/block_iterator.h"
 #include "iterator/iterator.h"
+#include "utils/read_options.h"
+#include "utils/status.h"
 
 class SST;
 
 // SstIterator 负责在单个 SST 内跨多个 Block 顺序遍历或从指定 key 开始
 // 遍历 KV 记录，是连接 SST 与上层查询逻辑的迭代器封装。
-class SstIterator : public BaseIterator {
+// key()/value() 指向当前 Block 的数据区，在移动到下一条记录前有效。
+class SstIterator final : public BaseIterator {
  public:
   friend class SST;
+  friend class LevelIterator;
   using value_type = std::pair<std::string, std::string>;
 
   // 基于给定 SST 构造迭代器，并指向该 SST 的第一个 key。
   explicit SstIterator(std::shared_ptr<SST> sst);
 
   // 基于给定 SST 构造迭代器，并定位到大于等于 key 的第一个位置。
-  SstIterator(std::shared_ptr<SST> sst, const std::string& key);
+  SstIterator(std::shared_ptr<SST> sst, std::string_view key);
+
+  // 基于给定 SST 构造带上下界的迭代器，并指向范围内的第一个 key。
+  // 遍历时根据 BlockMeta 的首尾 key 判断，整个落在范围外的 block 不会被读取。
+  SstIterator(std::shared_ptr<SST> sst, const ReadOptions& options);
+
+  bool Valid() const override;
 
   // 将迭代器移动到 SST 中的第一个 key。
-  void SeekFirst();
+  void SeekToFirst() override;
+
+  // 将迭代器移动到 SST 中的最后一个 key。
+  void SeekToLast() override;
+
+  // 将迭代器移动到大于等于指定 key 的第一个位置。没有这样的记录时返回
+  // NotFound 且迭代器为 end，不抛异常；只有读取到损坏的 block 时才会抛出异常。
+  Status Seek(std::string_view key) override;
 
-  // 将迭代器移动到大于等于指定 key 的第一个位置。
-  void Seek(const std::string& key);
+  // 将迭代器移动到小于等于指定 key 的最后一个位置，没有这样的记录时返回
+  // NotFound 且迭代器为 end。
+  Status SeekForPrev(std::string_view key) override;
 
-  // 判断是否已经遍历完该 SST（到达 end）。
-  bool IsEnd() const override;
+  // 在当前 Block 内前进，必要时跳到下一个 Block。
+  void Next() override;
 
-  // 返回当前 entry 的 key，若迭代器无效会抛出异常。
-  std::string key();
-  // 返回当前 entry 的 value，若迭代器无效会抛出异常。
-  std::string value();
+  // 在当前 Block 内后退，必要时跳到上一个 Block 的最后一条。
+  void Prev() override;
 
-  // 前置 ++，在当前 Block 内前进，必要时跳到下一个 Block。
+  // 返回当前 entry 的 key / value，若迭代器无效会抛出异常。v3 之前的文件
+  // 中需要转义的值转成 value_encoding.h 的编码后返回。
+  std::string_view key() const override;
+  std::string_view value() const override;
+
+  // 前置 ++，等价于 Next()。
   SstIterator& operator++();
   // 后置 ++，返回推进前的迭代器副本。
   SstIterator operator++(int);
 
   bool operator==(const SstIterator& other) const;
   bool operator!=(const SstIterator& other) const;
-  
-  // 解引用得到当前 entry 的 (key, value) 对，若迭代器无效会抛出异常。
-  value_type operator*() const override;
-  
+
  private:
+  // 将迭代器置为 end 状态。
+  void SetEnd();
+  // 换到另一个 SST 上并置为 end，不读取任何 block，保留上下界。
+  void Reset(std::shared_ptr<SST> sst);
+  // 读取第 idx 个 block，并根据它的首尾 key 判断是否需要逐条检查上下界
+  void LoadBlock(size_t idx);
+  // 当前记录越过上下界时置为 end
+  void CheckBounds();
+  // 不考虑上下界的 Seek / SeekForPrev
+  void SeekRaw(std::string_view key);
+  void SeekForPrevRaw(std::string_view key);
+  // Next 顺序进入第 idx 个 block 时调用，检测到顺序扫描后预读后面的 block
+  void Readahead(size_t idx);
+  // 随机定位后重新开始检测顺序访问
+  void ResetReadahead();
+  // 设置了预读器时，提交第 idx 个 block 之后若干 block 的后台读取
+  void PrefetchAfter(size_t idx);
+
   std::shared_ptr<SST> sst_;
   size_t block_idx_;
-  std::shared_ptr<BlockIterator> block_iter_;
+  // 当前 block 上的迭代器，迭代器为 end 时不指向任何 block
+  BlockIterator block_iter_;
+  ReadOptions options_;
+  // 当前 block 是否整个落在上界 / 下界之内，是则块内不必逐条比较
+  bool within_upper_ = true;
+  bool within_lower_ = true;
+  // 自上次随机定位以来 Next 连续顺序跨越 block 的次数
+  size_t sequential_blocks_ = 0;
+  // 当前预读窗口的 block 数，以及已预读到的 block 下标（不含）
+  size_t readahead_blocks_ = 0;
+  size_t readahead_limit_ = 0;
+  // 旧格式文件中转义后的当前 value
+  mutable std::string escaped_value_;
 };
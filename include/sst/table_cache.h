@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "block/block_cache.h"
+#include "sst/level_iterator.h"
+#include "sst/sst.h"
+#include "utils/status.h"
+
+// TableCache 管理目录下已打开的 SST。文件在第一次被访问时才打开并解析
+// Meta Section，启动时只需要 MANIFEST 中的 key 范围，不必打开任何文件。
+// 可以被多个线程并发访问。
+class TableCache {
+ public:
+  TableCache(std::filesystem::path dir,
+             std::shared_ptr<BlockCache> block_cache = nullptr);
+  TableCache(const TableCache&) = delete;
+  TableCache& operator=(const TableCache&) = delete;
+
+  std::filesystem::path SstPath(size_t sst_id) const;
+  // SstPath 的逆过程：文件名是 SST 时返回 true 并设置 sst_id
+  static bool ParseSstFileName(const std::filesystem::path& path,
+                               size_t* sst_id);
+
+  const std::shared_ptr<BlockCache>& block_cache() const {
+    return block_cache_;
+  }
+
+  // 返回 sst_id 对应的 SST，尚未打开时打开文件；文件不存在或损坏时抛出异常。
+  std::shared_ptr<SST> Get(size_t sst_id);
+
+  // 放入刚构建好的 SST（Flush 或 compaction 的输出），之后不必重新打开。
+  void Insert(std::shared_ptr<SST> sst);
+
+  // 关闭 sst_id 对应的文件，正在使用它的迭代器不受影响。
+  void Evict(size_t sst_id);
+
+  // 用 num_threads 个线程并行打开 ids 中尚未打开的文件，返回第一个错误。
+  Status OpenAll(const std::vector<size_t>& ids, size_t num_threads);
+
+  // 供 LevelIterator 使用的打开函数，不能比 TableCache 活得更久。
+  SstOpener opener();
+
+  size_t num_open() const;
+
+ private:
+  std::filesystem::path dir_;
+  std::shared_ptr<BlockCache> block_cache_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<size_t, std::shared_ptr<SST>> tables_;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+/*
+ * Properties Section 紧跟在 Meta Section 之后, 结构如下:
+ * ---------------------------------------------------------------
+ * | num_fields (32) | field (64) | ... | field (64) | Hash (32) |
+ * ---------------------------------------------------------------
+ * 字段按 TableProperties 中声明的顺序排列, num_fields 用于兼容以后追加的
+ * 新字段: 解码时只读取已知的字段, 多出来的忽略, 缺少的保持默认值。
+ * Hash 覆盖所有 field 字节, 用于校验完整性。
+ */
+
+// TableProperties 记录一个 SST 的统计信息, 由 SSTBuilder 在构建时收集并写入
+// 文件, SST::Open 时解析, 供 compaction 选择和容量估算使用, 无需读取数据块。
+struct TableProperties {
+  // 记录条数(包括删除标记)
+  uint64_t num_entries = 0;
+  // 删除标记(空 value)的条数
+  uint64_t num_deletions = 0;
+  // 所有 key / value 的原始字节数
+  uint64_t raw_key_size = 0;
+  uint64_t raw_value_size = 0;
+  // Block Section 编码后的字节数
+  uint64_t data_size = 0;
+  // 过滤器(如 BloomFilter)所占字节数, 没有过滤器时为 0
+  uint64_t filter_size = 0;
+  // 文件中记录的最小 / 最大序列号, 没有序列号时 min_seq > max_seq
+  uint64_t min_seq = std::numeric_limits<uint64_t>::max();
+  uint64_t max_seq = 0;
+  // 文件创建时间(Unix 时间戳, 秒)
+  uint64_t creation_time = 0;
+
+  bool operator==(const TableProperties&) const = default;
+
+  // 原始 KV 字节数与编码后数据字节数之比, data_size 为 0 时返回 1.0
+  double compression_ratio() const;
+
+  std::vector<uint8_t> Encode() const;
+
+  // 解析 Properties Section, 哈希校验失败或长度不足时抛出 std::runtime_error
+  static TableProperties Decode(std::span<const uint8_t> encoded);
+};
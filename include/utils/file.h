@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "utils/mmap_file.h"
+#include "utils/rate_limiter.h"
 
 // File 封装基于 MMapFile 的文件读写接口，负责创建/打开 SST 文件，
 // 提供按偏移读取指定字节切片的能力。
@@ -24,13 +25,24 @@ class File {
 
   void set_size(size_t size);
 
+  // 创建文件并写入 buf。rate_limiter 不为空时按它的补充周期分段写出，
+  // 每段先申请令牌，写完立即同步到磁盘，使实际的磁盘写入也受限速约束。
   static File CreateAndWrite(std::string_view path,
-                             std::span<const uint8_t> buf);
+                             std::span<const uint8_t> buf,
+                             RateLimiter* rate_limiter = nullptr,
+                             IOPriority priority = IOPriority::kLow);
 
+  // 以只读方式打开并映射已有文件。
   static File Open(std::string_view path);
 
   std::vector<uint8_t> ReadToSlice(size_t offset, size_t length);
 
+  // 设置整个文件的访问模式提示，失败时忽略（只影响性能）。
+  void Advise(AccessHint hint);
+
+  // 提示内核异步预读 [offset, offset + length)，失败时忽略。
+  void Prefetch(size_t offset, size_t length);
+
  private:
   std::unique_ptr<MMapFile> file_;
   size_t size_;
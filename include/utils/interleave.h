@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// 批量查找时一次交错执行的默认协程个数。
+constexpr size_t kDefaultInterleaveGroupSize = 8;
+
+// 预取 addr 所在的 cache line，只读且尽量保留在各级缓存中。
+inline void PrefetchForRead(const void* addr) {
+  __builtin_prefetch(addr, 0, 3);
+}
+
+// InterleavedTask 是用于交错查找 (group prefetch / AMAC) 的协程句柄：
+// 协程在发出预取后通过 co_await std::suspend_always{} 主动让出，
+// 由 RunInterleaved 轮转调度同一批次里的其他查找，以隐藏 cache miss 延迟。
+template <typename T>
+class InterleavedTask {
+ public:
+  struct promise_type {
+    std::optional<T> result;
+    std::exception_ptr exception;
+
+    InterleavedTask get_return_object() {
+      return InterleavedTask{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    // 创建后先挂起，由调度器决定何时开始执行。
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    // 结束后保持挂起，便于调度器读取结果后再销毁。
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_value(T value) { result = std::move(value); }
+    void unhandled_exception() { exception = std::current_exception(); }
+  };
+
+  InterleavedTask() = default;
+  InterleavedTask(const InterleavedTask&) = delete;
+  InterleavedTask& operator=(const InterleavedTask&) = delete;
+  InterleavedTask(InterleavedTask&& other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr)) {}
+  InterleavedTask& operator=(InterleavedTask&& other) noexcept {
+    if (this != &other) {
+      Destroy();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~InterleavedTask() { Destroy(); }
+
+  bool Done() const { return !handle_ || handle_.done(); }
+
+  // 执行到下一个挂起点（通常是一次预取之后）。
+  void Resume() {
+    if (!Done()) {
+      handle_.resume();
+    }
+  }
+
+  // 取出协程返回值，若协程内部抛出了异常则重新抛出。
+  T TakeResult() {
+    auto& promise = handle_.promise();
+    if (promise.exception) {
+      std::rethrow_exception(promise.exception);
+    }
+    return std::move(*promise.result);
+  }
+
+ private:
+  explicit InterleavedTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  void Destroy() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// 以 group_size 个为一组交错执行 num_tasks 个查找：make_task(i) 创建第 i 个
+// 协程，某个槽位的协程结束后立即填入下一个待执行的查找 (AMAC)，
+// 保证流水线中始终有 group_size 个访存请求在途。结果按 i 的顺序返回。
+template <typename T, typename MakeTask>
+std::vector<T> RunInterleaved(size_t num_tasks, size_t group_size,
+                              MakeTask&& make_task) {
+  std::vector<T> results(num_tasks);
+  if (num_tasks == 0) {
+    return results;
+  }
+  if (group_size == 0) {
+    group_size = 1;
+  }
+
+  struct Slot {
+    InterleavedTask<T> task;
+    size_t idx;
+  };
+  std::vector<Slot> slots;
+  slots.reserve(std::min(group_size, num_tasks));
+
+  size_t next = 0;
+  while (next < num_tasks && slots.size() < group_size) {
+    slots.push_back(Slot{make_task(next), next});
+    next++;
+  }
+
+  size_t active = slots.size();
+  while (active > 0) {
+    for (auto& slot : slots) {
+      if (slot.task.Done()) {
+        continue;
+      }
+      slot.task.Resume();
+      if (!slot.task.Done()) {
+        continue;
+      }
+      results[slot.idx] = slot.task.TakeResult();
+      if (next < num_tasks) {
+        slot.task = make_task(next);
+        slot.idx = next;
+        next++;
+      } else {
+        active--;
+      }
+    }
+  }
+  return results;
+}
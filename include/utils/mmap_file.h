@@ -7,6 +7,15 @@
 #include <string>
 #include <string_view>
 
+// 映射区域的访问模式提示，对应 madvise 的 MADV_NORMAL / MADV_SEQUENTIAL /
+// MADV_RANDOM：顺序读（compaction、长扫描）让内核加大预读，随机点查则关闭
+// 预读，避免把用不到的页读进来。
+enum class AccessHint {
+  kNormal,
+  kSequential,
+  kRandom,
+};
+
 // MMapFile 是对底层 POSIX mmap 的轻量封装，负责打开/创建文件并将其
 // 映射到内存，同时提供写入与同步到磁盘的能力。
 class MMapFile {
@@ -17,8 +26,9 @@ class MMapFile {
 
   ~MMapFile() { Close(); };
 
-  // open and mmap
-  bool Open(std::string_view filename, bool create);
+  // open and mmap，read_only 为 true 时以 O_RDONLY 打开并只读映射，
+  // 此时不能再调用 Write。
+  bool Open(std::string_view filename, bool create, bool read_only = false);
 
   // create and mmap
   bool CreateAndMap(std::string_view filename, size_t size);
@@ -33,6 +43,15 @@ class MMapFile {
 
   bool Sync();
 
+  // 把 [offset, offset + length) 所在的页同步写回磁盘。
+  bool SyncRange(size_t offset, size_t length);
+
+  // 设置整个映射区域的访问模式。
+  bool Advise(AccessHint hint);
+
+  // 提示内核异步预读 [offset, offset + length) 所在的页 (MADV_WILLNEED)。
+  bool WillNeed(size_t offset, size_t length);
+
  private:
   int fd_;
   void* data_;
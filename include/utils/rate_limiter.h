@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// 后台写入的优先级：Flush 阻塞着 memtable 的切换，优先于 compaction。
+enum class IOPriority {
+  kLow = 0,
+  kHigh = 1,
+};
+
+struct RateLimiterOptions {
+  // 限速上限（字节/秒）
+  int64_t bytes_per_second = 64 << 20;
+  // 令牌的补充周期，周期越短写入越平滑
+  int64_t refill_period_us = 100 * 1000;
+  // 为 true 时根据前台读延迟在 [bytes_per_second / 20, bytes_per_second]
+  // 之间自动调整实际限速：平均延迟高于 target_latency_us 时降速，低于一半
+  // 或没有前台读时逐步恢复
+  bool auto_tuned = false;
+  uint64_t target_latency_us = 1000;
+  // 自动调整的周期
+  int64_t tune_period_us = 1000 * 1000;
+};
+
+// RateLimiter 是令牌桶：每个补充周期放入 bytes_per_second * 周期 的令牌，
+// 后台写入在写出数据前申请等量的令牌，不够时排队等待。排队的请求按优先级
+// 分配令牌，高优先级的请求还在等待时不会分配给低优先级。可以被多个线程
+// 共享，限速可以在运行时修改。
+class RateLimiter {
+ public:
+  explicit RateLimiter(const RateLimiterOptions& options = {});
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  // 申请 bytes 字节的令牌，必要时阻塞。超过一个周期的申请被拆成多次。
+  void Request(size_t bytes, IOPriority priority);
+
+  // 修改限速上限，从下一个补充周期开始生效。
+  void SetBytesPerSecond(int64_t bytes_per_second);
+  // 当前实际的限速，自动调整时可能低于上限
+  int64_t bytes_per_second() const;
+  int64_t max_bytes_per_second() const;
+  bool auto_tuned() const { return options_.auto_tuned; }
+
+  // 一个补充周期放入的令牌数，调用方按它切分写入最平滑。
+  size_t single_burst_bytes() const;
+
+  // 记录一次前台读的延迟，供自动调整使用，不加锁。
+  void RecordForegroundLatency(uint64_t micros);
+
+  // 各优先级累计申请的字节数
+  uint64_t total_bytes_through(IOPriority priority) const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Waiter {
+    int64_t bytes;
+    bool granted = false;
+  };
+
+  int64_t RefillBytesLocked() const;
+  // 补充令牌并按优先级分配给排队的请求
+  void RefillLocked(Clock::time_point now);
+  void TuneLocked(Clock::time_point now);
+
+  const RateLimiterOptions options_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  int64_t max_bytes_per_second_;
+  int64_t bytes_per_second_;
+  int64_t available_ = 0;
+  Clock::time_point next_refill_;
+  Clock::time_point next_tune_;
+  // 是否已经有一个等待者负责在补充时刻醒来
+  bool has_leader_ = false;
+  // 按 IOPriority 下标排队的请求
+  std::array<std::deque<Waiter*>, 2> queues_;
+  std::array<uint64_t, 2> total_bytes_{};
+
+  std::atomic<uint64_t> latency_sum_us_{0};
+  std::atomic<uint64_t> latency_count_{0};
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class BlockPrefetcher;
+
+// ReadOptions 是读路径上的选项，由调用方创建后传给各层迭代器。
+struct ReadOptions {
+  // 迭代器只返回 key >= lower_bound 的记录，为空表示不限制。
+  std::optional<std::string> lower_bound;
+  // 迭代器只返回 key < upper_bound 的记录（不包含边界），为空表示不限制。
+  // 范围扫描设置上界后，迭代器不会读取整个落在上界之外的 block 或文件。
+  std::optional<std::string> upper_bound;
+  // 自适应预读的最大 block 数。迭代器连续顺序跨越 block 后开始提前预读
+  // 后面的 block，窗口从 1 开始每次翻倍直到该值；为 0 时关闭预读。
+  size_t max_readahead_blocks = 8;
+  // 后台预读器，不为空时扫描在读取第 i 个 block 的同时由后台线程读取并解码
+  // 其后的 prefetch_blocks 个 block 放入 block cache，此时不再使用上面的
+  // 页预读。多个迭代器可以共享同一个预读器。
+  std::shared_ptr<BlockPrefetcher> prefetcher;
+  size_t prefetch_blocks = 4;
+
+  // key 是否超出上界。
+  bool BeyondUpper(std::string_view key) const {
+    return upper_bound && key >= *upper_bound;
+  }
+  // key 是否低于下界。
+  bool BelowLower(std::string_view key) const {
+    return lower_bound && key < *lower_bound;
+  }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Status 是读路径上的轻量返回值：成功或 key 不存在等常规结果通过它返回，
+// 不走异常；只有数据损坏等真正的异常情况才抛出异常。
+// OK 状态不带消息，构造和拷贝都不会分配内存。
+class Status {
+ public:
+  enum class Code : uint8_t {
+    kOk = 0,
+    kNotFound,
+    kCorruption,
+    kInvalidArgument,
+    kIOError,
+  };
+
+  Status() = default;
+
+  static Status OK() { return {}; }
+  static Status NotFound(std::string_view msg = {}) {
+    return {Code::kNotFound, msg};
+  }
+  static Status Corruption(std::string_view msg = {}) {
+    return {Code::kCorruption, msg};
+  }
+  static Status InvalidArgument(std::string_view msg = {}) {
+    return {Code::kInvalidArgument, msg};
+  }
+  static Status IOError(std::string_view msg = {}) {
+    return {Code::kIOError, msg};
+  }
+
+  bool ok() const { return code_ == Code::kOk; }
+  bool IsNotFound() const { return code_ == Code::kNotFound; }
+  bool IsCorruption() const { return code_ == Code::kCorruption; }
+  bool IsInvalidArgument() const { return code_ == Code::kInvalidArgument; }
+  bool IsIOError() const { return code_ == Code::kIOError; }
+
+  Code code() const { return code_; }
+  const std::string& message() const { return msg_; }
+
+  // 形如 "NotFound: msg"，用于日志或转换为异常信息。
+  std::string ToString() const {
+    std::string result;
+    switch (code_) {
+      case Code::kOk:
+        return "OK";
+      case Code::kNotFound:
+        result = "NotFound";
+        break;
+      case Code::kCorruption:
+        result = "Corruption";
+        break;
+      case Code::kInvalidArgument:
+        result = "InvalidArgument";
+        break;
+      case Code::kIOError:
+        result = "IOError";
+        break;
+    }
+    if (!msg_.empty()) {
+      result += ": ";
+      result += msg_;
+    }
+    return result;
+  }
+
+ private:
+  Status(Code code, std::string_view msg) : code_(code), msg_(msg) {}
+
+  Code code_ = Code::kOk;
+  std::string msg_;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// 引擎内部保存的 value 的种类
+enum class ValueType {
+  // 删除标记
+  kDeletion,
+  // 完整的值
+  kValue,
+  // 尚未合并的 Merge 操作数
+  kMerge,
+};
+
+// memtable 和 v3 及以后格式的 SST 中的 value 编码：
+//   空                          删除标记
+//   0x00 0x01 | value           以 0x00 开头的值，转义后保存
+//   0x00 0x02 | operand         Merge 操作数
+//   其余                        值本身
+// 绝大多数值原样保存，不增加任何开销。更早格式的 SST 保存的是原始的值，
+// 由 SST 在读取时转成上面的编码；WAL 用记录类型区分值和操作数，不使用该编码。
+std::string EncodeValue(std::string_view value);
+std::string EncodeMergeOperand(std::string_view operand);
+// 返回 stored 的种类，payload 指向去掉编码后的值或操作数（指向 stored 内部）。
+ValueType DecodeValue(std::string_view stored, std::string_view* payload);
+
+// 原始的值是否需要转义，即 EncodeValue(value) 是否与 value 不同。
+inline bool ValueNeedsEscape(std::string_view value) {
+  return !value.empty() && value.front() == '\0';
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "consts.h"
+#include "utils/status.h"
+
+/*
+ * WAL 由若干个 segment 文件组成, 文件名为 wal_<log_number>.log, 每条记录:
+ * ---------------------------------------------------------------------
+ * | Hash (32) | length (32) | log_number (64) | payload (length bytes) |
+ * ---------------------------------------------------------------------
+ * payload:
+ * ------------------------------------------------------------------------
+ * | type (8) | seq (64) | key_len (32) | key | value_len (32) | value |
+ * ------------------------------------------------------------------------
+ * Hash 覆盖 log_number 和 payload。segment 创建时预分配到 segment_size,
+ * 回放读到 length 为 0 或 log_number 与文件名不一致(回收文件里的旧记录)
+ * 的记录时认为该 segment 结束。Hash 不匹配或不完整的记录只允许出现在最后
+ * 一个 segment 的末尾(崩溃时写了一半)。
+ */
+
+enum class WalRecordType : uint8_t {
+  kPut = 1,
+  kDelete = 2,
+  // value 是未经编码的 Merge 操作数
+  kMerge = 3,
+};
+
+// 回放时得到的一条记录。
+struct WalRecord {
+  WalRecordType type;
+  uint64_t seq;
+  std::string key;
+  std::string value;
+};
+
+// 落盘策略。
+enum class WalSyncMode {
+  // 每次写入返回前 fdatasync，同一批提交的写入共享一次 fdatasync
+  kEveryWrite,
+  // 后台线程每隔 sync_interval_ms 毫秒 fdatasync 一次
+  kInterval,
+  // 只 write，由操作系统决定何时落盘
+  kNone,
+};
+
+struct WalOptions {
+  // 为 false 时不写 WAL，也不回放
+  bool enabled = true;
+  WalSyncMode sync_mode = WalSyncMode::kNone;
+  uint32_t sync_interval_ms = 100;
+  // 单个 segment 的预分配大小，写满后切换到新的 segment
+  size_t segment_size = kWalSegmentSize;
+  // 最多保留多少个已释放的 segment 供复用，多余的直接删除
+  size_t max_recycled_segments = 2;
+};
+
+// Wal 是分段的预写日志。并发的写入者排队，队首的写入者作为 leader 把队列
+// 里所有记录合并成一次 write (和一次 fdatasync) 再唤醒其余写入者 (group
+// commit)。释放的 segment 改名为 recycle_<n>.log 留待复用，避免重新分配
+// 磁盘空间和每次 fdatasync 都要更新文件大小。
+class Wal {
+ public:
+  Wal(const Wal&) = delete;
+  Wal& operator=(const Wal&) = delete;
+  ~Wal();
+
+  // 打开 dir 下的 WAL 并创建一个新的 segment 用于写入，已有的 segment 保留
+  // 到被 ReleaseSegmentsBefore 释放。log_number 小于 min_log_number 的
+  // segment 已经持久化到 SST，直接释放，新 segment 的编号也不小于它。
+  static Status Open(const std::filesystem::path& dir,
+                     const WalOptions& options, std::unique_ptr<Wal>* wal,
+                     uint64_t min_log_number = 0);
+
+  // 按 log_number 顺序回放 dir 下 log_number >= min_log_number 的 segment
+  // 中的记录，dir 不存在时什么都不做。最后一个 segment 末尾写了一半的记录
+  // 被截掉；其余位置的坏记录返回 Corruption，不会跳过它继续回放。
+  static Status Replay(const std::filesystem::path& dir,
+                       const std::function<void(const WalRecord&)>& callback,
+                       uint64_t min_log_number = 0);
+
+  Status AddPut(uint64_t seq, std::string_view key, std::string_view value);
+  Status AddDelete(uint64_t seq, std::string_view key);
+  Status AddMerge(uint64_t seq, std::string_view key, std::string_view operand);
+
+  // 写入一条 seq 由 Wal 分配的记录。入队时在队列锁下调用 next_seq 取得
+  // seq，所以 seq 的顺序就是记录在 WAL 中的顺序；写入成功后 leader 按同样
+  // 的顺序调用各写入者的 apply(seq)，调用者借此让 memtable 的更新顺序与
+  // 回放顺序一致。apply 抛出的异常在发起写入的线程中重新抛出。
+  Status AddOrdered(WalRecordType type, std::string_view key,
+                    std::string_view value,
+                    const std::function<uint64_t()>& next_seq,
+                    const std::function<void(uint64_t seq)>& apply);
+
+  // 把已写入的记录 fdatasync 到磁盘。
+  Status Sync();
+
+  // 切换到新的 segment，返回新 segment 的 log_number。之后的写入都进入新
+  // segment，旧 segment 在其内容持久化到 SST 后用 ReleaseSegmentsBefore 释放。
+  Status SwitchSegment(uint64_t* log_number);
+
+  // 释放 log_number 小于给定值的 segment。
+  Status ReleaseSegmentsBefore(uint64_t log_number);
+
+  uint64_t current_log_number() const;
+  // 仍需在回放时读取的 segment 个数（包括当前 segment）
+  size_t num_live_segments() const;
+  size_t num_recycled_segments() const;
+  // 实际执行的 write 批次数，用于观察 group commit 的合并效果
+  uint64_t num_batches() const;
+
+ private:
+  struct Writer;
+
+  Wal(std::filesystem::path dir, const WalOptions& options);
+
+  Status AddRecord(std::string payload,
+                   const std::function<uint64_t()>* next_seq = nullptr,
+                   const std::function<void(uint64_t)>* apply = nullptr);
+  // 以下函数要求持有 io_mutex_
+  Status WriteBatch(const std::vector<Writer*>& group);
+  Status NewSegment();
+  Status CloseSegment();
+  Status SyncLocked();
+
+  void SyncLoop();
+
+  std::filesystem::path SegmentPath(uint64_t log_number) const;
+  std::filesystem::path RecyclePath(uint64_t id) const;
+
+  std::filesystem::path dir_;
+  WalOptions options_;
+
+  // 保护写入队列
+  std::mutex mutex_;
+  std::deque<Writer*> writers_;
+
+  // 保护下面的文件状态
+  mutable std::mutex io_mutex_;
+  int fd_ = -1;
+  uint64_t log_number_ = 0;
+  size_t offset_ = 0;
+  bool dirty_ = false;
+  uint64_t num_batches_ = 0;
+  // 尚未释放的 segment（不含当前 segment），按 log_number 升序
+  std::vector<uint64_t> live_segments_;
+  // 可复用的 segment 文件
+  std::vector<std::filesystem::path> recycled_;
+  uint64_t next_recycle_id_ = 0;
+
+  // kInterval 模式下的后台同步线程
+  std::condition_variable sync_cv_;
+  bool stop_ = false;
+  std::thread sync_thread_;
+};
@@ -3,40 +3,104 @@
 #include <cstddef>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <stdexcept>
 #include <string_view>
 
 #include "block/block_iterator.h"
 
-Block::Block(size_t capacity) : capacity_(capacity) {}
+namespace {
 
-std::vector<uint8_t> Block::Encode() const {
+// entry 中 value_len 的字节数
+size_t ValueLenWidth(uint32_t format_version) {
+  return format_version >= kFormatV3 ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+// 以 OffsetT 宽度编码 Offset Section 和 num_of_elements
+template <typename OffsetT>
+std::vector<uint8_t> EncodeWithOffsetWidth(
+    const std::vector<uint8_t>& data, const std::vector<uint32_t>& offsets) {
+  if (offsets.size() > std::numeric_limits<OffsetT>::max() ||
+      (!offsets.empty() && offsets.back() > std::numeric_limits<OffsetT>::max())) {
+    throw std::runtime_error("Block too large for format version");
+  }
   // 数据段 + 偏移段 + 元素个数
-  size_t total_bytes = data_.size() * sizeof(uint8_t) +
-                       offsets_.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  size_t total_bytes = data.size() + offsets.size() * sizeof(OffsetT) +
+                       sizeof(OffsetT);
   std::vector<uint8_t> encoded(total_bytes, 0);
 
-  std::copy(data_.begin(), data_.end(), encoded.begin());
+  std::copy(data.begin(), data.end(), encoded.begin());
 
-  size_t offset_pos = data_.size() * sizeof(uint8_t);
-  std::memcpy(encoded.data() + offset_pos, offsets_.data(),
-              offsets_.size() * sizeof(uint16_t));
+  uint8_t* ptr = encoded.data() + data.size();
+  for (auto offset : offsets) {
+    auto narrowed = static_cast<OffsetT>(offset);
+    std::memcpy(ptr, &narrowed, sizeof(narrowed));
+    ptr += sizeof(narrowed);
+  }
 
-  size_t num_pos =
-      data_.size() * sizeof(uint8_t) + offsets_.size() * sizeof(uint16_t);
-  uint16_t num_elements = offsets_.size();
-  std::memcpy(encoded.data() + num_pos, &num_elements, sizeof(num_elements));
+  auto num_elements = static_cast<OffsetT>(offsets.size());
+  std::memcpy(ptr, &num_elements, sizeof(num_elements));
   return encoded;
 }
 
+// 从 payload（已去掉 hash）中以 OffsetT 宽度解析 Offset Section
+template <typename OffsetT>
+void DecodeWithOffsetWidth(const std::vector<uint8_t>& encoded,
+                           size_t payload_size, std::vector<uint8_t>& data,
+                           std::vector<uint32_t>& offsets) {
+  if (payload_size < sizeof(OffsetT)) {
+    throw std::runtime_error("Encoded Block too small");
+  }
+
+  // 读取元素个数（位于 payload 的末尾）
+  OffsetT num_elements = 0;
+  size_t num_pos = payload_size - sizeof(OffsetT);
+  std::memcpy(&num_elements, encoded.data() + num_pos, sizeof(num_elements));
+
+  // payload 至少要包含 offsets 区 + num_elements 自身
+  size_t offsets_len = static_cast<size_t>(num_elements) * sizeof(OffsetT);
+  if (num_pos < offsets_len) {
+    throw std::runtime_error("Invalid encoded Block: insufficient size");
+  }
+
+  size_t offsets_pos = num_pos - offsets_len;
+  offsets.resize(num_elements);
+  const uint8_t* ptr = encoded.data() + offsets_pos;
+  for (auto& offset : offsets) {
+    OffsetT value;
+    std::memcpy(&value, ptr, sizeof(value));
+    ptr += sizeof(value);
+    offset = value;
+  }
+
+  data.assign(encoded.begin(), encoded.begin() + offsets_pos);
+}
+
+}  // namespace
+
+Block::Block(size_t capacity, uint32_t format_version)
+    : capacity_(capacity), value_len_width_(ValueLenWidth(format_version)) {}
+
+std::vector<uint8_t> Block::Encode(uint32_t format_version) const {
+  if (ValueLenWidth(format_version) != value_len_width_) {
+    throw std::runtime_error(
+        "Block entry format does not match format version");
+  }
+  if (format_version == kFormatV1) {
+    return EncodeWithOffsetWidth<uint16_t>(data_, offsets_);
+  }
+  return EncodeWithOffsetWidth<uint32_t>(data_, offsets_);
+}
+
 std::shared_ptr<Block> Block::Decode(const std::vector<uint8_t>& encoded) {
   // 兼容旧接口：默认不带 hash。
   return Decode(encoded, false);
 }
 
 std::shared_ptr<Block> Block::Decode(const std::vector<uint8_t>& encoded,
-                                     bool with_hash) {
+                                     bool with_hash, uint32_t format_version) {
   auto block = std::make_shared<Block>();
+  block->value_len_width_ = ValueLenWidth(format_version);
 
   if (encoded.size() < sizeof(uint16_t)) {
     throw std::runtime_error("Encoded data must greater equal 2 bytes");
@@ -65,29 +129,13 @@ std::shared_ptr<Block> Block::Decode(const std::vector<uint8_t>& encoded,
     }
   }
 
-  if (payload_size < sizeof(uint16_t)) {
-    throw std::runtime_error("Encoded data must greater equal 2 bytes");
+  if (format_version == kFormatV1) {
+    DecodeWithOffsetWidth<uint16_t>(encoded, payload_size, block->data_,
+                                    block->offsets_);
+  } else {
+    DecodeWithOffsetWidth<uint32_t>(encoded, payload_size, block->data_,
+                                    block->offsets_);
   }
-
-  // 读取元素个数（位于 payload 的末尾）
-  uint16_t num_elements = 0;
-  size_t num_pos = payload_size - sizeof(uint16_t);
-  std::memcpy(&num_elements, encoded.data() + num_pos, sizeof(num_elements));
-
-  // payload 至少要包含 offsets 区 + num_elements 自身
-  size_t min_size =
-      sizeof(uint16_t) + static_cast<size_t>(num_elements) * sizeof(uint16_t);
-  if (payload_size < min_size) {
-    throw std::runtime_error("Invalid encoded Block: insufficient size");
-  }
-
-  size_t offsets_pos =
-      num_pos - static_cast<size_t>(num_elements) * sizeof(uint16_t);
-  block->offsets_.resize(num_elements);
-  std::memcpy(block->offsets_.data(), encoded.data() + offsets_pos,
-              static_cast<size_t>(num_elements) * sizeof(uint16_t));
-
-  block->data_.assign(encoded.begin(), encoded.begin() + offsets_pos);
   return block;
 }
 
@@ -106,16 +154,24 @@ std::string Block::GetFirstKey() const {
 size_t Block::GetOffsetAt(size_t idx) const { return offsets_.at(idx); }
 
 bool Block::AddEntry(const std::string& key, const std::string& value) {
-  if (size() + key.size() + value.size() + 3 * sizeof(uint16_t) > capacity_ &&
-      !offsets_.empty()) {
+  if (key.size() > std::numeric_limits<uint16_t>::max()) {
+    throw std::runtime_error("Key too large for block entry");
+  }
+  if (value_len_width_ == sizeof(uint16_t) &&
+      value.size() > std::numeric_limits<uint16_t>::max()) {
+    throw std::runtime_error("Value too large for format version");
+  }
+  if (value.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Value too large for block entry");
+  }
+  size_t entry_size =
+      sizeof(uint16_t) + key.size() + value_len_width_ + value.size();
+  if (size() + entry_size + sizeof(uint32_t) > capacity_ && !offsets_.empty()) {
     return false;
   }
   size_t old_size = data_.size();
 
   uint16_t key_len = key.size();
-  uint16_t value_len = value.size();
-  size_t entry_size = sizeof(uint16_t) + key_len + sizeof(uint16_t) + value_len;
-
   data_.resize(old_size + entry_size);
 
   size_t pos = old_size;
@@ -125,39 +181,50 @@ bool Block::AddEntry(const std::string& key, const std::string& value) {
   std::memcpy(data_.data() + pos, key.data(), key_len);
   pos += key_len;
 
-  std::memcpy(data_.data() + pos, &value_len, sizeof(value_len));
-  pos += sizeof(value_len);
+  if (value_len_width_ == sizeof(uint16_t)) {
+    uint16_t value_len = value.size();
+    std::memcpy(data_.data() + pos, &value_len, sizeof(value_len));
+  } else {
+    uint32_t value_len = value.size();
+    std::memcpy(data_.data() + pos, &value_len, sizeof(value_len));
+  }
+  pos += value_len_width_;
 
-  std::memcpy(data_.data() + pos, value.data(), value_len);
+  std::memcpy(data_.data() + pos, value.data(), value.size());
 
   offsets_.push_back(old_size);
   return true;
 }
 
-std::string Block::GetKeyAt(size_t offset) const {
+std::string_view Block::GetKeyAt(size_t offset) const {
   uint16_t key_len;
   std::memcpy(&key_len, data_.data() + offset, sizeof(key_len));
-  return std::string{
+  return std::string_view{
       reinterpret_cast<const char*>(data_.data() + offset + sizeof(key_len)),
       key_len};
 }
 
-std::string Block::GetValueAt(size_t offset) const {
+std::string_view Block::GetValueAt(size_t offset) const {
   uint16_t key_len;
   std::memcpy(&key_len, data_.data() + offset, sizeof(key_len));
 
-  uint16_t value_len;
-  std::memcpy(&value_len, data_.data() + offset + sizeof(key_len) + key_len,
-              sizeof(value_len));
-  return std::string{
-      reinterpret_cast<const char*>(data_.data() + offset + sizeof(key_len) +
-                                    key_len + sizeof(value_len)),
-      value_len};
+  const uint8_t* pos = data_.data() + offset + sizeof(key_len) + key_len;
+  size_t value_len;
+  if (value_len_width_ == sizeof(uint16_t)) {
+    uint16_t len;
+    std::memcpy(&len, pos, sizeof(len));
+    value_len = len;
+  } else {
+    uint32_t len;
+    std::memcpy(&len, pos, sizeof(len));
+    value_len = len;
+  }
+  return std::string_view{
+      reinterpret_cast<const char*>(pos + value_len_width_), value_len};
 }
 
-int Block::CompareKeyAt(size_t offset, const std::string& target) const {
-  auto key = GetKeyAt(offset);
-  return key.compare(target);
+int Block::CompareKeyAt(size_t offset, std::string_view target) const {
+  return GetKeyAt(offset).compare(target);
 }
 
 std::optional<size_t> Block::GetIdxBinary(const std::string& key) const {
@@ -170,7 +237,7 @@ std::optional<size_t> Block::GetIdxBinary(const std::string& key) const {
     int mid_offset = offsets_[mid];
     int cmp = CompareKeyAt(mid_offset, key);
     if (cmp == 0) {
-      return mid_offset;
+      return mid;
     } else if (cmp < 0) {
       l = mid + 1;
     } else {
@@ -180,19 +247,81 @@ std::optional<size_t> Block::GetIdxBinary(const std::string& key) const {
   return std::nullopt;
 }
 
+size_t Block::LowerBoundIdx(std::string_view target) const {
+  size_t l = 0, r = offsets_.size();
+  while (l < r) {
+    size_t mid = l + (r - l) / 2;
+    if (CompareKeyAt(offsets_[mid], target) < 0) {
+      l = mid + 1;
+    } else {
+      r = mid;
+    }
+  }
+  return l;
+}
+
+size_t Block::UpperBoundIdx(std::string_view target) const {
+  size_t l = 0, r = offsets_.size();
+  while (l < r) {
+    size_t mid = l + (r - l) / 2;
+    if (CompareKeyAt(offsets_[mid], target) <= 0) {
+      l = mid + 1;
+    } else {
+      r = mid;
+    }
+  }
+  return l;
+}
+
 std::optional<std::string> Block::GetValueBinary(const std::string& key) const {
   if (auto idx = GetIdxBinary(key); idx.has_value()) {
-    return GetValueAt(offsets_[*idx]);
+    return std::string(GetValueAt(offsets_[*idx]));
   }
   return std::nullopt;
 }
 
+Status Block::Get(const std::string& key, std::string* value) const {
+  auto idx = GetIdxBinary(key);
+  if (!idx.has_value()) {
+    return Status::NotFound();
+  }
+  *value = GetValueAt(offsets_[*idx]);
+  return Status::OK();
+}
+
+InterleavedTask<std::optional<std::string>> Block::GetValueInterleaved(
+    const std::string& key) const {
+  int l = 0, r = static_cast<int>(offsets_.size()) - 1;
+  while (l <= r) {
+    int mid = l + (r - l) / 2;
+    size_t mid_offset = offsets_[mid];
+    PrefetchForRead(data_.data() + mid_offset);
+    co_await std::suspend_always{};
+    int cmp = CompareKeyAt(mid_offset, key);
+    if (cmp == 0) {
+      co_return std::string(GetValueAt(mid_offset));
+    } else if (cmp < 0) {
+      l = mid + 1;
+    } else {
+      r = mid - 1;
+    }
+  }
+  co_return std::nullopt;
+}
+
+std::vector<std::optional<std::string>> Block::MultiGetValueBinary(
+    std::span<const std::string> keys, size_t group_size) const {
+  return RunInterleaved<std::optional<std::string>>(
+      keys.size(), group_size,
+      [&](size_t i) { return GetValueInterleaved(keys[i]); });
+}
+
 Block::Entry Block::GetEntryAt(size_t offset) const {
-  return {GetKeyAt(offset), GetValueAt(offset)};
+  return {std::string(GetKeyAt(offset)), std::string(GetValueAt(offset))};
 }
 
 size_t Block::size() const {
-  return data_.size() + offsets_.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  return data_.size() + offsets_.size() * sizeof(uint32_t) + sizeof(uint32_t);
 }
 
 bool Block::IsEmpty() const { return offsets_.empty(); }
@@ -0,0 +1,70 @@
+#include "block/block_cache.h"
+
+#include "block/block.h"
+
+BlockCache::BlockCache(size_t capacity) : capacity_(capacity) {}
+
+std::shared_ptr<Block> BlockCache::Lookup(size_t sst_id, size_t block_idx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find({sst_id, block_idx});
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->block;
+}
+
+void BlockCache::Insert(size_t sst_id, size_t block_idx,
+                        std::shared_ptr<Block> block) {
+  size_t charge = block->size();
+  std::lock_guard<std::mutex> lock(mutex_);
+  Key key{sst_id, block_idx};
+  if (auto it = index_.find(key); it != index_.end()) {
+    usage_ -= it->second->charge;
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  lru_.push_front(Entry{key, std::move(block), charge});
+  index_[key] = lru_.begin();
+  usage_ += charge;
+  EvictIfNeeded();
+}
+
+void BlockCache::EraseSst(size_t sst_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = lru_.begin(); it != lru_.end();) {
+    if (it->key.first == sst_id) {
+      usage_ -= it->charge;
+      index_.erase(it->key);
+      it = lru_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t BlockCache::usage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
+
+size_t BlockCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+size_t BlockCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+void BlockCache::EvictIfNeeded() {
+  while (usage_ > capacity_ && !lru_.empty()) {
+    auto& victim = lru_.back();
+    usage_ -= victim.charge;
+    index_.erase(victim.key);
+    lru_.pop_back();
+  }
+}
@@ -5,26 +5,76 @@
 #include "block/block.h"
 
 BlockIterator::BlockIterator(std::shared_ptr<Block> block, size_t index)
-    : block_(block), current_index_(index), cached_value_(std::nullopt) {}
-
-BlockIterator::BlockIterator(std::shared_ptr<Block> b, const std::string& key)
-    : block_(b), cached_value_(std::nullopt) {
-  auto key_idx_pos = block_->GetIdxBinary(key);
-  if (key_idx_pos.has_value()) {
-    current_index_ = *key_idx_pos;
-  } else {
-    throw std::runtime_error("key not found");
-  }
+    : block_(block), current_index_(index) {}
+
+BlockIterator::BlockIterator(std::shared_ptr<Block> b, std::string_view key)
+    : block_(b), current_index_(0) {
+  Seek(key);
 }
 
 BlockIterator::BlockIterator(std::shared_ptr<Block> b)
-    : block_(b), current_index_(0), cached_value_(std::nullopt) {}
+    : block_(b), current_index_(0) {}
 
-BlockIterator& BlockIterator::operator++() {
-  if (block_ && current_index_ < block_->offsets_.size()) {
+bool BlockIterator::Valid() const {
+  return block_ && current_index_ < block_->offsets_.size();
+}
+
+void BlockIterator::SeekToFirst() { current_index_ = 0; }
+
+void BlockIterator::SeekToLast() {
+  // 空 block 的最后一条即 end
+  size_t n = block_ ? block_->num_entries() : 0;
+  current_index_ = n == 0 ? 0 : n - 1;
+}
+
+Status BlockIterator::Seek(std::string_view target) {
+  if (!block_) {
+    return Status::NotFound();
+  }
+  current_index_ = block_->LowerBoundIdx(target);
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+Status BlockIterator::SeekForPrev(std::string_view target) {
+  if (!block_) {
+    return Status::NotFound();
+  }
+  size_t idx = block_->UpperBoundIdx(target);
+  current_index_ = idx == 0 ? block_->num_entries() : idx - 1;
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+void BlockIterator::Next() {
+  if (Valid()) {
     ++current_index_;
-    cached_value_ = std::nullopt;
   }
+}
+
+void BlockIterator::Prev() {
+  if (!Valid()) {
+    return;
+  }
+  // 第一条之前没有记录，置为 end
+  current_index_ =
+      current_index_ == 0 ? block_->num_entries() : current_index_ - 1;
+}
+
+std::string_view BlockIterator::key() const {
+  if (!Valid()) {
+    throw std::out_of_range("Iterator out of range");
+  }
+  return block_->GetKeyAt(block_->offsets_[current_index_]);
+}
+
+std::string_view BlockIterator::value() const {
+  if (!Valid()) {
+    throw std::out_of_range("Iterator out of range");
+  }
+  return block_->GetValueAt(block_->offsets_[current_index_]);
+}
+
+BlockIterator& BlockIterator::operator++() {
+  Next();
   return *this;
 }
 
@@ -47,20 +97,3 @@ bool BlockIterator::operator==(const BlockIterator& other) const {
 bool BlockIterator::operator!=(const BlockIterator& other) const {
   return !(*this == other);
 }
-
-bool BlockIterator::IsEnd() const {
-  return current_index_ == block_->offsets_.size();
-}
-
-BlockIterator::value_type BlockIterator::operator*() const {
-  if (!block_ || current_index_ >= block_->offsets_.size()) {
-    throw std::out_of_range("Iterator out of range");
-  }
-
-  if (!cached_value_) {
-    size_t offset = block_->GetOffsetAt(current_index_);
-    cached_value_ =
-        std::make_pair(block_->GetKeyAt(offset), block_->GetValueAt(offset));
-  }
-  return *cached_value_;
-}
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <functional>
+#include <limits>
 
 BlockMeta::BlockMeta() : offset_(0), first_key_(""), last_key_("") {}
 
@@ -9,10 +10,19 @@ BlockMeta::BlockMeta(size_t offset, const std::string& first_key,
                      const std::string& last_key)
     : offset_(offset), first_key_(first_key), last_key_(last_key) {}
 
+namespace {
+
+// MetaEntry 中 offset 字段的字节数
+size_t OffsetWidth(uint32_t format_version) {
+  return format_version == kFormatV1 ? sizeof(uint32_t) : sizeof(uint64_t);
+}
+
+}  // namespace
+
 std::vector<uint8_t> BlockMeta::EncodeMetasToSlice(
-    std::span<const BlockMeta> meta_entries) {
+    std::span<const BlockMeta> meta_entries, uint32_t format_version) {
   // 每个entry序列化的格式
-  // | offset(uint32_t) |
+  // | offset(uint32_t, v2 为 uint64_t) |
   // | first_key_len(uint16_t) |
   // | first_key_bytes |
   // | last_key_len(uint16_t) |
@@ -23,17 +33,7 @@ std::vector<uint8_t> BlockMeta::EncodeMetasToSlice(
   // |hash(uint32_t)|
   auto num_entries = static_cast<uint32_t>(meta_entries.size());
 
-  size_t total_size = sizeof(uint32_t);
-  for (const auto& entry : meta_entries) {
-    total_size += sizeof(uint32_t) +         // offset
-                  sizeof(uint16_t) +         // first_key_len
-                  entry.first_key_.size() +  // first_key_bytes
-                  sizeof(uint16_t) +         // last_key_len
-                  entry.last_key_.size();    // last_key_bytes
-  }
-  total_size += sizeof(uint32_t);  // hash
-
-  std::vector<uint8_t> metadata(total_size);
+  std::vector<uint8_t> metadata(EncodedSize(meta_entries, format_version));
   uint8_t* ptr = metadata.data();
 
   // num_entries
@@ -43,9 +43,18 @@ std::vector<uint8_t> BlockMeta::EncodeMetasToSlice(
   // entries
   for (const auto& entry : meta_entries) {
     // offset
-    uint32_t offset = static_cast<uint32_t>(entry.offset_);
-    std::memcpy(ptr, &offset, sizeof(offset));
-    ptr += sizeof(offset);
+    if (format_version == kFormatV1) {
+      if (entry.offset_ > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Block offset too large for format version");
+      }
+      uint32_t offset = static_cast<uint32_t>(entry.offset_);
+      std::memcpy(ptr, &offset, sizeof(offset));
+      ptr += sizeof(offset);
+    } else {
+      uint64_t offset = entry.offset_;
+      std::memcpy(ptr, &offset, sizeof(offset));
+      ptr += sizeof(offset);
+    }
     // first_key_len, first_key
     uint16_t first_key_len = entry.first_key_.size();
     std::memcpy(ptr, &first_key_len, sizeof(first_key_len));
@@ -71,8 +80,22 @@ std::vector<uint8_t> BlockMeta::EncodeMetasToSlice(
   return metadata;
 }
 
+size_t BlockMeta::EncodedSize(std::span<const BlockMeta> meta_entries,
+                              uint32_t format_version) {
+  size_t total_size = sizeof(uint32_t);  // num_entries
+  for (const auto& entry : meta_entries) {
+    total_size += OffsetWidth(format_version) +  // offset
+                  sizeof(uint16_t) +         // first_key_len
+                  entry.first_key_.size() +  // first_key_bytes
+                  sizeof(uint16_t) +         // last_key_len
+                  entry.last_key_.size();    // last_key_bytes
+  }
+  total_size += sizeof(uint32_t);  // hash
+  return total_size;
+}
+
 std::vector<BlockMeta> BlockMeta::DecodeMetasFromSlice(
-    std::span<const uint8_t> meta_data) {
+    std::span<const uint8_t> meta_data, uint32_t format_version) {
   if (meta_data.size() < sizeof(uint32_t) * 2) {
     throw std::runtime_error("Invalid metadata size");
   }
@@ -88,10 +111,17 @@ std::vector<BlockMeta> BlockMeta::DecodeMetasFromSlice(
   for (int i = 0; i < num_entries; i++) {
     BlockMeta meta;
     // offset
-    uint32_t offset;
-    std::memcpy(&offset, ptr, sizeof(offset));
-    ptr += sizeof(offset);
-    meta.offset_ = offset;
+    if (format_version == kFormatV1) {
+      uint32_t offset;
+      std::memcpy(&offset, ptr, sizeof(offset));
+      ptr += sizeof(offset);
+      meta.offset_ = offset;
+    } else {
+      uint64_t offset;
+      std::memcpy(&offset, ptr, sizeof(offset));
+      ptr += sizeof(offset);
+      meta.offset_ = offset;
+    }
     // first_key
     uint16_t first_key_len;
     std::memcpy(&first_key_len, ptr, sizeof(first_key_len));
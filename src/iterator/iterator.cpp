@@ -1,5 +1,14 @@
 #include "iterator/iterator.h"
 
+#include <stdexcept>
+
+std::pair<std::string, std::string> BaseIterator::operator*() const {
+  if (!Valid()) {
+    throw std::runtime_error("iterator is invalid");
+  }
+  return {std::string(key()), std::string(value())};
+}
+
 bool operator<(const SearchItem& a, const SearchItem& b) {
   if (a.key != b.key) {
     return a.key < b.key;
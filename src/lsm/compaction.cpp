@@ -0,0 +1,571 @@
+#include "lsm/compaction.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <utility>
+
+#include "iterator/merge_iterator.h"
+#include "iterator/two_merge_iterator.h"
+#include "sst/sst.h"
+#include "sst/sst_iterator.h"
+#include "utils/thread_pool.h"
+
+std::vector<size_t> Compaction::InputIds() const {
+  std::vector<size_t> ids;
+  ids.reserve(inputs.size() + output_level_inputs.size());
+  for (const auto& file : inputs) {
+    ids.push_back(file.sst_id);
+  }
+  for (const auto& file : output_level_inputs) {
+    ids.push_back(file.sst_id);
+  }
+  return ids;
+}
+
+std::vector<LevelFileMeta> OverlappingFiles(
+    const std::vector<LevelFileMeta>& files, std::string_view smallest,
+    std::string_view largest) {
+  std::vector<LevelFileMeta> result;
+  for (const auto& file : files) {
+    if (file.last_key >= smallest && file.first_key <= largest) {
+      result.push_back(file);
+    }
+  }
+  return result;
+}
+
+namespace {
+
+bool AnyBeingCompacted(const std::vector<LevelFileMeta>& files,
+                       const std::unordered_set<size_t>& being_compacted) {
+  return std::any_of(files.begin(), files.end(), [&](const auto& file) {
+    return being_compacted.contains(file.sst_id);
+  });
+}
+
+}  // namespace
+
+std::unique_ptr<CompactionPicker> NewCompactionPicker(
+    const CompactionOptions& options) {
+  switch (options.style) {
+    case CompactionStyle::kUniversal:
+      return std::make_unique<UniversalCompactionPicker>(options);
+    case CompactionStyle::kFifo:
+      return std::make_unique<FifoCompactionPicker>(options);
+    case CompactionStyle::kLeveled:
+      break;
+  }
+  return std::make_unique<LeveledCompactionPicker>(options);
+}
+
+uint64_t LeveledCompactionPicker::MaxBytesForLevel(size_t level) const {
+  uint64_t size = options_.max_bytes_for_level_base;
+  for (size_t i = 1; i < level; i++) {
+    size *= options_.level_size_multiplier;
+  }
+  return size;
+}
+
+double LeveledCompactionPicker::Score(const Version& version,
+                                      size_t level) const {
+  // 最后一层没有可以合并到的下一层
+  if (level + 1 >= version.num_levels()) {
+    return 0;
+  }
+  if (level == 0) {
+    return static_cast<double>(version.files(0).size()) /
+           std::max<size_t>(options_.l0_compaction_trigger, 1);
+  }
+  return static_cast<double>(version.level_size(level)) /
+         MaxBytesForLevel(level);
+}
+
+std::optional<Compaction> LeveledCompactionPicker::Pick(
+    const Version& version,
+    const std::unordered_set<size_t>& being_compacted) {
+  std::vector<std::pair<double, size_t>> scores;
+  for (size_t level = 0; level + 1 < version.num_levels(); level++) {
+    double score = Score(version, level);
+    if (score >= 1) {
+      scores.emplace_back(score, level);
+    }
+  }
+  std::sort(scores.begin(), scores.end(), std::greater<>());
+
+  for (auto [score, level] : scores) {
+    auto compaction = PickLevel(version, level, being_compacted);
+    if (compaction) {
+      compaction->score = score;
+      return compaction;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Compaction> LeveledCompactionPicker::PickLevel(
+    const Version& version, size_t level,
+    const std::unordered_set<size_t>& being_compacted) {
+  const auto& files = version.files(level);
+  if (files.empty()) {
+    return std::nullopt;
+  }
+  Compaction compaction;
+  compaction.level = level;
+  compaction.output_level = level + 1;
+  compaction.max_output_file_size = options_.target_file_size;
+  const auto& next_files = version.files(level + 1);
+
+  if (level == 0) {
+    // L0 的文件互相重叠，必须全部一起合并，同一时刻只能有一个 L0 compaction
+    if (AnyBeingCompacted(files, being_compacted)) {
+      return std::nullopt;
+    }
+    std::string_view smallest = files[0].first_key;
+    std::string_view largest = files[0].last_key;
+    for (const auto& file : files) {
+      smallest = std::min<std::string_view>(smallest, file.first_key);
+      largest = std::max<std::string_view>(largest, file.last_key);
+    }
+    compaction.inputs = files;
+    compaction.output_level_inputs =
+        OverlappingFiles(next_files, smallest, largest);
+    if (AnyBeingCompacted(compaction.output_level_inputs, being_compacted)) {
+      return std::nullopt;
+    }
+    return compaction;
+  }
+
+  // 从 compact pointer 之后的第一个文件开始轮转
+  auto& pointer = compact_pointer_[level];
+  size_t start = 0;
+  if (!pointer.empty()) {
+    start = std::upper_bound(files.begin(), files.end(), pointer,
+                             [](const std::string& key, const auto& file) {
+                               return key < file.first_key;
+                             }) -
+            files.begin();
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto& file = files[(start + i) % files.size()];
+    if (being_compacted.contains(file.sst_id)) {
+      continue;
+    }
+    auto overlapping =
+        OverlappingFiles(next_files, file.first_key, file.last_key);
+    if (AnyBeingCompacted(overlapping, being_compacted)) {
+      continue;
+    }
+    compaction.inputs = {file};
+    compaction.output_level_inputs = std::move(overlapping);
+    pointer = file.last_key;
+    return compaction;
+  }
+  return std::nullopt;
+}
+
+std::optional<Compaction> UniversalCompactionPicker::Pick(
+    const Version& version,
+    const std::unordered_set<size_t>& being_compacted) {
+  const auto& files = version.files(0);
+  size_t trigger = std::max<size_t>(options_.l0_compaction_trigger, 2);
+  // 同一时刻只做一个 universal compaction，避免输出段的新旧次序交错
+  if (files.size() < trigger || AnyBeingCompacted(files, being_compacted)) {
+    return std::nullopt;
+  }
+  // 从新到旧
+  std::vector<LevelFileMeta> runs(files.rbegin(), files.rend());
+  size_t n = runs.size();
+  double score = static_cast<double>(n) / trigger;
+
+  // 空间放大：较新的段里大多是最旧段中 key 的新版本
+  uint64_t newer_size = 0;
+  for (size_t i = 0; i + 1 < n; i++) {
+    newer_size += runs[i].file_size;
+  }
+  uint64_t oldest_size = runs.back().file_size;
+  if (oldest_size > 0 &&
+      newer_size * 100 >=
+          options_.universal_max_size_amplification_percent * oldest_size) {
+    return MakeCompaction(runs, 0, n, score);
+  }
+
+  // 大小比例：累计大小足以与下一个段相比时继续往旧的方向扩展
+  size_t min_width = std::max<size_t>(options_.universal_min_merge_width, 2);
+  size_t max_width = std::max(options_.universal_max_merge_width, min_width);
+  for (size_t begin = 0; begin < n; begin++) {
+    uint64_t candidate_size = runs[begin].file_size;
+    size_t end = begin + 1;
+    while (end < n && end - begin < max_width) {
+      if (candidate_size * (100 + options_.universal_size_ratio) / 100 <
+          runs[end].file_size) {
+        break;
+      }
+      candidate_size += runs[end].file_size;
+      end++;
+    }
+    if (end - begin >= min_width) {
+      return MakeCompaction(runs, begin, end, score);
+    }
+  }
+
+  // 段的大小差距都很大时合并最新的几个段，使段数回到 trigger 以下
+  return MakeCompaction(runs, 0, n - trigger + 2, score);
+}
+
+Compaction UniversalCompactionPicker::MakeCompaction(
+    const std::vector<LevelFileMeta>& runs, size_t begin, size_t end,
+    double score) const {
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 0;
+  compaction.score = score;
+  // inputs 与 L0 一样从旧到新排列
+  compaction.inputs.assign(runs.rbegin() + (runs.size() - end),
+                           runs.rbegin() + (runs.size() - begin));
+  // 合并中不包含最旧的段时，更旧的段里可能还有被删除的 key
+  compaction.may_drop_deletions = end == runs.size();
+  return compaction;
+}
+
+std::optional<Compaction> FifoCompactionPicker::Pick(
+    const Version& version,
+    const std::unordered_set<size_t>& being_compacted) {
+  auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  return PickAt(version, being_compacted, static_cast<uint64_t>(now));
+}
+
+std::optional<Compaction> FifoCompactionPicker::PickAt(
+    const Version& version, const std::unordered_set<size_t>& being_compacted,
+    uint64_t now) const {
+  const auto& files = version.files(0);
+  // 删除和窗口合并都会改变 L0，同一时刻只做一个
+  if (files.empty() || AnyBeingCompacted(files, being_compacted)) {
+    return std::nullopt;
+  }
+
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 0;
+  compaction.deletion_only = true;
+  uint64_t ttl = options_.fifo_ttl_seconds;
+  uint64_t remaining = version.level_size(0);
+  std::vector<bool> dropped(files.size(), false);
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto& file = files[i];
+    // creation_time 未知的文件不按时间删除
+    if (ttl > 0 && file.creation_time > 0 && file.creation_time + ttl <= now) {
+      dropped[i] = true;
+      remaining -= file.file_size;
+    }
+  }
+  uint64_t max_size = options_.fifo_max_table_files_size;
+  for (size_t i = 0; max_size > 0 && remaining > max_size && i < files.size();
+       i++) {
+    if (!dropped[i]) {
+      dropped[i] = true;
+      remaining -= files[i].file_size;
+    }
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    if (dropped[i]) {
+      compaction.inputs.push_back(files[i]);
+    }
+  }
+  if (!compaction.inputs.empty()) {
+    compaction.score = 1;
+    return compaction;
+  }
+
+  uint64_t window = options_.fifo_time_window_seconds;
+  if (window == 0) {
+    return std::nullopt;
+  }
+  for (size_t begin = 0; begin < files.size();) {
+    uint64_t id = files[begin].creation_time / window;
+    size_t end = begin + 1;
+    while (end < files.size() && files[end].creation_time / window == id) {
+      end++;
+    }
+    if (end - begin >= 2 && files[begin].creation_time > 0 &&
+        id < now / window) {
+      compaction.deletion_only = false;
+      compaction.inputs.assign(files.begin() + begin, files.begin() + end);
+      // 更旧的窗口里可能还有被删除的 key
+      compaction.may_drop_deletions = begin == 0;
+      compaction.score = static_cast<double>(end - begin);
+      return compaction;
+    }
+    begin = end;
+  }
+  return std::nullopt;
+}
+
+CompactionJob::CompactionJob(const Compaction& compaction,
+                             std::shared_ptr<const Version> version,
+                             std::shared_ptr<TableCache> table_cache,
+                             std::function<size_t()> new_file_number,
+                             const CompactionOptions& options)
+    : compaction_(compaction),
+      version_(std::move(version)),
+      table_cache_(std::move(table_cache)),
+      new_file_number_(std::move(new_file_number)),
+      options_(options) {}
+
+bool CompactionJob::IsBottommost(std::string_view key,
+                                 std::vector<size_t>* level_ptrs) const {
+  for (size_t level = compaction_.output_level + 1;
+       level < version_->num_levels(); level++) {
+    const auto& files = version_->files(level);
+    auto& ptr = (*level_ptrs)[level];
+    while (ptr < files.size() && files[ptr].last_key < key) {
+      ptr++;
+    }
+    if (ptr < files.size() && files[ptr].first_key <= key) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> CompactionJob::SplitKeyRange() const {
+  size_t max_subcompactions = options_.max_subcompactions;
+  // 输出到 L0 时每个输出文件都是一个有序段，切分会打乱段的大小统计
+  if (max_subcompactions <= 1 || compaction_.output_level == 0) {
+    return {};
+  }
+  // 候选切分点是所有输入 block 的 first_key，数据多的区间候选点也多
+  std::vector<std::string_view> candidates;
+  std::vector<std::shared_ptr<SST>> tables;
+  for (const auto* files :
+       {&compaction_.inputs, &compaction_.output_level_inputs}) {
+    for (const auto& file : *files) {
+      tables.push_back(table_cache_->Get(file.sst_id));
+      for (const auto& meta : tables.back()->block_metas()) {
+        candidates.push_back(meta.first_key_);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  std::vector<std::string> splits;
+  size_t n = std::min(max_subcompactions, candidates.size());
+  for (size_t i = 1; i < n; i++) {
+    auto split = candidates[i * candidates.size() / n];
+    if (splits.empty() || splits.back() != split) {
+      splits.emplace_back(split);
+    }
+  }
+  return splits;
+}
+
+Status CompactionJob::Run(VersionEdit* edit) {
+  std::vector<std::string> splits;
+  try {
+    // 输入文件整体顺序读一遍，提示内核加大预读
+    for (const auto& file : compaction_.inputs) {
+      table_cache_->Get(file.sst_id)->SetAccessHint(AccessHint::kSequential);
+    }
+    for (const auto& file : compaction_.output_level_inputs) {
+      table_cache_->Get(file.sst_id)->SetAccessHint(AccessHint::kSequential);
+    }
+    splits = SplitKeyRange();
+  } catch (const std::exception& e) {
+    return Status::Corruption(e.what());
+  }
+
+  std::vector<Subcompaction> subs(splits.size() + 1);
+  for (size_t i = 0; i < subs.size(); i++) {
+    if (i > 0) {
+      subs[i].range.lower_bound = splits[i - 1];
+    }
+    if (i < splits.size()) {
+      subs[i].range.upper_bound = splits[i];
+    }
+    subs[i].level_ptrs.assign(version_->num_levels(), 0);
+  }
+  num_subcompactions_ = subs.size();
+
+  // 第一个子范围在当前线程执行，其余的交给线程池，没有时依次执行
+  Status status;
+  {
+    std::vector<std::future<Status>> futures;
+    if (pool_) {
+      for (size_t i = 1; i < subs.size(); i++) {
+        futures.push_back(pool_->Submit([this, sub = &subs[i]] {
+          return ProcessRange(sub);
+        }));
+      }
+    }
+    status = ProcessRange(&subs[0]);
+    for (size_t i = 1; !pool_ && i < subs.size(); i++) {
+      auto sub_status = ProcessRange(&subs[i]);
+      if (status.ok() && !sub_status.ok()) {
+        status = sub_status;
+      }
+    }
+    for (auto& future : futures) {
+      auto sub_status = future.get();
+      if (status.ok() && !sub_status.ok()) {
+        status = sub_status;
+      }
+    }
+  }
+  if (!status.ok()) {
+    // 已经写完的输出不会被记录到 MANIFEST，直接删除
+    for (const auto& sub : subs) {
+      for (const auto& meta : sub.outputs) {
+        table_cache_->Evict(meta.sst_id);
+        std::error_code ec;
+        std::filesystem::remove(table_cache_->SstPath(meta.sst_id), ec);
+      }
+    }
+    return status;
+  }
+
+  for (auto& sub : subs) {
+    for (auto& meta : sub.outputs) {
+      edit->AddFile(compaction_.output_level, std::move(meta));
+    }
+    num_output_entries_ += sub.num_output_entries;
+    num_dropped_deletions_ += sub.num_dropped_deletions;
+    num_merged_operands_ += sub.num_merged_operands;
+  }
+  for (const auto& file : compaction_.inputs) {
+    edit->DeleteFile(compaction_.level, file.sst_id);
+  }
+  for (const auto& file : compaction_.output_level_inputs) {
+    edit->DeleteFile(compaction_.output_level, file.sst_id);
+  }
+  return Status::OK();
+}
+
+Status CompactionJob::ProcessRange(Subcompaction* sub) {
+  try {
+    const auto& range = sub->range;
+    // 非 L0 的输入层和输出层内部互不重叠，各用一个 LevelIterator，输入层
+    // 更新所以在前
+    std::vector<LevelIterator> levels;
+    if (compaction_.level > 0) {
+      levels.emplace_back(compaction_.inputs, table_cache_->opener(), range);
+    }
+    if (!compaction_.output_level_inputs.empty()) {
+      levels.emplace_back(compaction_.output_level_inputs,
+                          table_cache_->opener(), range);
+    }
+    MergeIterator<LevelIterator> level_iter(std::move(levels));
+    if (compaction_.level > 0) {
+      level_iter.SeekToFirst();
+      return WriteOutputs(level_iter, sub);
+    }
+    // L0 的文件相互重叠，从新到旧各用一个 SstIterator
+    std::vector<SstIterator> l0_iters;
+    for (auto file = compaction_.inputs.rbegin();
+         file != compaction_.inputs.rend(); ++file) {
+      l0_iters.emplace_back(table_cache_->Get(file->sst_id), range);
+    }
+    TwoMergeIterator<MergeIterator<SstIterator>, MergeIterator<LevelIterator>>
+        iter(MergeIterator<SstIterator>(std::move(l0_iters)),
+             std::move(level_iter));
+    iter.SeekToFirst();
+    return WriteOutputs(iter, sub);
+  } catch (const std::exception& e) {
+    return Status::Corruption(e.what());
+  }
+}
+
+template <KVIterator Iter>
+Status CompactionJob::WriteOutputs(Iter& iter, Subcompaction* sub) {
+  // 输出到 L0 时继承输入中最新的 epoch 和 creation_time，保持与其他段的
+  // 新旧次序，过期时间也不因合并而推迟
+  uint64_t output_epoch = 0;
+  uint64_t output_creation_time = 0;
+  for (const auto& file : compaction_.inputs) {
+    output_epoch = std::max(output_epoch, file.epoch);
+    output_creation_time = std::max(output_creation_time, file.creation_time);
+  }
+
+  // 输出记录的序列号都来自输入，按整体范围记录到每个输出文件
+  uint64_t min_seq = std::numeric_limits<uint64_t>::max();
+  uint64_t max_seq = 0;
+  for (const auto* files :
+       {&compaction_.inputs, &compaction_.output_level_inputs}) {
+    for (const auto& file : *files) {
+      const auto& properties = table_cache_->Get(file.sst_id)->properties();
+      min_seq = std::min(min_seq, properties.min_seq);
+      max_seq = std::max(max_seq, properties.max_seq);
+    }
+  }
+
+  std::optional<SSTBuilder> builder;
+  auto finish_output = [&] {
+    size_t sst_id = new_file_number_();
+    auto sst = std::make_shared<SST>(
+        builder->Build(sst_id, table_cache_->SstPath(sst_id).string(),
+                       table_cache_->block_cache()));
+    table_cache_->Insert(sst);
+    auto meta = LevelFileMeta::FromSst(*sst);
+    if (compaction_.output_level == 0) {
+      meta.epoch = output_epoch;
+      if (output_creation_time > 0) {
+        meta.creation_time = output_creation_time;
+      }
+    }
+    sub->outputs.push_back(std::move(meta));
+    builder.reset();
+  };
+  // 当前 key 的 Merge 操作数（从新到旧）和合并结果，复用缓冲区
+  std::vector<std::string> operands;
+  std::string merged;
+  for (; iter.Valid(); iter.Next()) {
+    std::string_view value = iter.value();
+    std::string_view payload;
+    if (DecodeValue(value, &payload) == ValueType::kMerge) {
+      if (!merge_operator_) {
+        return Status::InvalidArgument(
+            "merge operand found without a merge operator");
+      }
+      // 旧版本还停在当前 key 上，一直收集到更旧的值或删除标记为止
+      operands.clear();
+      std::optional<std::string_view> base;
+      bool has_base = CollectMergeOperands(iter, &operands, &base);
+      // 更深的层中也没有这个 key 时，操作数可以直接作用在空值上
+      if (has_base || (compaction_.may_drop_deletions &&
+                       IsBottommost(iter.key(), &sub->level_ptrs))) {
+        merged = EncodeValue(
+            FullMerge(*merge_operator_, iter.key(), base, operands));
+        sub->num_merged_operands += operands.size();
+      } else {
+        merged = EncodeMergeOperand(
+            PartialMerge(*merge_operator_, iter.key(), operands));
+        sub->num_merged_operands += operands.size() - 1;
+      }
+      value = merged;
+    } else if (value.empty() && compaction_.may_drop_deletions &&
+               IsBottommost(iter.key(), &sub->level_ptrs)) {
+      // 更深的层中没有这个 key 时删除标记已经没有需要遮蔽的数据
+      sub->num_dropped_deletions++;
+      continue;
+    }
+    if (!builder) {
+      builder.emplace(kBlockSize);
+      builder->SetRateLimiter(rate_limiter_, IOPriority::kLow);
+      builder->AddSeqRange(min_seq, max_seq);
+    }
+    builder->Add(iter.key(), value);
+    sub->num_output_entries++;
+    if (builder->estimated_size() >= compaction_.max_output_file_size) {
+      finish_output();
+    }
+  }
+  if (builder) {
+    finish_output();
+  }
+  return Status::OK();
+}
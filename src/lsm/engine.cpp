@@ -1,80 +1,900 @@
 #include "lsm/engine.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <format>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
 
 #include "consts.h"
 #include "memtable/memtable_iterator.h"
+#include "sst/block_prefetcher.h"
 #include "sst/sst.h"
 #include "sst/sst_iterator.h"
+#include "utils/thread_pool.h"
 
-LSMEngine::LSMEngine(std::filesystem::path path) : data_dir_(std::move(path)) {
+LSMEngine::LSMEngine(std::filesystem::path path, const EngineOptions& options)
+    : data_dir_(std::move(path)),
+      block_cache_(std::make_shared<BlockCache>(kBlockCacheCapacity)),
+      table_cache_(std::make_shared<TableCache>(data_dir_, block_cache_)),
+      versions_(data_dir_),
+      rate_limiter_(options.rate_limiter),
+      merge_operator_(options.merge_operator),
+      compaction_options_(options.compaction),
+      picker_(NewCompactionPicker(options.compaction)) {
   if (!std::filesystem::exists(data_dir_)) {
     std::filesystem::create_directory(data_dir_);
+  }
+  auto status = versions_.Recover();
+  // 只在完整回放了 MANIFEST 时删除孤儿文件
+  if (status.ok() && !versions_.recovered_torn_tail()) {
+    DeleteOrphanFiles();
+  }
+  auto mem = std::make_shared<MemTable>();
+  super_version_.store(std::make_shared<const SuperVersion>(
+      SuperVersion{mem, {}, versions_.current()}));
+  if (status.ok() && options.open_threads > 0) {
+    std::vector<size_t> ids;
+    auto version = versions_.current();
+    for (size_t level = 0; level < version->num_levels(); level++) {
+      for (const auto& file : version->files(level)) {
+        ids.push_back(file.sst_id);
+      }
+    }
+    status = table_cache_->OpenAll(ids, options.open_threads);
+  }
+  if (!status.ok()) {
+    throw std::runtime_error(status.ToString());
+  }
+  if (options.wal.enabled) {
+    // 回放上次未 Flush 的写入，更早的 segment 已经写入 SST
+    uint64_t max_seq = 0;
+    status = Wal::Replay(
+        WalDir(),
+        [&](const WalRecord& record) {
+          switch (record.type) {
+            case WalRecordType::kPut:
+              mem->Put(record.key, EncodeValue(record.value), record.seq);
+              break;
+            case WalRecordType::kDelete:
+              mem->Remove(record.key, record.seq);
+              break;
+            case WalRecordType::kMerge:
+              MergeInto(mem.get(), record.key, record.value, record.seq);
+              break;
+          }
+          max_seq = std::max(max_seq, record.seq);
+        },
+        versions_.log_number());
+    if (status.ok()) {
+      status = Wal::Open(WalDir(), options.wal, &wal_, versions_.log_number());
+    }
+    if (!status.ok()) {
+      throw std::runtime_error(status.ToString());
+    }
+    next_seq_ = std::max(max_seq, versions_.last_sequence()) + 1;
   } else {
-    // TODO: load sst file
+    next_seq_ = versions_.last_sequence() + 1;
+  }
+
+  // 所有 compaction 共用，子范围的线程总数不随并发的 compaction 增长
+  if (compaction_options_.max_subcompactions > 1) {
+    subcompaction_pool_ = std::make_unique<ThreadPool>(
+        compaction_options_.max_subcompactions - 1);
+  }
+  if (compaction_options_.max_background_compactions > 0) {
+    compaction_pool_ = std::make_unique<ThreadPool>(
+        compaction_options_.max_background_compactions);
+    MaybeScheduleCompaction();
+    // 按时间的 FIFO 规则只在调度时检查，没有写入时也要定期调度
+    if (compaction_options_.style == CompactionStyle::kFifo &&
+        (compaction_options_.fifo_ttl_seconds > 0 ||
+         compaction_options_.fifo_time_window_seconds > 0)) {
+      compaction_timer_ = std::thread([this] { CompactionTimerLoop(); });
+    }
+  }
+}
+
+LSMEngine::~LSMEngine() {
+  {
+    std::lock_guard<std::mutex> lock(compaction_mutex_);
+    shutting_down_ = true;
   }
+  compaction_cv_.notify_all();
+  if (compaction_timer_.joinable()) {
+    compaction_timer_.join();
+  }
+  // 队列中尚未开始的 compaction 看到 shutting_down_ 后直接返回
+  compaction_pool_.reset();
 }
 
 std::optional<std::string> LSMEngine::Get(std::string_view key) const {
-  // 现在memtable查找
-  if (auto value = memtable_.Get(std::string(key))) {
-    if (!value->empty()) {
-      return value;
-    }
-    // 空表示删除
+  std::string value;
+  auto status = Get(key, &value);
+  if (status.ok()) {
+    return value;
+  }
+  if (status.IsNotFound()) {
     return std::nullopt;
   }
+  throw std::runtime_error(status.ToString());
+}
 
-  for (auto sst_id : l0_sst_ids_) {
-    auto it = ssts_.find(sst_id);
-    if (it == ssts_.end() || !it->second) {
-      continue;
+Status LSMEngine::Get(std::string_view key, std::string* value) const {
+  if (!rate_limiter_ || !rate_limiter_->auto_tuned()) {
+    return GetImpl(key, value);
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto status = GetImpl(key, value);
+  rate_limiter_->RecordForegroundLatency(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+  return status;
+}
+
+Status LSMEngine::GetImpl(std::string_view key, std::string* value) const {
+  std::string key_str(key);
+  std::string found;
+  auto super_version = GetSuperVersion();
+  // 从新到旧查找，Merge 操作数收集起来继续向更旧的数据查找，遇到值或删除
+  // 标记时停止
+  std::vector<std::string> operands;
+  std::optional<std::string> base;
+  bool has_base = false;
+  Status status;
+  // 处理一个数据源的查找结果，返回 true 表示不必再查更旧的数据
+  auto accept = [&](const Status& s) {
+    if (s.ok()) {
+      std::string_view payload;
+      switch (DecodeValue(found, &payload)) {
+        case ValueType::kMerge:
+          operands.emplace_back(payload);
+          return false;
+        case ValueType::kValue:
+          base.emplace(payload);
+          break;
+        case ValueType::kDeletion:
+          break;
+      }
+      has_base = true;
+    } else if (!s.IsNotFound()) {
+      status = s;
     }
-    const auto sst = it->second;
-    auto sst_iter = sst->Iterator(std::string(key));
-    if (sst_iter != sst->end()) {
-      const auto& [key, value] = *sst_iter;
-      if (!value.empty()) {
-        return value;
+    return has_base || !status.ok();
+  };
+
+  bool done = accept(super_version->mem->Get(key_str, &found));
+  for (auto imm = super_version->imm.begin();
+       !done && imm != super_version->imm.end(); ++imm) {
+    done = accept((*imm)->Get(key_str, &found));
+  }
+  const auto& version = super_version->current;
+  if (!done) {
+    // 只查 key 范围包含 key 的 L0 文件，从新到旧
+    std::vector<size_t> candidates;
+    version->L0FilesContaining(key, &candidates);
+    const auto& l0_files = version->files(0);
+    for (size_t idx : candidates) {
+      const auto& file = l0_files[idx];
+      try {
+        done = accept(table_cache_->Get(file.sst_id)->Get(key_str, &found));
+      } catch (const std::exception& e) {
+        return Status::Corruption(e.what());
       }
-      return std::nullopt;
+      if (done) {
+        break;
+      }
+    }
+  }
+  // L1 及以下每层的文件互不重叠，每层至多查找一个文件
+  for (size_t level = 1; !done && level < version->num_levels(); level++) {
+    const auto& files = version->files(level);
+    auto file = std::lower_bound(
+        files.begin(), files.end(), key,
+        [](const LevelFileMeta& f, std::string_view k) {
+          return f.last_key < k;
+        });
+    if (file == files.end() || file->first_key > key) {
+      continue;
     }
+    try {
+      done = accept(table_cache_->Get(file->sst_id)->Get(key_str, &found));
+    } catch (const std::exception& e) {
+      return Status::Corruption(e.what());
+    }
+  }
+
+  if (!status.ok()) {
+    return status;
   }
-  return std::nullopt;
+  if (operands.empty()) {
+    if (!base) {
+      return Status::NotFound();
+    }
+    *value = std::move(*base);
+    return Status::OK();
+  }
+  if (!merge_operator_) {
+    return Status::InvalidArgument(
+        "merge operand found without a merge operator");
+  }
+  auto merged = FullMerge(*merge_operator_, key, base, operands);
+  // 与 Put 一致，空值表示删除
+  if (merged.empty()) {
+    return Status::NotFound();
+  }
+  *value = std::move(merged);
+  return Status::OK();
 }
 
 void LSMEngine::Put(std::string_view key, std::string_view value) {
-  memtable_.Put(std::string(key), std::string(value));
-  if (memtable_.total_size() >= kMemSizeLimit) {
-    Flush();
+  if (Write(WalRecordType::kPut, key, value)) {
+    FlushMemTable(true);
   }
 }
 void LSMEngine::Remove(std::string_view key) {
-  memtable_.Remove(std::string(key));
+  Write(WalRecordType::kDelete, key, {});
+}
+
+void LSMEngine::Merge(std::string_view key, std::string_view operand) {
+  if (!merge_operator_) {
+    throw std::invalid_argument("Merge requires a merge operator");
+  }
+  if (Write(WalRecordType::kMerge, key, operand)) {
+    FlushMemTable(true);
+  }
+}
+
+bool LSMEngine::Write(WalRecordType type, std::string_view key,
+                      std::string_view value) {
+  std::shared_lock<std::shared_mutex> lock(write_mutex_);
+  // 持有共享锁期间活跃 memtable 不会被冻结
+  auto mem = GetSuperVersion()->mem;
+  auto apply = [&](uint64_t seq) {
+    switch (type) {
+      case WalRecordType::kPut:
+        mem->Put(std::string(key), EncodeValue(value), seq);
+        break;
+      case WalRecordType::kDelete:
+        mem->Remove(std::string(key), seq);
+        break;
+      case WalRecordType::kMerge:
+        MergeInto(mem.get(), std::string(key), value, seq);
+        break;
+    }
+  };
+  if (wal_) {
+    auto status = wal_->AddOrdered(
+        type, key, value, [this] { return next_seq_++; }, apply);
+    if (!status.ok()) {
+      throw std::runtime_error(status.ToString());
+    }
+  } else {
+    std::lock_guard<std::mutex> order_lock(write_order_mutex_);
+    apply(next_seq_++);
+  }
+  return mem->total_size() >= kMemSizeLimit;
+}
+
+void LSMEngine::MergeInto(MemTable* mem, const std::string& key,
+                          std::string_view operand, uint64_t seq) const {
+  if (!merge_operator_) {
+    throw std::runtime_error(
+        Status::InvalidArgument("merge operand found without a merge operator")
+            .ToString());
+  }
+  // 写入已经按 seq 串行，读到的节点在写回之前不会被替换，合并函数不必
+  // 占用 memtable 的写锁，并发的读取不会被它阻塞
+  std::string existing;
+  std::string value;
+  std::string_view payload;
+  if (mem->Get(key, &existing).IsNotFound()) {
+    // memtable 中没有这个 key，更旧的值留到读取或 compaction 时再合并
+    value = EncodeMergeOperand(operand);
+  } else {
+    switch (DecodeValue(existing, &payload)) {
+      case ValueType::kDeletion:
+        value = EncodeValue(merge_operator_->Merge(key, std::nullopt, operand));
+        break;
+      case ValueType::kValue:
+        value = EncodeValue(merge_operator_->Merge(key, payload, operand));
+        break;
+      case ValueType::kMerge:
+        // 结合律保证两个操作数可以先合成一个
+        value =
+            EncodeMergeOperand(merge_operator_->Merge(key, payload, operand));
+        break;
+    }
+  }
+  mem->Put(key, value, seq);
 }
 
-void LSMEngine::Flush() {
-  if (memtable_.total_size() == 0) {
+void LSMEngine::Flush() { FlushMemTable(false); }
+
+void LSMEngine::FlushMemTable(bool only_if_full) {
+  std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+  {
+    // 等正在进行的写入完成，之后冻结的 memtable 不会再有写入
+    std::unique_lock<std::shared_mutex> write_lock(write_mutex_);
+    auto mem = GetSuperVersion()->mem;
+    size_t size = mem->total_size();
+    if (size > 0 && (!only_if_full || size >= kMemSizeLimit)) {
+      // 之后的写入进入新的 segment，SST 写完后旧 segment 就不再需要
+      uint64_t wal_log_number = 0;
+      if (wal_) {
+        auto status = wal_->SwitchSegment(&wal_log_number);
+        if (!status.ok()) {
+          throw std::runtime_error(status.ToString());
+        }
+      }
+      InstallSuperVersion([&](SuperVersion* next) {
+        next->mem = std::make_shared<MemTable>();
+        next->imm.insert(next->imm.begin(), mem);
+      });
+      pending_flushes_.emplace_back(std::move(mem), wal_log_number);
+    }
+  }
+  if (pending_flushes_.empty()) {
     return;
   }
-  size_t new_sst_id = l0_sst_ids_.empty() ? 0 : l0_sst_ids_.back() + 1;
-  constexpr std::size_t kBlockSize = 4096;
+  // 从最旧的开始依次刷盘，之前失败留下的 memtable 也在其中。失败时它和
+  // 更新的 memtable 都留在队列中，它们的 WAL segment 也不会被释放
+  while (!pending_flushes_.empty()) {
+    const auto& [imm, wal_log_number] = pending_flushes_.front();
+    WriteLevel0Table(imm, wal_log_number);
+    pending_flushes_.pop_front();
+  }
+  MaybeScheduleCompaction();
+}
+
+void LSMEngine::WriteLevel0Table(const std::shared_ptr<MemTable>& imm,
+                                 uint64_t wal_log_number) {
+  size_t new_sst_id = versions_.NewFileNumber();
   SSTBuilder builder(kBlockSize);
+  builder.SetRateLimiter(rate_limiter_, IOPriority::kHigh);
+  builder.AddSeqRange(imm->min_seq(), imm->max_seq());
+
+  // 删除标记同样写入 SST，用来遮蔽更旧文件中的同一个 key
+  for (auto it = imm->NewIterator({}, true); it.Valid(); it.Next()) {
+    builder.Add(it.key(), it.value());
+  }
+
+  auto sst = std::make_shared<SST>(
+      builder.Build(new_sst_id, SstPath(new_sst_id).string(), block_cache_));
+  table_cache_->Insert(sst);
+
+  VersionEdit edit;
+  edit.AddFile(0, LevelFileMeta::FromSst(*sst));
+  if (wal_) {
+    edit.log_number = wal_log_number;
+  }
+  if (imm->min_seq() <= imm->max_seq()) {
+    edit.last_sequence = imm->max_seq();
+  }
+  auto status = versions_.LogAndApply(&edit);
+  if (!status.ok()) {
+    throw std::runtime_error(status.ToString());
+  }
+  // 新的 Version 和去掉 imm 的 memtable 列表一起生效，读者不会看到数据
+  // 既不在 memtable 中也不在 SST 中的中间状态
+  InstallSuperVersion([&](SuperVersion* next) {
+    std::erase(next->imm, imm);
+  });
+  if (wal_) {
+    status = wal_->ReleaseSegmentsBefore(wal_log_number);
+    if (!status.ok()) {
+      throw std::runtime_error(status.ToString());
+    }
+  }
+}
+
+std::shared_ptr<const SuperVersion> LSMEngine::GetSuperVersion() const {
+  return super_version_.load(std::memory_order_acquire);
+}
+
+void LSMEngine::InstallSuperVersion(
+    const std::function<void(SuperVersion*)>& update) {
+  std::lock_guard<std::mutex> lock(super_version_mutex_);
+  auto next = std::make_shared<SuperVersion>(*GetSuperVersion());
+  if (update) {
+    update(next.get());
+  }
+  next->current = versions_.current();
+  super_version_.store(std::move(next), std::memory_order_release);
+}
+
+Status LSMEngine::WaitForCompactions() {
+  std::unique_lock<std::mutex> lock(compaction_mutex_);
+  compaction_cv_.wait(lock, [&] { return running_compactions_ == 0; });
+  return bg_error_;
+}
+
+void LSMEngine::MaybeScheduleCompaction() {
+  std::lock_guard<std::mutex> lock(compaction_mutex_);
+  MaybeScheduleCompactionLocked();
+}
 
-  for (auto it = memtable_.begin(); it != memtable_.end(); ++it) {
-    const auto [key, value] = *it;
-    builder.Add(key, value);
+void LSMEngine::MaybeScheduleCompactionLocked() {
+  if (!compaction_pool_ || shutting_down_ || !bg_error_.ok()) {
+    return;
   }
+  while (running_compactions_ <
+         compaction_options_.max_background_compactions) {
+    auto compaction = picker_->Pick(*versions_.current(), being_compacted_);
+    if (!compaction) {
+      return;
+    }
+    for (auto id : compaction->InputIds()) {
+      being_compacted_.insert(id);
+    }
+    running_compactions_++;
+    compaction_pool_->Submit([this, c = std::move(*compaction)] {
+      BackgroundCompaction(c);
+    });
+  }
+}
 
-  auto sst = builder.Build(new_sst_id, SstPath(new_sst_id).string());
-  ssts_.emplace(new_sst_id, std::make_shared<SST>(std::move(sst)));
+void LSMEngine::CompactionTimerLoop() {
+  auto interval =
+      std::chrono::milliseconds(compaction_options_.fifo_check_interval_ms);
+  std::unique_lock<std::mutex> lock(compaction_mutex_);
+  while (!shutting_down_) {
+    // compaction_cv_ 在每个 compaction 结束时也会被唤醒，按截止时间等待
+    auto deadline = std::chrono::steady_clock::now() + interval;
+    if (compaction_cv_.wait_until(lock, deadline,
+                                  [&] { return shutting_down_; })) {
+      break;
+    }
+    MaybeScheduleCompactionLocked();
+  }
+}
+
+void LSMEngine::BackgroundCompaction(const Compaction& compaction) {
+  Status status;
+  {
+    std::lock_guard<std::mutex> lock(compaction_mutex_);
+    if (shutting_down_) {
+      status = Status::IOError("shutting down");
+    }
+  }
+  if (status.ok()) {
+    status = DoCompaction(compaction);
+  }
+  // trivial move 不产生待删除的文件，但之前的 compaction 因旧 Version 仍被
+  // 其他 compaction 持有而留下的文件需要在这里重试
+  if (status.ok()) {
+    DeleteObsoleteFiles();
+  }
 
-  l0_sst_ids_.push_back(new_sst_id);
-  memtable_.Clear();
+  std::lock_guard<std::mutex> lock(compaction_mutex_);
+  for (auto id : compaction.InputIds()) {
+    being_compacted_.erase(id);
+  }
+  running_compactions_--;
+  if (!status.ok() && !shutting_down_ && bg_error_.ok()) {
+    bg_error_ = status;
+  }
+  // 这次 compaction 可能让下一层超过目标大小
+  MaybeScheduleCompactionLocked();
+  compaction_cv_.notify_all();
+}
+
+Status LSMEngine::DoCompaction(const Compaction& compaction) {
+  VersionEdit edit;
+  if (compaction.IsTrivialMove()) {
+    const auto& file = compaction.inputs[0];
+    edit.DeleteFile(compaction.level, file.sst_id);
+    edit.AddFile(compaction.output_level, file);
+    auto status = versions_.LogAndApply(&edit);
+    if (status.ok()) {
+      InstallSuperVersion();
+    }
+    return status;
+  }
+
+  Status status;
+  if (compaction.deletion_only) {
+    for (const auto& file : compaction.inputs) {
+      edit.DeleteFile(compaction.level, file.sst_id);
+    }
+    status = versions_.LogAndApply(&edit);
+  } else {
+    CompactionJob job(
+        compaction, versions_.current(), table_cache_,
+        [this] { return versions_.NewFileNumber(); }, compaction_options_);
+    job.SetRateLimiter(rate_limiter_);
+    job.SetMergeOperator(merge_operator_);
+    job.SetThreadPool(subcompaction_pool_.get());
+    status = job.Run(&edit);
+    if (status.ok()) {
+      status = versions_.LogAndApply(&edit);
+    }
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  InstallSuperVersion();
+  std::lock_guard<std::mutex> lock(compaction_mutex_);
+  for (auto id : compaction.InputIds()) {
+    obsolete_files_.push_back(id);
+  }
+  return Status::OK();
+}
+
+void LSMEngine::DeleteObsoleteFiles() {
+  std::lock_guard<std::mutex> delete_lock(delete_files_mutex_);
+  std::vector<size_t> candidates;
+  {
+    std::lock_guard<std::mutex> lock(compaction_mutex_);
+    candidates.swap(obsolete_files_);
+  }
+  std::unordered_set<size_t> live;
+  versions_.AddLiveFiles(&live);
+
+  std::vector<size_t> still_used;
+  for (auto id : candidates) {
+    if (live.contains(id)) {
+      still_used.push_back(id);
+      continue;
+    }
+    table_cache_->Evict(id);
+    std::error_code ec;
+    std::filesystem::remove(SstPath(id), ec);
+  }
+  std::lock_guard<std::mutex> lock(compaction_mutex_);
+  obsolete_files_.insert(obsolete_files_.end(), still_used.begin(),
+                         still_used.end());
+}
+
+void LSMEngine::DeleteOrphanFiles() {
+  std::unordered_set<size_t> live;
+  versions_.AddLiveFiles(&live);
+  std::vector<std::filesystem::path> orphans;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(data_dir_, ec)) {
+    size_t sst_id;
+    if (TableCache::ParseSstFileName(entry.path(), &sst_id) &&
+        !live.contains(sst_id)) {
+      orphans.push_back(entry.path());
+    }
+  }
+  for (const auto& path : orphans) {
+    std::filesystem::remove(path, ec);
+  }
+}
+
+LSMEngine::InternalIterator LSMEngine::NewInternalIterator(
+    const ReadOptions& options) const {
+  return NewInternalIterator(GetSuperVersion(), options);
+}
+
+LSMEngine::InternalIterator LSMEngine::NewInternalIterator(
+    const std::shared_ptr<const SuperVersion>& super_version,
+    const ReadOptions& options) const {
+  // memtable 从新到旧排列：活跃的在前，之后是冻结的
+  std::vector<MemTableIterator> mem_iters;
+  mem_iters.push_back(super_version->mem->NewIterator(options, true));
+  for (const auto& imm : super_version->imm) {
+    mem_iters.push_back(imm->NewIterator(options, true));
+  }
+  // L0 的子迭代器按从新到旧排列
+  std::vector<SstIterator> l0_iters;
+  auto version = super_version->current;
+  const auto& l0_files = version->files(0);
+  for (auto file = l0_files.rbegin(); file != l0_files.rend(); ++file) {
+    l0_iters.emplace_back(table_cache_->Get(file->sst_id), options);
+  }
+  // opener 持有 version，保证遍历期间文件不会被删除
+  SstOpener opener = [cache = table_cache_, version](size_t sst_id) {
+    return cache->Get(sst_id);
+  };
+  std::vector<LevelIterator> level_iters;
+  for (size_t level = 1; level < version->num_levels(); level++) {
+    if (!version->files(level).empty()) {
+      level_iters.emplace_back(version->files(level), opener, options);
+    }
+  }
+  return InternalIterator(
+      TwoMergeIterator<MergeIterator<MemTableIterator>, L0Iterator>(
+          MergeIterator<MemTableIterator>(std::move(mem_iters)),
+          L0Iterator(std::move(l0_iters))),
+      MergeIterator<LevelIterator>(std::move(level_iters)));
+}
+
+EngineIterator LSMEngine::NewIterator(const ReadOptions& options) const {
+  return EngineIterator(NewInternalIterator(options), options,
+                        merge_operator_);
+}
+
+Status LSMEngine::Scan(
+    std::string_view begin, std::string_view end, size_t limit,
+    std::vector<std::pair<std::string, std::string>>* result) const {
+  ReadOptions options;
+  if (!begin.empty()) {
+    options.lower_bound = std::string(begin);
+  }
+  if (!end.empty()) {
+    options.upper_bound = std::string(end);
+  }
+  try {
+    for (auto iter = NewIterator(options); iter.Valid() && limit > 0;
+         iter.Next(), limit--) {
+      result->emplace_back(iter.key(), iter.value());
+    }
+  } catch (const std::exception& e) {
+    return Status::Corruption(e.what());
+  }
+  return Status::OK();
+}
+
+std::vector<std::string> LSMEngine::SplitRange(std::string_view start,
+                                               std::string_view end,
+                                               size_t num_partitions) const {
+  // 候选切分点是范围内所有 block 的 first_key，数据多的区间候选点也多
+  std::vector<std::string_view> candidates;
+  auto version = GetSuperVersion()->current;
+  for (const auto& file : version->files(0)) {
+    if (file.last_key <= start ||
+        (!end.empty() && file.first_key >= end)) {
+      continue;
+    }
+    for (const auto& meta : table_cache_->Get(file.sst_id)->block_metas()) {
+      if (meta.first_key_ > start && (end.empty() || meta.first_key_ < end)) {
+        candidates.push_back(meta.first_key_);
+      }
+    }
+  }
+  // L1 及以下的文件大小有上限，用文件边界切分就足够均匀，不必打开文件
+  for (size_t level = 1; level < version->num_levels(); level++) {
+    for (const auto& file : version->files(level)) {
+      if (file.first_key > start && (end.empty() || file.first_key < end)) {
+        candidates.push_back(file.first_key);
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  std::vector<std::string> splits;
+  if (num_partitions <= 1 || candidates.empty()) {
+    return splits;
+  }
+  num_partitions = std::min(num_partitions, candidates.size() + 1);
+  for (size_t i = 1; i < num_partitions; i++) {
+    auto split = candidates[i * candidates.size() / num_partitions];
+    if (splits.empty() || splits.back() != split) {
+      splits.emplace_back(split);
+    }
+  }
+  return splits;
+}
+
+Status LSMEngine::ParallelScan(std::string_view start, std::string_view end,
+                               const ScanOptions& options,
+                               const ScanCallback& callback) const {
+  size_t num_threads = options.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // 所有分片共用同一个 SuperVersion，看到同一组 memtable 和 SST
+  auto super_version = GetSuperVersion();
+  // 分片数多于线程数，避免数据倾斜时个别线程拖慢整体
+  auto splits = SplitRange(start, end, num_threads * 4);
+  std::shared_ptr<BlockPrefetcher> prefetcher;
+  if (options.prefetch_threads > 0) {
+    prefetcher = std::make_shared<BlockPrefetcher>(options.prefetch_threads);
+  }
+  std::vector<ReadOptions> ranges(splits.size() + 1);
+  for (size_t i = 0; i < ranges.size(); i++) {
+    ranges[i].prefetcher = prefetcher;
+    ranges[i].lower_bound = i == 0 ? std::string(start) : splits[i - 1];
+    if (i < splits.size()) {
+      ranges[i].upper_bound = splits[i];
+    } else if (!end.empty()) {
+      ranges[i].upper_bound = std::string(end);
+    }
+  }
+
+  std::atomic<bool> stop{false};
+  // 扫描一个分片，对每条有效记录调用 emit，emit 返回 false 时停止
+  auto scan = [&](const ReadOptions& range, auto&& emit) -> Status {
+    try {
+      EngineIterator iter(NewInternalIterator(super_version, range), range,
+                          merge_operator_);
+      for (; iter.Valid() && !stop.load(std::memory_order_relaxed);
+           iter.Next()) {
+        if (!emit(iter.key(), iter.value())) {
+          stop.store(true, std::memory_order_relaxed);
+          break;
+        }
+      }
+    } catch (const std::exception& e) {
+      stop.store(true, std::memory_order_relaxed);
+      return Status::Corruption(e.what());
+    }
+    return Status::OK();
+  };
+
+  size_t pool_threads = std::min(num_threads, ranges.size());
+  ThreadPool pool(pool_threads);
+  Status result;
+  if (!options.ordered) {
+    std::vector<std::future<Status>> futures;
+    for (const auto& range : ranges) {
+      futures.push_back(
+          pool.Submit([&] { return scan(range, callback); }));
+    }
+    for (auto& future : futures) {
+      auto status = future.get();
+      if (result.ok() && !status.ok()) {
+        result = status;
+      }
+    }
+    return result;
+  }
+
+  // 有序模式：分片并行扫描到各自的缓冲区，调用线程按分片顺序依次回调，
+  // 前面的分片回调时后面的分片仍在扫描。同时最多有线程数个分片在扫描或
+  // 等待回调，调用线程取走一个分片后才提交下一个，缓冲区占用的内存有界
+  using Buffer = std::vector<std::pair<std::string, std::string>>;
+  std::deque<std::future<std::pair<Status, Buffer>>> in_flight;
+  size_t next = 0;
+  auto submit_next = [&] {
+    in_flight.push_back(pool.Submit([&, range = &ranges[next++]] {
+      Buffer buffer;
+      auto status = scan(*range, [&](std::string_view k, std::string_view v) {
+        buffer.emplace_back(k, v);
+        return true;
+      });
+      return std::make_pair(status, std::move(buffer));
+    }));
+  };
+  while (next < ranges.size() && in_flight.size() < pool_threads) {
+    submit_next();
+  }
+  while (!in_flight.empty()) {
+    auto [status, buffer] = in_flight.front().get();
+    in_flight.pop_front();
+    if (!result.ok() || stop.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    if (next < ranges.size()) {
+      submit_next();
+    }
+    if (!status.ok()) {
+      result = status;
+      continue;
+    }
+    for (const auto& [k, v] : buffer) {
+      if (!callback(k, v)) {
+        stop.store(true, std::memory_order_relaxed);
+        break;
+      }
+    }
+  }
+  return result;
 }
 
 std::filesystem::path LSMEngine::SstPath(std::size_t sst_id) const {
-  return data_dir_ / std::format("sst_{}", sst_id);
+  return table_cache_->SstPath(sst_id);
+}
+
+std::filesystem::path LSMEngine::WalDir() const { return data_dir_ / "wal"; }
+
+EngineIterator::EngineIterator(
+    LSMEngine::InternalIterator iter, const ReadOptions& options,
+    std::shared_ptr<const MergeOperator> merge_operator)
+    : iter_(std::move(iter)),
+      options_(options),
+      merge_operator_(std::move(merge_operator)) {
+  SkipDeletionsForward();
+}
+
+bool EngineIterator::Valid() const {
+  return iter_.Valid() && !options_.BeyondUpper(iter_.key()) &&
+         !options_.BelowLower(iter_.key());
+}
+
+bool EngineIterator::Resolve() {
+  merged_ = false;
+  std::string_view payload;
+  switch (DecodeValue(iter_.value(), &payload)) {
+    case ValueType::kDeletion:
+      return false;
+    case ValueType::kValue:
+      return true;
+    case ValueType::kMerge:
+      break;
+  }
+  if (!merge_operator_) {
+    throw std::runtime_error(
+        Status::InvalidArgument("merge operand found without a merge operator")
+            .ToString());
+  }
+  // 内部迭代器的各个子迭代器都还停在当前 key 上，旧版本可以直接访问
+  operands_.clear();
+  std::optional<std::string_view> base;
+  CollectMergeOperands(iter_, &operands_, &base);
+  merged_value_ = FullMerge(*merge_operator_, iter_.key(), base, operands_);
+  merged_ = true;
+  return !merged_value_.empty();
+}
+
+void EngineIterator::SkipDeletionsForward() {
+  while (Valid() && !Resolve()) {
+    iter_.Next();
+  }
+}
+
+void EngineIterator::SkipDeletionsBackward() {
+  while (Valid() && !Resolve()) {
+    iter_.Prev();
+  }
+}
+
+void EngineIterator::SeekToFirst() {
+  iter_.SeekToFirst();
+  SkipDeletionsForward();
+}
+
+void EngineIterator::SeekToLast() {
+  iter_.SeekToLast();
+  // 上界不包含在范围内
+  while (iter_.Valid() && options_.BeyondUpper(iter_.key())) {
+    iter_.Prev();
+  }
+  SkipDeletionsBackward();
+}
+
+Status EngineIterator::Seek(std::string_view target) {
+  if (options_.BelowLower(target)) {
+    target = *options_.lower_bound;
+  }
+  iter_.Seek(target);
+  SkipDeletionsForward();
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+Status EngineIterator::SeekForPrev(std::string_view target) {
+  iter_.SeekForPrev(target);
+  while (iter_.Valid() && options_.BeyondUpper(iter_.key())) {
+    iter_.Prev();
+  }
+  SkipDeletionsBackward();
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+void EngineIterator::Next() {
+  if (Valid()) {
+    iter_.Next();
+    SkipDeletionsForward();
+  }
+}
+
+void EngineIterator::Prev() {
+  if (Valid()) {
+    iter_.Prev();
+    SkipDeletionsBackward();
+  }
+}
+
+std::string_view EngineIterator::key() const { return iter_.key(); }
+
+std::string_view EngineIterator::value() const {
+  if (merged_) {
+    return merged_value_;
+  }
+  std::string_view payload;
+  DecodeValue(iter_.value(), &payload);
+  return payload;
 }
 
 LSM::LSM(std::filesystem::path path) : engine_(std::move(path)) {}
@@ -0,0 +1,23 @@
+#include "lsm/merge_operator.h"
+
+std::string FullMerge(const MergeOperator& op, std::string_view key,
+                      std::optional<std::string_view> base,
+                      const std::vector<std::string>& operands) {
+  std::optional<std::string> result;
+  if (base) {
+    result.emplace(*base);
+  }
+  for (auto it = operands.rbegin(); it != operands.rend(); ++it) {
+    result = op.Merge(key, result, *it);
+  }
+  return result.value_or(std::string());
+}
+
+std::string PartialMerge(const MergeOperator& op, std::string_view key,
+                         const std::vector<std::string>& operands) {
+  std::string result = operands.back();
+  for (auto it = operands.rbegin() + 1; it != operands.rend(); ++it) {
+    result = op.Merge(key, result, *it);
+  }
+  return result;
+}
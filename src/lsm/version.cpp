@@ -0,0 +1,539 @@
+#include "lsm/version.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+
+namespace {
+
+enum Tag : uint8_t {
+  kLogNumber = 1,
+  kNextFileNumber = 2,
+  kDeletedFile = 3,
+  kNewFile = 4,
+  kNewFileEpoch = 5,
+  kNewFileTime = 6,
+  kLastSequence = 7,
+};
+
+constexpr size_t kRecordHeaderSize = sizeof(uint32_t) * 2;
+
+uint32_t HashRecord(std::string_view data) {
+  return std::hash<std::string_view>()(data);
+}
+
+template <typename T>
+void PutFixed(std::string* dst, T value) {
+  dst->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool GetFixed(std::string_view* src, T* value) {
+  if (src->size() < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, src->data(), sizeof(T));
+  src->remove_prefix(sizeof(T));
+  return true;
+}
+
+void PutLengthPrefixed(std::string* dst, std::string_view value) {
+  PutFixed(dst, static_cast<uint32_t>(value.size()));
+  dst->append(value);
+}
+
+bool GetLengthPrefixed(std::string_view* src, std::string* value) {
+  uint32_t len;
+  if (!GetFixed(src, &len) || src->size() < len) {
+    return false;
+  }
+  value->assign(src->data(), len);
+  src->remove_prefix(len);
+  return true;
+}
+
+// data 中 offset 0 之后的某个位置是否有一条完整且校验通过的记录，用于区分
+// 写了一半的尾部和文件中间的损坏
+bool HasValidRecordAfter(std::string_view data) {
+  for (size_t pos = 1; pos + kRecordHeaderSize <= data.size(); pos++) {
+    std::string_view header = data.substr(pos);
+    uint32_t hash = 0;
+    uint32_t length = 0;
+    if (GetFixed(&header, &hash) && GetFixed(&header, &length) &&
+        length > 0 && header.size() >= length &&
+        hash == HashRecord(header.substr(0, length))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string FrameRecord(std::string_view payload) {
+  std::string record;
+  record.reserve(kRecordHeaderSize + payload.size());
+  PutFixed(&record, HashRecord(payload));
+  PutFixed(&record, static_cast<uint32_t>(payload.size()));
+  record.append(payload);
+  return record;
+}
+
+Status WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    auto n = ::write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return Status::IOError(
+          std::format("manifest write: {}", std::strerror(errno)));
+    }
+    data.remove_prefix(static_cast<size_t>(n));
+  }
+  if (::fdatasync(fd) != 0) {
+    return Status::IOError(
+        std::format("manifest sync: {}", std::strerror(errno)));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+std::string VersionEdit::Encode() const {
+  std::string dst;
+  if (log_number) {
+    PutFixed(&dst, kLogNumber);
+    PutFixed(&dst, *log_number);
+  }
+  if (next_file_number) {
+    PutFixed(&dst, kNextFileNumber);
+    PutFixed(&dst, *next_file_number);
+  }
+  if (last_sequence) {
+    PutFixed(&dst, kLastSequence);
+    PutFixed(&dst, *last_sequence);
+  }
+  for (const auto& [level, sst_id] : deleted_files) {
+    PutFixed(&dst, kDeletedFile);
+    PutFixed(&dst, static_cast<uint32_t>(level));
+    PutFixed(&dst, static_cast<uint64_t>(sst_id));
+  }
+  for (const auto& [level, meta] : new_files) {
+    PutFixed(&dst, kNewFileTime);
+    PutFixed(&dst, static_cast<uint32_t>(level));
+    PutFixed(&dst, static_cast<uint64_t>(meta.sst_id));
+    PutFixed(&dst, meta.file_size);
+    PutLengthPrefixed(&dst, meta.first_key);
+    PutLengthPrefixed(&dst, meta.last_key);
+    PutFixed(&dst, meta.epoch);
+    PutFixed(&dst, meta.creation_time);
+  }
+  return dst;
+}
+
+bool VersionEdit::Decode(std::string_view src, VersionEdit* edit) {
+  *edit = VersionEdit();
+  while (!src.empty()) {
+    uint8_t tag;
+    GetFixed(&src, &tag);
+    uint64_t number;
+    uint32_t level;
+    switch (tag) {
+      case kLogNumber:
+        if (!GetFixed(&src, &number)) {
+          return false;
+        }
+        edit->log_number = number;
+        break;
+      case kNextFileNumber:
+        if (!GetFixed(&src, &number)) {
+          return false;
+        }
+        edit->next_file_number = number;
+        break;
+      case kLastSequence:
+        if (!GetFixed(&src, &number)) {
+          return false;
+        }
+        edit->last_sequence = number;
+        break;
+      case kDeletedFile:
+        if (!GetFixed(&src, &level) || !GetFixed(&src, &number)) {
+          return false;
+        }
+        edit->DeleteFile(level, number);
+        break;
+      case kNewFile:
+      case kNewFileEpoch:
+      case kNewFileTime: {
+        LevelFileMeta meta;
+        if (!GetFixed(&src, &level) || !GetFixed(&src, &number) ||
+            !GetFixed(&src, &meta.file_size) ||
+            !GetLengthPrefixed(&src, &meta.first_key) ||
+            !GetLengthPrefixed(&src, &meta.last_key)) {
+          return false;
+        }
+        meta.sst_id = number;
+        meta.epoch = number;
+        if (tag != kNewFile && !GetFixed(&src, &meta.epoch)) {
+          return false;
+        }
+        if (tag == kNewFileTime && !GetFixed(&src, &meta.creation_time)) {
+          return false;
+        }
+        edit->AddFile(level, std::move(meta));
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+size_t Version::num_files() const {
+  size_t n = 0;
+  for (const auto& files : levels_) {
+    n += files.size();
+  }
+  return n;
+}
+
+uint64_t Version::level_size(size_t level) const {
+  uint64_t size = 0;
+  for (const auto& file : levels_[level]) {
+    size += file.file_size;
+  }
+  return size;
+}
+
+void Version::BuildL0Index() {
+  const auto& files = levels_[0];
+  l0_by_first_key_.resize(files.size());
+  for (size_t i = 0; i < files.size(); i++) {
+    l0_by_first_key_[i] = i;
+  }
+  std::sort(l0_by_first_key_.begin(), l0_by_first_key_.end(),
+            [&](size_t a, size_t b) {
+              return files[a].first_key < files[b].first_key;
+            });
+  l0_max_last_.resize(files.size());
+  if (!files.empty()) {
+    BuildL0Subtree(0, files.size());
+  }
+}
+
+size_t Version::BuildL0Subtree(size_t lo, size_t hi) {
+  const auto& files = levels_[0];
+  size_t mid = lo + (hi - lo) / 2;
+  size_t max = l0_by_first_key_[mid];
+  auto update = [&](size_t child) {
+    if (files[child].last_key > files[max].last_key) {
+      max = child;
+    }
+  };
+  if (lo < mid) {
+    update(BuildL0Subtree(lo, mid));
+  }
+  if (mid + 1 < hi) {
+    update(BuildL0Subtree(mid + 1, hi));
+  }
+  l0_max_last_[mid] = max;
+  return max;
+}
+
+void Version::QueryL0Index(std::string_view key, size_t lo, size_t hi,
+                           std::vector<size_t>* result) const {
+  const auto& files = levels_[0];
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (files[l0_max_last_[mid]].last_key < key) {
+      return;
+    }
+    QueryL0Index(key, lo, mid, result);
+    const auto& file = files[l0_by_first_key_[mid]];
+    // 右子树的 first_key 都不小于当前节点
+    if (file.first_key > key) {
+      return;
+    }
+    if (file.last_key >= key) {
+      result->push_back(l0_by_first_key_[mid]);
+    }
+    lo = mid + 1;
+  }
+}
+
+void Version::L0FilesContaining(std::string_view key,
+                                std::vector<size_t>* result) const {
+  result->clear();
+  QueryL0Index(key, 0, l0_by_first_key_.size(), result);
+  // files(0) 按 epoch 从旧到新排列，下标越大越新
+  std::sort(result->begin(), result->end(), std::greater<>());
+}
+
+VersionBuilder::VersionBuilder(const Version& base)
+    : levels_(base.num_levels()) {
+  for (size_t level = 0; level < levels_.size(); level++) {
+    levels_[level].files = base.files(level);
+  }
+}
+
+void VersionBuilder::Apply(const VersionEdit& edit) {
+  for (const auto& [level, sst_id] : edit.deleted_files) {
+    if (level < levels_.size()) {
+      levels_[level].deleted.push_back(sst_id);
+    }
+  }
+  for (const auto& [level, meta] : edit.new_files) {
+    if (level >= levels_.size()) {
+      levels_.resize(level + 1);
+    }
+    levels_[level].files.push_back(meta);
+  }
+}
+
+std::shared_ptr<Version> VersionBuilder::Finish() {
+  auto version = std::make_shared<Version>(levels_.size());
+  for (size_t level = 0; level < levels_.size(); level++) {
+    auto& state = levels_[level];
+    std::unordered_set<size_t> deleted(state.deleted.begin(),
+                                       state.deleted.end());
+    auto& files = version->levels_[level];
+    files.reserve(state.files.size());
+    for (auto& file : state.files) {
+      if (!deleted.contains(file.sst_id)) {
+        files.push_back(std::move(file));
+      }
+    }
+    if (level == 0) {
+      std::stable_sort(files.begin(), files.end(),
+                       [](const LevelFileMeta& a, const LevelFileMeta& b) {
+                         return a.epoch < b.epoch;
+                       });
+    } else {
+      std::sort(files.begin(), files.end(),
+                [](const LevelFileMeta& a, const LevelFileMeta& b) {
+                  return a.first_key < b.first_key;
+                });
+    }
+  }
+  version->BuildL0Index();
+  levels_.clear();
+  return version;
+}
+
+VersionSet::VersionSet(std::filesystem::path dir)
+    : dir_(std::move(dir)), current_(std::make_shared<Version>()) {}
+
+VersionSet::~VersionSet() {
+  if (manifest_fd_ >= 0) {
+    ::close(manifest_fd_);
+  }
+}
+
+std::filesystem::path VersionSet::ManifestPath() const {
+  return dir_ / "MANIFEST";
+}
+
+Status VersionSet::Recover() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  VersionBuilder builder(*current_);
+  uint64_t next_file_number = next_file_number_;
+  uint64_t log_number = log_number_;
+  uint64_t last_sequence = last_sequence_;
+  // 回放到的有效长度，小于文件大小时说明尾部是写了一半的记录
+  size_t valid_size = 0;
+  size_t file_size = 0;
+
+  std::error_code ec;
+  bool exists = std::filesystem::exists(ManifestPath(), ec);
+  if (exists) {
+    std::ifstream in(ManifestPath(), std::ios::binary);
+    if (!in) {
+      return Status::IOError("open manifest");
+    }
+    std::string data(std::filesystem::file_size(ManifestPath()), '\0');
+    in.read(data.data(), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<size_t>(in.gcount()));
+    file_size = data.size();
+    std::string_view rest(data);
+    VersionEdit edit;
+    while (!rest.empty()) {
+      std::string_view header = rest;
+      uint32_t hash = 0;
+      uint32_t length = 0;
+      if (!GetFixed(&header, &hash) || !GetFixed(&header, &length) ||
+          header.size() < length ||
+          hash != HashRecord(header.substr(0, length))) {
+        // 写了一半或被置零的尾部记录对应一次没有成功返回的 LogAndApply，
+        // 忽略即可；之后还有完整的记录则是文件中间损坏，不能丢掉后面的 edit
+        if (HasValidRecordAfter(rest)) {
+          return Status::Corruption("bad manifest record");
+        }
+        break;
+      }
+      if (!VersionEdit::Decode(header.substr(0, length), &edit)) {
+        return Status::Corruption("bad manifest record");
+      }
+      builder.Apply(edit);
+      if (edit.log_number) {
+        log_number = std::max(log_number, *edit.log_number);
+      }
+      if (edit.next_file_number) {
+        next_file_number = std::max(next_file_number, *edit.next_file_number);
+      }
+      if (edit.last_sequence) {
+        last_sequence = std::max(last_sequence, *edit.last_sequence);
+      }
+      rest.remove_prefix(kRecordHeaderSize + length);
+      valid_size += kRecordHeaderSize + length;
+    }
+  }
+
+  auto version = builder.Finish();
+  for (size_t level = 0; level < version->num_levels(); level++) {
+    for (const auto& file : version->files(level)) {
+      next_file_number = std::max<uint64_t>(next_file_number, file.sst_id + 1);
+    }
+  }
+  current_ = std::move(version);
+  // 与 LogAndApply 一致，启动时的 Version 被读者持有期间其文件也不能删除
+  versions_.push_back(current_);
+  next_file_number_ = next_file_number;
+  log_number_ = log_number;
+  last_sequence_ = last_sequence;
+  torn_tail_ = valid_size < file_size;
+  if (!torn_tail_ || !exists) {
+    return WriteSnapshot();
+  }
+
+  // 尾部不完整时不重写 MANIFEST，只截掉不完整的部分后继续追加
+  std::filesystem::resize_file(ManifestPath(), valid_size, ec);
+  if (ec) {
+    return Status::IOError(ec.message());
+  }
+  manifest_fd_ = ::open(ManifestPath().c_str(), O_WRONLY | O_APPEND);
+  if (manifest_fd_ < 0) {
+    return Status::IOError(
+        std::format("open manifest: {}", std::strerror(errno)));
+  }
+  return Status::OK();
+}
+
+Status VersionSet::WriteSnapshot() {
+  VersionEdit snapshot;
+  snapshot.log_number = log_number_;
+  snapshot.next_file_number = next_file_number_;
+  snapshot.last_sequence = last_sequence_;
+  for (size_t level = 0; level < current_->num_levels(); level++) {
+    for (const auto& file : current_->files(level)) {
+      snapshot.AddFile(level, file);
+    }
+  }
+
+  // 先写临时文件再改名，任何时刻磁盘上都有一个完整的 MANIFEST
+  auto tmp_path = dir_ / "MANIFEST.tmp";
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return Status::IOError(
+        std::format("create manifest: {}", std::strerror(errno)));
+  }
+  auto status = WriteAll(fd, FrameRecord(snapshot.Encode()));
+  ::close(fd);
+  if (!status.ok()) {
+    return status;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp_path, ManifestPath(), ec);
+  if (ec) {
+    return Status::IOError(ec.message());
+  }
+  int dir_fd = ::open(dir_.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd >= 0) {
+    ::fsync(dir_fd);
+    ::close(dir_fd);
+  }
+
+  if (manifest_fd_ >= 0) {
+    ::close(manifest_fd_);
+  }
+  manifest_fd_ = ::open(ManifestPath().c_str(), O_WRONLY | O_APPEND);
+  if (manifest_fd_ < 0) {
+    return Status::IOError(
+        std::format("open manifest: {}", std::strerror(errno)));
+  }
+  return Status::OK();
+}
+
+Status VersionSet::AppendRecord(const std::string& record) {
+  if (manifest_fd_ < 0) {
+    return Status::IOError("manifest is not open");
+  }
+  return WriteAll(manifest_fd_, record);
+}
+
+Status VersionSet::LogAndApply(VersionEdit* edit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  edit->next_file_number = next_file_number_;
+  auto status = AppendRecord(FrameRecord(edit->Encode()));
+  if (!status.ok()) {
+    return status;
+  }
+
+  VersionBuilder builder(*current_);
+  builder.Apply(*edit);
+  current_ = builder.Finish();
+  // 每次安装时清理，没有 compaction 时列表也不会无限增长
+  std::erase_if(versions_, [](const auto& version) { return version.expired(); });
+  versions_.push_back(current_);
+  if (edit->log_number) {
+    log_number_ = std::max(log_number_, *edit->log_number);
+  }
+  if (edit->last_sequence) {
+    last_sequence_ = std::max(last_sequence_, *edit->last_sequence);
+  }
+  return Status::OK();
+}
+
+std::shared_ptr<const Version> VersionSet::current() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return current_;
+}
+
+void VersionSet::AddLiveFiles(std::unordered_set<size_t>* live) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto add = [&](const Version& version) {
+    for (size_t level = 0; level < version.num_levels(); level++) {
+      for (const auto& file : version.files(level)) {
+        live->insert(file.sst_id);
+      }
+    }
+  };
+  add(*current_);
+  for (const auto& weak : versions_) {
+    if (auto version = weak.lock()) {
+      add(*version);
+    }
+  }
+}
+
+uint64_t VersionSet::NewFileNumber() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_file_number_++;
+}
+
+uint64_t VersionSet::log_number() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return log_number_;
+}
+
+uint64_t VersionSet::last_sequence() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_sequence_;
+}
@@ -1,5 +1,7 @@
 #include "memtable/memtable.h"
 
+#include <algorithm>
+
 #include "memtable/memtable_iterator.h"
 
 MemTable::MemTable() : frozen_bytes_(0) {
@@ -8,9 +10,11 @@ MemTable::MemTable() : frozen_bytes_(0) {
 
 MemTable::~MemTable() = default;
 
-void MemTable::Put(const std::string& key, const std::string& value) {
+void MemTable::Put(const std::string& key, const std::string& value,
+                   uint64_t seq) {
   std::unique_lock<std::shared_mutex> lock{rw_mutex_};
   table_->Put(key, value);
+  RecordSeqLocked(seq);
 }
 
 std::optional<std::string> MemTable::Get(const std::string& key) const {
@@ -38,9 +42,65 @@ std::optional<std::string> MemTable::Get(const std::string& key) const {
   return std::nullopt;
 }
 
-void MemTable::Remove(const std::string& key) {
+Status MemTable::Get(const std::string& key, std::string* value) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  if (auto result = table_->Get(key); result.has_value()) {
+    *value = std::move(*result);
+    return Status::OK();
+  }
+  for (auto& t : frozen_tables_) {
+    if (auto result = t->Get(key); result.has_value()) {
+      *value = std::move(*result);
+      return Status::OK();
+    }
+  }
+  return Status::NotFound();
+}
+
+std::vector<std::optional<std::string>> MemTable::MultiGet(
+    std::span<const std::string> keys) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  std::vector<std::optional<std::string>> results(keys.size());
+  // 仍需要继续查找的 key 在 keys 中的下标
+  std::vector<size_t> pending(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    pending[i] = i;
+  }
+
+  auto probe = [&](const SkipList& table) {
+    auto found = table.MultiGet(keys, pending);
+
+    std::vector<size_t> remaining;
+    for (size_t i = 0; i < pending.size(); i++) {
+      if (!found[i].has_value()) {
+        remaining.push_back(pending[i]);
+      } else if (!found[i]->empty()) {
+        results[pending[i]] = std::move(found[i]);
+      }
+      // 空 value 表示删除，结果保持 nullopt 且不再查更旧的表
+    }
+    pending = std::move(remaining);
+  };
+
+  probe(*table_);
+  for (auto it = frozen_tables_.begin();
+       it != frozen_tables_.end() && !pending.empty(); ++it) {
+    probe(**it);
+  }
+  return results;
+}
+
+void MemTable::Remove(const std::string& key, uint64_t seq) {
   std::unique_lock<std::shared_mutex> lock{rw_mutex_};
   table_->Put(key, "");
+  RecordSeqLocked(seq);
+}
+
+void MemTable::RecordSeqLocked(uint64_t seq) {
+  if (seq != 0) {
+    min_seq_ = std::min(min_seq_, seq);
+    max_seq_ = std::max(max_seq_, seq);
+  }
 }
 
 void MemTable::Clear() {
@@ -75,6 +135,16 @@ size_t MemTable::total_size() const {
   return current_size() + frozen_size();
 }
 
+uint64_t MemTable::min_seq() const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return min_seq_;
+}
+
+uint64_t MemTable::max_seq() const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return max_seq_;
+}
+
 MemTableIterator MemTable::begin() const {
   std::shared_lock<std::shared_mutex> lock{rw_mutex_};
   return MemTableIterator{*this};
@@ -82,4 +152,10 @@ MemTableIterator MemTable::begin() const {
 MemTableIterator MemTable::end() const {
   std::shared_lock<std::shared_mutex> lock{rw_mutex_};
   return MemTableIterator{};
+}
+
+MemTableIterator MemTable::NewIterator(const ReadOptions& options,
+                                       bool keep_deletions) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return MemTableIterator{*this, options, keep_deletions};
 }
\ No newline at end of file
@@ -1,62 +1,151 @@
 #include "memtable/memtable_iterator.h"
 
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "memtable/memtable.h"
 
-MemTableIterator::MemTableIterator() {}
+MemTableIterator::TableIterator::TableIterator(
+    std::shared_ptr<const SkipList> table)
+    : table_(std::move(table)) {}
 
-MemTableIterator::MemTableIterator(const MemTable& memtable) {
-  auto current_table = memtable.table_;
-  for (auto it = current_table->begin(); it != current_table->end(); ++it) {
-    items_.push(SearchItem{it.key(), it.value(), 0});
+void MemTableIterator::TableIterator::SeekToFirst() {
+  node_ = table_->FirstNode();
+}
+
+void MemTableIterator::TableIterator::SeekToLast() {
+  node_ = table_->LastNode();
+}
+
+Status MemTableIterator::TableIterator::Seek(std::string_view target) {
+  node_ = table_->SeekNode(target);
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+Status MemTableIterator::TableIterator::SeekForPrev(std::string_view target) {
+  node_ = table_->SeekForPrevNode(target);
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+void MemTableIterator::TableIterator::Next() {
+  node_ = table_->NextNode(*node_);
+}
+
+void MemTableIterator::TableIterator::Prev() {
+  node_ = table_->PrevNode(*node_);
+}
+
+MemTableIterator::MemTableIterator() = default;
+
+MemTableIterator::MemTableIterator(const MemTable& memtable)
+    : MemTableIterator(memtable, ReadOptions{}) {}
+
+MemTableIterator::MemTableIterator(const MemTable& memtable,
+                                   const ReadOptions& options,
+                                   bool keep_deletions)
+    : options_(options), keep_deletions_(keep_deletions) {
+  std::vector<TableIterator> tables;
+  tables.reserve(1 + memtable.frozen_tables_.size());
+  tables.emplace_back(memtable.table_);
+  for (const auto& frozen_table : memtable.frozen_tables_) {
+    tables.emplace_back(frozen_table);
   }
+  iter_ = MergeIterator<TableIterator>(std::move(tables));
+  SeekToFirst();
+}
 
-  int level = 1;
-  for (auto it = memtable.frozen_tables_.begin();
-       it != memtable.frozen_tables_.end(); ++it) {
-    auto frozen_table = *it;
-    for (auto x = frozen_table->begin(); x != frozen_table->end(); ++x) {
-      items_.push(SearchItem{x.key(), x.value(), level});
+bool MemTableIterator::InRange() const {
+  return !options_.BeyondUpper(iter_.key()) &&
+         !options_.BelowLower(iter_.key());
+}
+
+bool MemTableIterator::Valid() const { return iter_.Valid() && InRange(); }
+
+void MemTableIterator::SkipDeletions(bool forward) {
+  if (keep_deletions_) {
+    return;
+  }
+  while (Valid() && iter_.value().empty()) {
+    if (forward) {
+      iter_.Next();
+    } else {
+      iter_.Prev();
     }
-    level++;
   }
+}
+
+void MemTableIterator::SeekToFirst() {
+  if (options_.lower_bound) {
+    iter_.Seek(*options_.lower_bound);
+  } else {
+    iter_.SeekToFirst();
+  }
+  SkipDeletions(true);
+}
 
-  // When multiple tables (current and frozen) contain the same key, we should
-  // only return the value from the newest table. The newest table is defined by
-  // the one with the smallest mem_idx_ (0 for current, 1 for first frozen,
-  // etc). In the priority queue, smaller mem_idx_ means higher priority. This
-  // loop ensures that for any given key, only the entry from the newest table
-  // is kept.
-  while (!items_.empty() && items_.top().value.empty()) {
-    auto key = items_.top().key;
-    while (!items_.empty() && items_.top().key == key) {
-      items_.pop();
+void MemTableIterator::SeekToLast() {
+  if (options_.upper_bound) {
+    // 上界不包含在范围内
+    iter_.SeekForPrev(*options_.upper_bound);
+    if (iter_.Valid() && iter_.key() == *options_.upper_bound) {
+      iter_.Prev();
     }
+  } else {
+    iter_.SeekToLast();
   }
+  SkipDeletions(false);
 }
 
-std::pair<std::string, std::string> MemTableIterator::operator*() const {
-  return std::make_pair(items_.top().key, items_.top().value);
+Status MemTableIterator::Seek(std::string_view target) {
+  if (options_.BelowLower(target)) {
+    target = *options_.lower_bound;
+  }
+  iter_.Seek(target);
+  SkipDeletions(true);
+  return Valid() ? Status::OK() : Status::NotFound();
 }
 
-MemTableIterator& MemTableIterator::operator++() {
-  if (items_.empty()) {
-    return *this;
+Status MemTableIterator::SeekForPrev(std::string_view target) {
+  if (options_.BeyondUpper(target)) {
+    SeekToLast();
+  } else {
+    iter_.SeekForPrev(target);
+    SkipDeletions(false);
   }
+  return Valid() ? Status::OK() : Status::NotFound();
+}
 
-  auto x = items_.top();
-  items_.pop();
-  while (!items_.empty() && items_.top().key == x.key) {
-    items_.pop();
+void MemTableIterator::Next() {
+  if (Valid()) {
+    iter_.Next();
+    SkipDeletions(true);
   }
+}
 
-  while (!items_.empty() && items_.top().value.empty()) {
-    auto k = items_.top().key;
-    while (!items_.empty() && items_.top().key == k) {
-      items_.pop();
-    }
+void MemTableIterator::Prev() {
+  if (Valid()) {
+    iter_.Prev();
+    SkipDeletions(false);
+  }
+}
+
+std::string_view MemTableIterator::key() const {
+  if (!Valid()) {
+    throw std::runtime_error("iterator is invalid");
   }
+  return iter_.key();
+}
+
+std::string_view MemTableIterator::value() const {
+  if (!Valid()) {
+    throw std::runtime_error("iterator is invalid");
+  }
+  return iter_.value();
+}
+
+MemTableIterator& MemTableIterator::operator++() {
+  Next();
   return *this;
 }
 
@@ -67,21 +156,15 @@ MemTableIterator MemTableIterator::operator++(int) {
 }
 
 bool MemTableIterator::operator==(const MemTableIterator& other) const {
-  if (items_.empty() && other.items_.empty()) {
+  if (IsEnd() && other.IsEnd()) {
     return true;
   }
-  if (items_.empty() || other.items_.empty()) {
+  if (IsEnd() || other.IsEnd()) {
     return false;
   }
-  if (items_.top().key != other.items_.top().key ||
-      items_.top().value != other.items_.top().value) {
-    return false;
-  }
-  return true;
+  return key() == other.key() && value() == other.value();
 }
 
 bool MemTableIterator::operator!=(const MemTableIterator& other) const {
   return !(*this == other);
 }
-
-bool MemTableIterator::IsEnd() const { return items_.empty(); }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "skiplist/skiplist.h"
 
+#include <mutex>
 #include <stdexcept>
 
 std::pair<std::string, std::string> SkipListIterator::operator*() const {
@@ -22,6 +23,19 @@ SkipListIterator SkipListIterator::operator++(int) {
   return tmp;
 }
 
+SkipListIterator& SkipListIterator::operator--() {
+  if (current_) {
+    current_ = current_->backward.lock();
+  }
+  return *this;
+}
+
+SkipListIterator SkipListIterator::operator--(int) {
+  SkipListIterator tmp = *this;
+  --(*this);
+  return tmp;
+}
+
 bool SkipListIterator::operator==(const SkipListIterator& other) const {
   return current_ == other.current_;
 }
@@ -47,7 +61,7 @@ int SkipList::random_level() {
 
 void SkipList::Put(const std::string& key, const std::string& value) {
   std::vector<std::shared_ptr<SkipListNode>> updates(max_level_, nullptr);
-  // std::unique_lock<std::shared_mutex> lock{rw_mutex_};
+  std::unique_lock<std::shared_mutex> lock{rw_mutex_};
   auto x = head_;
   // 查找每层都需要更新的前驱节点
   for (int i = current_level_ - 1; i >= 0; i--) {
@@ -59,10 +73,21 @@ void SkipList::Put(const std::string& key, const std::string& value) {
 
   // 最底层的下一个节点
   x = x->forward[0];
-  // 如果有并且key相同就替换value
+  // 如果有并且key相同就替换value。迭代器可能正持有x读它的value，
+  // 所以不原地修改，而是换成同样高度的新节点；x保留原来的forward，
+  // 停在x上的迭代器仍能继续向后遍历
   if (x && x->key == key) {
     size_bytes_ += value.size() - x->value.size();
-    x->value = value;
+    auto node = std::make_shared<SkipListNode>(
+        key, value, static_cast<int>(x->forward.size()));
+    for (size_t i = 0; i < x->forward.size(); i++) {
+      node->forward[i] = x->forward[i];
+      updates[i]->forward[i] = node;
+    }
+    node->backward = x->backward;
+    if (node->forward[0]) {
+      node->forward[0]->backward = node;
+    }
     return;
   }
 
@@ -84,6 +109,12 @@ void SkipList::Put(const std::string& key, const std::string& value) {
     new_node->forward[i] = updates[i]->forward[i];
     updates[i]->forward[i] = new_node;
   }
+  if (updates[0] != head_) {
+    new_node->backward = updates[0];
+  }
+  if (new_node->forward[0]) {
+    new_node->forward[0]->backward = new_node;
+  }
 }
 
 std::optional<std::string> SkipList::Get(const std::string& key) const {
@@ -101,10 +132,51 @@ std::optional<std::string> SkipList::Get(const std::string& key) const {
   return std::nullopt;
 }
 
+InterleavedTask<std::optional<std::string>> SkipList::GetInterleaved(
+    std::string_view key) const {
+  const SkipListNode* x = head_.get();
+  for (int i = current_level_ - 1; i >= 0; --i) {
+    while (const SkipListNode* next = x->forward[i].get()) {
+      // 预取下一个节点后让出，等轮到自己时数据大概率已在缓存中
+      PrefetchForRead(next);
+      co_await std::suspend_always{};
+      // key 的内容（超出 SSO 时）和 forward 数组是节点之外的两块堆内存，
+      // 比较 key 和下一跳都要访问，节点到达后再预取一次并让出
+      PrefetchForRead(next->key.data());
+      PrefetchForRead(next->forward.data());
+      co_await std::suspend_always{};
+      if (next->key >= key) {
+        break;
+      }
+      x = next;
+    }
+  }
+  x = x->forward[0].get();
+  if (x && x->key == key) {
+    co_return x->value;
+  }
+  co_return std::nullopt;
+}
+
+std::vector<std::optional<std::string>> SkipList::MultiGet(
+    std::span<const std::string> keys, size_t group_size) const {
+  return RunInterleaved<std::optional<std::string>>(
+      keys.size(), group_size,
+      [&](size_t i) { return GetInterleaved(keys[i]); });
+}
+
+std::vector<std::optional<std::string>> SkipList::MultiGet(
+    std::span<const std::string> keys, std::span<const size_t> indices,
+    size_t group_size) const {
+  return RunInterleaved<std::optional<std::string>>(
+      indices.size(), group_size,
+      [&](size_t i) { return GetInterleaved(keys[indices[i]]); });
+}
+
 void SkipList::Remove(const std::string& key) {
   // 需要更新的前驱
   std::vector<std::shared_ptr<SkipListNode>> updates(max_level_, nullptr);
-  // std::unique_lock<std::shared_mutex> lock{rw_mutex_};
+  std::unique_lock<std::shared_mutex> lock{rw_mutex_};
   auto x = head_;
   for (int i = current_level_ - 1; i >= 0; --i) {
     while (x->forward[i] && x->forward[i]->key < key) {
@@ -125,6 +197,10 @@ void SkipList::Remove(const std::string& key) {
     updates[i]->forward[i] = x->forward[i];
   }
 
+  if (x->forward[0]) {
+    x->forward[0]->backward = x->backward;
+  }
+
   size_bytes_ -= x->key.size() + x->value.size();
 
   while (current_level_ > 1 && head_->forward[current_level_ - 1] == nullptr) {
@@ -149,18 +225,100 @@ size_t SkipList::size() const {
 }
 
 void SkipList::Clear() {
-  // std::unique_lock<std::shared_mutex> lock{rw_mutex_};
+  std::unique_lock<std::shared_mutex> lock{rw_mutex_};
   head_ = std::make_shared<SkipListNode>("", "", max_level_);
   size_bytes_ = 0;
 }
 
-std::string SkipListIterator::key() const { return current_->key; }
-std::string SkipListIterator::value() const { return current_->value; }
+std::string_view SkipListIterator::key() const { return current_->key; }
+std::string_view SkipListIterator::value() const {
+  return current_->value;
+}
 bool SkipListIterator::valid() const { return !current_->value.empty(); }
 
 SkipListIterator SkipList::begin() const {
-  // return SkipListIterator{head_->forward[0], rw_mutex_};
-  return SkipListIterator(head_->forward[0]);
+  return SkipListIterator(FirstNode());
+}
+
+SkipListIterator SkipList::end() const { return SkipListIterator{}; }
+
+std::shared_ptr<SkipListNode> SkipList::FindLessThan(
+    std::string_view target) const {
+  auto x = head_;
+  for (int i = current_level_ - 1; i >= 0; --i) {
+    while (x->forward[i] && x->forward[i]->key < target) {
+      x = x->forward[i];
+    }
+  }
+  return x;
+}
+
+SkipListIterator SkipList::Seek(const std::string& target) const {
+  return SkipListIterator(SeekNode(target));
+}
+
+SkipListIterator SkipList::SeekForPrev(const std::string& target) const {
+  return SkipListIterator(SeekForPrevNode(target));
 }
 
-SkipListIterator SkipList::end() const { return SkipListIterator{}; }
\ No newline at end of file
+SkipListIterator SkipList::SeekToLast() const {
+  return SkipListIterator(LastNode());
+}
+
+std::shared_ptr<const SkipListNode> SkipList::FirstNode() const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return head_->forward[0];
+}
+
+std::shared_ptr<const SkipListNode> SkipList::SeekNode(
+    std::string_view target) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return FindLessThan(target)->forward[0];
+}
+
+std::shared_ptr<const SkipListNode> SkipList::SeekForPrevNode(
+    std::string_view target) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  auto x = FindLessThan(target);
+  if (x->forward[0] && x->forward[0]->key == target) {
+    return x->forward[0];
+  }
+  if (x == head_) {
+    return nullptr;
+  }
+  return x;
+}
+
+std::shared_ptr<const SkipListNode> SkipList::LastNode() const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  auto x = head_;
+  for (int i = current_level_ - 1; i >= 0; --i) {
+    while (x->forward[i]) {
+      x = x->forward[i];
+    }
+  }
+  if (x == head_) {
+    return nullptr;
+  }
+  return x;
+}
+
+std::shared_ptr<const SkipListNode> SkipList::NextNode(
+    const SkipListNode& node) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  return node.forward[0];
+}
+
+std::shared_ptr<const SkipListNode> SkipList::PrevNode(
+    const SkipListNode& node) const {
+  std::shared_lock<std::shared_mutex> lock{rw_mutex_};
+  if (auto prev = node.backward.lock()) {
+    return prev;
+  }
+  // 第一个节点，或者前一个节点已被替换并释放，重新查找
+  auto x = FindLessThan(node.key);
+  if (x == head_) {
+    return nullptr;
+  }
+  return x;
+}
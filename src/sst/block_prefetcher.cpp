@@ -0,0 +1,53 @@
+#include "sst/block_prefetcher.h"
+
+#include "sst/sst.h"
+
+BlockPrefetcher::BlockPrefetcher(size_t num_threads) : pool_(num_threads) {}
+
+void BlockPrefetcher::Prefetch(const std::shared_ptr<SST>& sst,
+                               size_t block_idx) {
+  const auto& cache = sst->block_cache();
+  // 没有缓存时预读的结果无处存放
+  if (!cache || block_idx >= sst->num_blocks()) {
+    return;
+  }
+  Key key{sst->sst_id(), block_idx};
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (inflight_.contains(key)) {
+    return;
+  }
+  if (cache->Lookup(key.first, key.second)) {
+    return;
+  }
+  auto future = pool_.Submit([this, sst, block_idx, key] {
+    std::shared_ptr<Block> block;
+    try {
+      block = sst->ReadBlock(block_idx);
+    } catch (...) {
+      // 交给 Fetch 重新抛出，预读失败不影响其他任务
+      std::lock_guard<std::mutex> lock(mutex_);
+      inflight_.erase(key);
+      throw;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    inflight_.erase(key);
+    return block;
+  });
+  inflight_.emplace(key, future.share());
+}
+
+std::shared_ptr<Block> BlockPrefetcher::Fetch(const std::shared_ptr<SST>& sst,
+                                              size_t block_idx) {
+  std::shared_future<std::shared_ptr<Block>> pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = inflight_.find({sst->sst_id(), block_idx});
+    if (it != inflight_.end()) {
+      pending = it->second;
+    }
+  }
+  if (pending.valid()) {
+    return pending.get();
+  }
+  return sst->ReadBlock(block_idx);
+}
@@ -0,0 +1,162 @@
+#include "sst/level_iterator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+LevelFileMeta LevelFileMeta::FromSst(const SST& sst) {
+  return LevelFileMeta{sst.sst_id(), std::string(sst.first_key()),
+                       std::string(sst.last_key()), sst.sst_size(),
+                       sst.sst_id(), sst.properties().creation_time};
+}
+
+LevelIterator::LevelIterator(std::vector<LevelFileMeta> files,
+                             SstOpener opener, const ReadOptions& options)
+    : files_(std::move(files)),
+      opener_(std::move(opener)),
+      options_(options),
+      sst_iter_(nullptr, options) {
+  SeekToFirst();
+}
+
+bool LevelIterator::Valid() const { return sst_iter_.Valid(); }
+
+void LevelIterator::SeekToFirst() {
+  if (options_.lower_bound) {
+    Seek(*options_.lower_bound);
+    return;
+  }
+  if (!OpenFile(0)) {
+    return;
+  }
+  sst_iter_.SeekToFirst();
+  SkipEmptyFiles();
+}
+
+void LevelIterator::SeekToLast() {
+  if (options_.upper_bound) {
+    SeekForPrev(*options_.upper_bound);
+    return;
+  }
+  if (!OpenFile(files_.size() - 1)) {
+    return;
+  }
+  sst_iter_.SeekToLast();
+  SkipEmptyFilesBackward();
+}
+
+Status LevelIterator::Seek(std::string_view target) {
+  if (options_.BelowLower(target)) {
+    target = *options_.lower_bound;
+  }
+  // 第一个 last_key >= target 的文件，其中一定有 >= target 的记录
+  auto it = std::lower_bound(
+      files_.begin(), files_.end(), target,
+      [](const LevelFileMeta& f, std::string_view k) { return f.last_key < k; });
+  if (it == files_.end() || options_.BeyondUpper(it->first_key)) {
+    SetEnd();
+    return Status::NotFound();
+  }
+  size_t idx = it - files_.begin();
+  if (idx != file_idx_ || !sst_iter_.Valid()) {
+    OpenFile(idx);
+  }
+  sst_iter_.Seek(target);
+  SkipEmptyFiles();
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+Status LevelIterator::SeekForPrev(std::string_view target) {
+  // 最后一个 first_key <= target 的文件；target 超出上界时改为最后一个
+  // first_key < upper_bound 的文件，避免打开整个在上界之外的文件
+  auto it = options_.BeyondUpper(target)
+                ? std::lower_bound(files_.begin(), files_.end(),
+                                   std::string_view(*options_.upper_bound),
+                                   [](const LevelFileMeta& f,
+                                      std::string_view k) {
+                                     return f.first_key < k;
+                                   })
+                : std::upper_bound(files_.begin(), files_.end(), target,
+                                   [](std::string_view k,
+                                      const LevelFileMeta& f) {
+                                     return k < f.first_key;
+                                   });
+  if (it == files_.begin() || options_.BelowLower((it - 1)->last_key)) {
+    SetEnd();
+    return Status::NotFound();
+  }
+  size_t idx = (it - files_.begin()) - 1;
+  if (idx != file_idx_ || !sst_iter_.Valid()) {
+    OpenFile(idx);
+  }
+  sst_iter_.SeekForPrev(target);
+  SkipEmptyFilesBackward();
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+void LevelIterator::Next() {
+  if (!Valid()) {
+    return;
+  }
+  sst_iter_.Next();
+  SkipEmptyFiles();
+}
+
+void LevelIterator::Prev() {
+  if (!Valid()) {
+    return;
+  }
+  sst_iter_.Prev();
+  SkipEmptyFilesBackward();
+}
+
+std::string_view LevelIterator::key() const {
+  if (!Valid()) {
+    throw std::runtime_error("iterator is invalid");
+  }
+  return sst_iter_.key();
+}
+
+std::string_view LevelIterator::value() const {
+  if (!Valid()) {
+    throw std::runtime_error("iterator is invalid");
+  }
+  return sst_iter_.value();
+}
+
+bool LevelIterator::OpenFile(size_t idx) {
+  if (idx >= files_.size()) {
+    SetEnd();
+    return false;
+  }
+  file_idx_ = idx;
+  sst_iter_.Reset(opener_(files_[idx].sst_id));
+  return true;
+}
+
+void LevelIterator::SkipEmptyFiles() {
+  // 下一个文件整个在上界之外时不再打开
+  while (!sst_iter_.Valid() && file_idx_ + 1 < files_.size() &&
+         !options_.BeyondUpper(files_[file_idx_ + 1].first_key)) {
+    OpenFile(file_idx_ + 1);
+    sst_iter_.SeekToFirst();
+  }
+  if (!sst_iter_.Valid()) {
+    SetEnd();
+  }
+}
+
+void LevelIterator::SkipEmptyFilesBackward() {
+  while (!sst_iter_.Valid() && file_idx_ > 0 && file_idx_ < files_.size() &&
+         !options_.BelowLower(files_[file_idx_ - 1].last_key)) {
+    OpenFile(file_idx_ - 1);
+    sst_iter_.SeekToLast();
+  }
+  if (!sst_iter_.Valid()) {
+    SetEnd();
+  }
+}
+
+void LevelIterator::SetEnd() {
+  file_idx_ = files_.size();
+  sst_iter_.Reset(nullptr);
+}
@@ -1,30 +1,74 @@
 #include "sst/sst.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
 #include "block/block.h"
 #include "block/block_meta.h"
 #include "sst/sst_iterator.h"
+#include "utils/value_encoding.h"
 
-SST SST::Open(size_t sst_id, File file) {
+SST SST::Open(size_t sst_id, File file,
+              std::shared_ptr<BlockCache> block_cache) {
   SST sst;
   sst.sst_id_ = sst_id;
   sst.file_ = std::move(file);
+  sst.block_cache_ = std::move(block_cache);
 
   size_t file_size = sst.file_.size();
   if (file_size < sizeof(uint32_t)) {
     throw std::runtime_error("Invalid SST file: too small");
   }
 
-  auto offset_bytes =
-      sst.file_.ReadToSlice(file_size - sizeof(uint32_t), sizeof(uint32_t));
-  uint32_t meta_offset32 = 0;
-  std::memcpy(&meta_offset32, offset_bytes.data(), sizeof(meta_offset32));
-  sst.meta_block_offset_ = meta_offset32;
+  // 带 magic 的是 v2 及以后的格式，否则是只有 32 位 meta offset 的 v1
+  uint64_t magic = 0;
+  if (file_size >= kSstFooterSizeV2) {
+    auto magic_bytes =
+        sst.file_.ReadToSlice(file_size - sizeof(uint64_t), sizeof(uint64_t));
+    std::memcpy(&magic, magic_bytes.data(), sizeof(magic));
+  }
+
+  size_t footer_size;
+  if (magic == kSstMagic) {
+    auto footer = sst.file_.ReadToSlice(file_size - kSstFooterSizeV2,
+                                        kSstFooterSizeV2);
+    std::memcpy(&sst.meta_block_offset_, footer.data(), sizeof(uint64_t));
+    std::memcpy(&sst.format_version_, footer.data() + sizeof(uint64_t),
+                sizeof(uint32_t));
+    if (sst.format_version_ < kFormatV2 ||
+        sst.format_version_ > kLatestFormatVersion) {
+      throw std::runtime_error("Unsupported SST format version");
+    }
+    footer_size = kSstFooterSizeV2;
+  } else {
+    auto offset_bytes =
+        sst.file_.ReadToSlice(file_size - sizeof(uint32_t), sizeof(uint32_t));
+    uint32_t meta_offset32 = 0;
+    std::memcpy(&meta_offset32, offset_bytes.data(), sizeof(meta_offset32));
+    sst.meta_block_offset_ = meta_offset32;
+    sst.format_version_ = kFormatV1;
+    footer_size = sizeof(uint32_t);
+  }
 
-  size_t meta_section_size =
-      file_size - sizeof(uint32_t) - sst.meta_block_offset_;
+  if (sst.meta_block_offset_ > file_size - footer_size) {
+    throw std::runtime_error("Invalid SST file: bad meta offset");
+  }
+
+  size_t meta_section_size = file_size - footer_size - sst.meta_block_offset_;
   auto meta_section_bytes =
       sst.file_.ReadToSlice(sst.meta_block_offset_, meta_section_size);
-  sst.meta_entries_ = BlockMeta::DecodeMetasFromSlice(meta_section_bytes);
+  sst.meta_entries_ = BlockMeta::DecodeMetasFromSlice(meta_section_bytes,
+                                                      sst.format_version_);
+
+  // Meta Section 之后剩余的字节是 Properties Section（旧文件没有）
+  size_t meta_size =
+      BlockMeta::EncodedSize(sst.meta_entries_, sst.format_version_);
+  if (meta_size < meta_section_bytes.size()) {
+    sst.properties_ = TableProperties::Decode(
+        std::span<const uint8_t>(meta_section_bytes).subspan(meta_size));
+  }
 
   if (!sst.meta_entries_.empty()) {
     sst.first_key_ = sst.meta_entries_.front().first_key_;
@@ -51,48 +95,86 @@ std::shared_ptr<Block> SST::ReadBlock(size_t block_idx) {
   }
 
   const auto& meta = meta_entries_[block_idx];
-  size_t block_size;
-  if (block_idx == meta_entries_.size() - 1) {
-    block_size = meta_block_offset_ - meta.offset_;
-  } else {
-    block_size = meta_entries_[block_idx + 1].offset_ - meta.offset_;
-  }
+  size_t block_size = BlockEnd(block_idx) - meta.offset_;
 
   if (block_size < sizeof(uint32_t)) {
     throw std::runtime_error("Invalid block size in SST");
   }
 
+  if (block_cache_) {
+    if (auto block = block_cache_->Lookup(sst_id_, block_idx)) {
+      return block;
+    }
+  }
+
   size_t encoded_size = block_size - sizeof(uint32_t);
   auto block_data = file_.ReadToSlice(meta.offset_, encoded_size);
-  return Block::Decode(block_data);
+  auto block = Block::Decode(block_data, false, format_version_);
+  if (block_cache_) {
+    block_cache_->Insert(sst_id_, block_idx, block);
+  }
+  return block;
 }
 
-size_t SST::FindBlockIdx(std::string_view key) {
-  if (meta_entries_.empty()) {
-    throw std::runtime_error("No blocks in SST");
+uint64_t SST::BlockEnd(size_t block_idx) const {
+  if (block_idx + 1 == meta_entries_.size()) {
+    return meta_block_offset_;
   }
+  return meta_entries_[block_idx + 1].offset_;
+}
 
-  if (key < meta_entries_.front().first_key_ ||
-      key > meta_entries_.back().last_key_) {
-    throw std::runtime_error("Key out of SST range");
+void SST::PrefetchBlocks(size_t begin, size_t end) {
+  end = std::min(end, meta_entries_.size());
+  if (begin >= end) {
+    return;
   }
+  uint64_t offset = meta_entries_[begin].offset_;
+  file_.Prefetch(offset, BlockEnd(end - 1) - offset);
+}
 
-  int l = 0, r = meta_entries_.size() - 1;
-  while (l <= r) {
-    int mid = l + (r - l) / 2;
-    const auto& meta = meta_entries_[mid];
-    if (key < meta.first_key_) {
-      r = mid - 1;
-    } else if (key > meta.last_key_) {
+size_t SST::FindBlockIdx(std::string_view key) const {
+  size_t l = 0, r = meta_entries_.size();
+  while (l < r) {
+    size_t mid = l + (r - l) / 2;
+    if (meta_entries_[mid].last_key_ < key) {
       l = mid + 1;
     } else {
-      return mid;
+      r = mid;
     }
   }
   return l;
 }
 
-SSTBuilder::SSTBuilder(size_t block_size) : block_(block_size) {}
+size_t SST::FindBlockIdxForPrev(std::string_view key) const {
+  size_t l = 0, r = meta_entries_.size();
+  while (l < r) {
+    size_t mid = l + (r - l) / 2;
+    if (meta_entries_[mid].first_key_ <= key) {
+      l = mid + 1;
+    } else {
+      r = mid;
+    }
+  }
+  return l == 0 ? meta_entries_.size() : l - 1;
+}
+
+Status SST::Get(std::string_view key, std::string* value) {
+  size_t idx = FindBlockIdx(key);
+  // 超出范围或落在 block 之间的空隙中，都不需要读 block
+  if (idx == meta_entries_.size() || key < meta_entries_[idx].first_key_) {
+    return Status::NotFound();
+  }
+  auto status = ReadBlock(idx)->Get(std::string(key), value);
+  if (status.ok() && !values_encoded() && ValueNeedsEscape(*value)) {
+    *value = EncodeValue(*value);
+  }
+  return status;
+}
+
+SSTBuilder::SSTBuilder(size_t block_size, uint32_t format_version)
+    : block_(block_size, format_version),
+      block_size_(block_size),
+      format_version_(format_version) {}
 
 void SSTBuilder::Add(std::string_view key, std::string_view value) {
   if (first_key_.empty()) {
@@ -102,6 +184,13 @@ void SSTBuilder::Add(std::string_view key, std::string_view value) {
   uint32_t hash = static_cast<uint32_t>(std::hash<std::string_view>()(key));
   key_hashes_.push_back(hash);
 
+  properties_.num_entries++;
+  if (value.empty()) {
+    properties_.num_deletions++;
+  }
+  properties_.raw_key_size += key.size();
+  properties_.raw_value_size += value.size();
+
   if (block_.AddEntry(std::string(key), std::string(value))) {
     last_key_ = key;
     return;
@@ -115,9 +204,24 @@ void SSTBuilder::Add(std::string_view key, std::string_view value) {
   last_key_ = key;
 }
 
+void SSTBuilder::Add(std::string_view key, std::string_view value,
+                     uint64_t seq) {
+  AddSeqRange(seq, seq);
+  Add(key, value);
+}
+
+void SSTBuilder::AddSeqRange(uint64_t min_seq, uint64_t max_seq) {
+  if (min_seq > max_seq) {
+    return;
+  }
+  properties_.min_seq = std::min(properties_.min_seq, min_seq);
+  properties_.max_seq = std::max(properties_.max_seq, max_seq);
+}
+
 void SSTBuilder::FinishBlock() {
   auto old_block = std::move(block_);
-  auto encoded_block = old_block.Encode();
+  block_ = Block(block_size_, format_version_);
+  auto encoded_block = old_block.Encode(format_version_);
 
   meta_entries_.emplace_back(data_.size(), first_key_, last_key_);
 
@@ -132,7 +236,8 @@ void SSTBuilder::FinishBlock() {
   data_.insert(data_.end(), hash_bytes, hash_bytes + sizeof(block_hash));
 }
 
-SST SSTBuilder::Build(size_t sst_id, std::string_view path) {
+SST SSTBuilder::Build(size_t sst_id, std::string_view path,
+                      std::shared_ptr<BlockCache> block_cache) {
   if (!block_.IsEmpty()) {
     FinishBlock();
   }
@@ -141,41 +246,67 @@ SST SSTBuilder::Build(size_t sst_id, std::string_view path) {
     throw std::runtime_error("Cannot build empty SST");
   }
 
-  auto meta_block = BlockMeta::EncodeMetasToSlice(meta_entries_);
-  uint32_t meta_offset = data_.size();
+  auto meta_block =
+      BlockMeta::EncodeMetasToSlice(meta_entries_, format_version_);
+  uint64_t meta_offset = data_.size();
+  if (format_version_ == kFormatV1 &&
+      meta_offset > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("SST too large for format version");
+  }
+
+  properties_.data_size = data_.size();
+  properties_.creation_time = std::chrono::duration_cast<std::chrono::seconds>(
+                                  std::chrono::system_clock::now()
+                                      .time_since_epoch())
+                                  .count();
+  auto properties_block = properties_.Encode();
 
   std::vector<uint8_t> file_content = std::move(data_);
 
   file_content.insert(file_content.end(), meta_block.begin(), meta_block.end());
+  file_content.insert(file_content.end(), properties_block.begin(),
+                      properties_block.end());
   size_t old_size = file_content.size();
-  file_content.resize(old_size + sizeof(uint32_t));
-  std::memcpy(file_content.data() + old_size, &meta_offset, sizeof(uint32_t));
+  if (format_version_ == kFormatV1) {
+    uint32_t meta_offset32 = static_cast<uint32_t>(meta_offset);
+    file_content.resize(old_size + sizeof(uint32_t));
+    std::memcpy(file_content.data() + old_size, &meta_offset32,
+                sizeof(uint32_t));
+  } else {
+    file_content.resize(old_size + kSstFooterSizeV2);
+    uint8_t* footer = file_content.data() + old_size;
+    std::memcpy(footer, &meta_offset, sizeof(uint64_t));
+    std::memcpy(footer + sizeof(uint64_t), &format_version_, sizeof(uint32_t));
+    std::memcpy(footer + sizeof(uint64_t) + sizeof(uint32_t), &kSstMagic,
+                sizeof(uint64_t));
+  }
 
-  File f = File::CreateAndWrite(path, file_content);
+  File f = File::CreateAndWrite(path, file_content, rate_limiter_.get(),
+                                io_priority_);
 
   SST sst;
   sst.sst_id_ = sst_id;
   sst.file_ = std::move(f);
   sst.meta_block_offset_ = meta_offset;
+  sst.format_version_ = format_version_;
   sst.meta_entries_ = std::move(meta_entries_);
   sst.first_key_ = sst.meta_entries_.front().first_key_;
   sst.last_key_ = sst.meta_entries_.back().last_key_;
+  sst.properties_ = properties_;
+  sst.block_cache_ = std::move(block_cache);
 
   return sst;
 }
 
-SstIterator SST::Iterator(const std::string& key) {
-  if (key < first_key_ || key > last_key_) {
-    return end();
-  }
+SstIterator SST::Iterator(std::string_view key) {
   return SstIterator(shared_from_this(), key);
 }
 
 SstIterator SST::begin() { return SstIterator(shared_from_this()); }
 
 SstIterator SST::end() {
-  SstIterator it(shared_from_this());
-  it.block_idx_ = meta_entries_.size();
-  it.block_iter_ = nullptr;
+  SstIterator it(nullptr);
+  it.sst_ = shared_from_this();
+  it.SetEnd();
   return it;
 }
\ No newline at end of file
@@ -1,78 +1,262 @@
 #include "sst/sst_iterator.h"
 
+#include <algorithm>
+#include <stdexcept>
+
+#include "sst/block_prefetcher.h"
 #include "sst/sst.h"
+#include "utils/value_encoding.h"
 
 SstIterator::SstIterator(std::shared_ptr<SST> sst)
-    : sst_(sst), block_idx_(0), block_iter_(nullptr) {
+    : sst_(sst), block_idx_(0) {
   if (sst) {
-    SeekFirst();
+    SeekToFirst();
   }
 }
 
-SstIterator::SstIterator(std::shared_ptr<SST> sst, const std::string& key)
-    : sst_(sst), block_idx_(0), block_iter_(nullptr) {
+SstIterator::SstIterator(std::shared_ptr<SST> sst, std::string_view key)
+    : sst_(sst), block_idx_(0) {
   if (sst) {
     Seek(key);
   }
 }
 
-void SstIterator::SeekFirst() {
+SstIterator::SstIterator(std::shared_ptr<SST> sst, const ReadOptions& options)
+    : sst_(sst), block_idx_(0), options_(options) {
+  if (sst) {
+    SeekToFirst();
+  }
+}
+
+void SstIterator::SetEnd() {
+  block_idx_ = sst_ ? sst_->num_blocks() : 0;
+  block_iter_ = BlockIterator();
+}
+
+void SstIterator::Reset(std::shared_ptr<SST> sst) {
+  sst_ = std::move(sst);
+  ResetReadahead();
+  SetEnd();
+}
+
+void SstIterator::ResetReadahead() {
+  sequential_blocks_ = 0;
+  readahead_blocks_ = 0;
+  readahead_limit_ = 0;
+}
+
+void SstIterator::PrefetchAfter(size_t idx) {
+  if (!options_.prefetcher || !Valid()) {
+    return;
+  }
+  size_t begin = std::max(idx + 1, readahead_limit_);
+  size_t end =
+      std::min(idx + 1 + options_.prefetch_blocks, sst_->num_blocks());
+  for (size_t i = begin; i < end; i++) {
+    if (options_.BeyondUpper(sst_->meta_entries_[i].first_key_)) {
+      break;
+    }
+    options_.prefetcher->Prefetch(sst_, i);
+    readahead_limit_ = i + 1;
+  }
+}
+
+void SstIterator::Readahead(size_t idx) {
+  if (options_.prefetcher) {
+    PrefetchAfter(idx);
+    return;
+  }
+  // 连续两次顺序跨越 block 才认为是顺序扫描，短范围查询不会触发预读
+  if (options_.max_readahead_blocks == 0 || ++sequential_blocks_ < 2) {
+    return;
+  }
+  size_t begin = std::max(idx + 1, readahead_limit_);
+  if (begin > idx + 1) {
+    // 下一个 block 已经在预读窗口内
+    return;
+  }
+  readahead_blocks_ = std::min(std::max<size_t>(readahead_blocks_ * 2, 1),
+                               options_.max_readahead_blocks);
+  size_t end = std::min(begin + readahead_blocks_, sst_->num_blocks());
+  // 不预读整个在上界之外的 block
+  while (end > begin &&
+         options_.BeyondUpper(sst_->meta_entries_[end - 1].first_key_)) {
+    end--;
+  }
+  if (end > begin) {
+    sst_->PrefetchBlocks(begin, end);
+    readahead_limit_ = end;
+  }
+}
+
+void SstIterator::LoadBlock(size_t idx) {
+  const auto& meta = sst_->meta_entries_[idx];
+  block_idx_ = idx;
+  block_iter_ = BlockIterator(options_.prefetcher
+                                  ? options_.prefetcher->Fetch(sst_, idx)
+                                  : sst_->ReadBlock(idx));
+  within_upper_ = !options_.BeyondUpper(meta.last_key_);
+  within_lower_ = !options_.BelowLower(meta.first_key_);
+}
+
+void SstIterator::CheckBounds() {
+  if (!Valid()) {
+    return;
+  }
+  if ((!within_upper_ && options_.BeyondUpper(block_iter_.key())) ||
+      (!within_lower_ && options_.BelowLower(block_iter_.key()))) {
+    SetEnd();
+  }
+}
+
+bool SstIterator::Valid() const { return block_iter_.Valid(); }
+
+void SstIterator::SeekToFirst() {
+  if (options_.lower_bound) {
+    Seek(*options_.lower_bound);
+    return;
+  }
+  if (!sst_ || sst_->num_blocks() == 0) {
+    SetEnd();
+    return;
+  }
+  ResetReadahead();
+  LoadBlock(0);
+  CheckBounds();
+  PrefetchAfter(0);
+}
+
+void SstIterator::SeekToLast() {
+  if (options_.upper_bound) {
+    SeekForPrev(*options_.upper_bound);
+    return;
+  }
   if (!sst_ || sst_->num_blocks() == 0) {
-    block_iter_ = nullptr;
+    SetEnd();
+    return;
+  }
+  ResetReadahead();
+  LoadBlock(sst_->num_blocks() - 1);
+  block_iter_.SeekToLast();
+  CheckBounds();
+}
+
+void SstIterator::SeekRaw(std::string_view key) {
+  ResetReadahead();
+  // 目标 block 的 last_key >= key，因此块内一定能找到 >= key 的记录
+  size_t idx = sst_->FindBlockIdx(key);
+  if (idx == sst_->num_blocks() ||
+      options_.BeyondUpper(sst_->meta_entries_[idx].first_key_)) {
+    SetEnd();
     return;
   }
-  block_idx_ = 0;
-  auto block = sst_->ReadBlock(block_idx_);
-  block_iter_ = std::make_shared<BlockIterator>(block);
+  LoadBlock(idx);
+  block_iter_.Seek(key);
+  PrefetchAfter(idx);
+}
+
+void SstIterator::SeekForPrevRaw(std::string_view key) {
+  ResetReadahead();
+  // 目标 block 的 first_key <= key，因此块内一定能找到 <= key 的记录
+  size_t idx = sst_->FindBlockIdxForPrev(key);
+  if (idx == sst_->num_blocks() ||
+      options_.BelowLower(sst_->meta_entries_[idx].last_key_)) {
+    SetEnd();
+    return;
+  }
+  LoadBlock(idx);
+  block_iter_.SeekForPrev(key);
+}
+
+Status SstIterator::Seek(std::string_view key) {
+  if (!sst_) {
+    SetEnd();
+    return Status::InvalidArgument("iterator has no sst");
+  }
+  if (options_.BelowLower(key)) {
+    key = *options_.lower_bound;
+  }
+  SeekRaw(key);
+  CheckBounds();
+  return Valid() ? Status::OK() : Status::NotFound();
 }
 
-void SstIterator::Seek(const std::string& key) {
+Status SstIterator::SeekForPrev(std::string_view key) {
   if (!sst_) {
-    block_iter_ = nullptr;
+    SetEnd();
+    return Status::InvalidArgument("iterator has no sst");
   }
-  try {
-    block_idx_ = sst_->FindBlockIdx(key);
-    if (auto block = sst_->ReadBlock(block_idx_); block) {
-      block_iter_ = std::make_shared<BlockIterator>(block, key);
+  if (options_.BeyondUpper(key)) {
+    // 上界不包含在范围内，定位到上界之前的最后一条
+    SeekForPrevRaw(*options_.upper_bound);
+    if (Valid() && block_iter_.key() == *options_.upper_bound) {
+      Prev();
+    }
+  } else {
+    SeekForPrevRaw(key);
+  }
+  CheckBounds();
+  return Valid() ? Status::OK() : Status::NotFound();
+}
+
+void SstIterator::Next() {
+  if (!Valid()) {
+    return;
+  }
+  block_iter_.Next();
+  if (!block_iter_.Valid()) {
+    // 下一个 block 整个在上界之外时不再读取
+    size_t next = block_idx_ + 1;
+    if (next >= sst_->num_blocks() ||
+        options_.BeyondUpper(sst_->meta_entries_[next].first_key_)) {
+      SetEnd();
       return;
     }
-    block_iter_ = nullptr;
-  } catch (const std::exception& e) {
-    block_iter_ = nullptr;
-    throw std::runtime_error("could not read a block from sst_");
+    LoadBlock(next);
+    Readahead(next);
   }
+  CheckBounds();
 }
 
-bool SstIterator::IsEnd() const { return !block_iter_; }
+void SstIterator::Prev() {
+  if (!Valid()) {
+    return;
+  }
+  block_iter_.Prev();
+  if (!block_iter_.Valid()) {
+    // 上一个 block 整个在下界之外时不再读取
+    if (block_idx_ == 0 ||
+        options_.BelowLower(sst_->meta_entries_[block_idx_ - 1].last_key_)) {
+      SetEnd();
+      return;
+    }
+    LoadBlock(block_idx_ - 1);
+    block_iter_.SeekToLast();
+  }
+  CheckBounds();
+}
 
-std::string SstIterator::key() {
-  if (!block_iter_) {
+std::string_view SstIterator::key() const {
+  if (!Valid()) {
     throw std::runtime_error("iterator is invalid");
   }
-  return (**block_iter_).first;
+  return block_iter_.key();
 }
 
-std::string SstIterator::value() {
-  if (!block_iter_) {
+std::string_view SstIterator::value() const {
+  if (!Valid()) {
     throw std::runtime_error("iterator is invalid");
   }
-  return (**block_iter_).second;
+  std::string_view value = block_iter_.value();
+  if (!sst_->values_encoded() && ValueNeedsEscape(value)) {
+    escaped_value_ = EncodeValue(value);
+    return escaped_value_;
+  }
+  return value;
 }
 
 SstIterator& SstIterator::operator++() {
-  if (!block_iter_) {
-    return *this;
-  }
-  (*block_iter_)++;
-  if (block_iter_->IsEnd()) {
-    block_idx_++;
-    if (block_idx_ < sst_->num_blocks()) {
-      auto next_block = sst_->ReadBlock(block_idx_);
-      block_iter_ = std::make_shared<BlockIterator>(next_block, 0);
-    } else {
-      block_iter_ = nullptr;
-    }
-  }
+  Next();
   return *this;
 }
 
@@ -83,17 +267,12 @@ SstIterator SstIterator::operator++(int) {
 }
 
 bool SstIterator::operator==(const SstIterator& other) const {
-  return sst_ == other.sst_ && block_idx_ == other.block_idx_ &&
-         *block_iter_ == *other.block_iter_;
+  if (sst_ != other.sst_ || block_idx_ != other.block_idx_) {
+    return false;
+  }
+  return block_iter_ == other.block_iter_;
 }
 
 bool SstIterator::operator!=(const SstIterator& other) const {
   return !(*this == other);
 }
-
-SstIterator::value_type SstIterator::operator*() const {
-  if (!block_iter_) {
-    throw std::runtime_error("iterator is invalid");
-  }
-  return **block_iter_;
-}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "sst/table_cache.h"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <format>
+#include <future>
+
+#include "utils/file.h"
+#include "utils/thread_pool.h"
+
+TableCache::TableCache(std::filesystem::path dir,
+                       std::shared_ptr<BlockCache> block_cache)
+    : dir_(std::move(dir)), block_cache_(std::move(block_cache)) {}
+
+std::filesystem::path TableCache::SstPath(size_t sst_id) const {
+  return dir_ / std::format("sst_{}", sst_id);
+}
+
+bool TableCache::ParseSstFileName(const std::filesystem::path& path,
+                                  size_t* sst_id) {
+  constexpr std::string_view kPrefix = "sst_";
+  auto name = path.filename().string();
+  std::string_view view(name);
+  if (!view.starts_with(kPrefix)) {
+    return false;
+  }
+  view.remove_prefix(kPrefix.size());
+  auto [ptr, ec] =
+      std::from_chars(view.data(), view.data() + view.size(), *sst_id);
+  return ec == std::errc() && ptr == view.data() + view.size();
+}
+
+std::shared_ptr<SST> TableCache::Get(size_t sst_id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tables_.find(sst_id);
+    if (it != tables_.end()) {
+      return it->second;
+    }
+  }
+
+  // 在锁外打开文件，不同文件可以并行打开；同一个文件被并发打开时保留先放入的
+  auto sst = std::make_shared<SST>(
+      SST::Open(sst_id, File::Open(SstPath(sst_id).string()), block_cache_));
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tables_.try_emplace(sst_id, std::move(sst)).first->second;
+}
+
+void TableCache::Insert(std::shared_ptr<SST> sst) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tables_[sst->sst_id()] = std::move(sst);
+}
+
+void TableCache::Evict(size_t sst_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  tables_.erase(sst_id);
+  if (block_cache_) {
+    block_cache_->EraseSst(sst_id);
+  }
+}
+
+Status TableCache::OpenAll(const std::vector<size_t>& ids,
+                           size_t num_threads) {
+  if (ids.empty()) {
+    return Status::OK();
+  }
+  num_threads = std::clamp<size_t>(num_threads, 1, ids.size());
+  ThreadPool pool(num_threads);
+  std::vector<std::future<Status>> futures;
+  futures.reserve(num_threads);
+  // 每个线程负责一段连续的 id，避免每个文件一个任务的调度开销
+  for (size_t t = 0; t < num_threads; t++) {
+    size_t begin = ids.size() * t / num_threads;
+    size_t end = ids.size() * (t + 1) / num_threads;
+    futures.push_back(pool.Submit([this, &ids, begin, end] {
+      for (size_t i = begin; i < end; i++) {
+        try {
+          Get(ids[i]);
+        } catch (const std::exception& e) {
+          return Status::Corruption(e.what());
+        }
+      }
+      return Status::OK();
+    }));
+  }
+  Status result;
+  for (auto& future : futures) {
+    auto status = future.get();
+    if (result.ok() && !status.ok()) {
+      result = status;
+    }
+  }
+  return result;
+}
+
+SstOpener TableCache::opener() {
+  return [this](size_t sst_id) { return Get(sst_id); };
+}
+
+size_t TableCache::num_open() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tables_.size();
+}
@@ -0,0 +1,85 @@
+#include "sst/table_properties.h"
+
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// 与 TableProperties 的声明顺序保持一致, 只能在末尾追加
+constexpr uint64_t TableProperties::*kFields[] = {
+    &TableProperties::num_entries,    &TableProperties::num_deletions,
+    &TableProperties::raw_key_size,   &TableProperties::raw_value_size,
+    &TableProperties::data_size,      &TableProperties::filter_size,
+    &TableProperties::min_seq,        &TableProperties::max_seq,
+    &TableProperties::creation_time,
+};
+
+constexpr uint32_t kNumFields = std::size(kFields);
+
+uint32_t HashFields(const uint8_t* data, size_t len) {
+  return std::hash<std::string_view>()(
+      std::string_view(reinterpret_cast<const char*>(data), len));
+}
+
+}  // namespace
+
+double TableProperties::compression_ratio() const {
+  if (data_size == 0) {
+    return 1.0;
+  }
+  return static_cast<double>(raw_key_size + raw_value_size) / data_size;
+}
+
+std::vector<uint8_t> TableProperties::Encode() const {
+  std::vector<uint8_t> encoded(sizeof(uint32_t) +
+                               kNumFields * sizeof(uint64_t) +
+                               sizeof(uint32_t));
+  uint8_t* ptr = encoded.data();
+
+  std::memcpy(ptr, &kNumFields, sizeof(kNumFields));
+  ptr += sizeof(kNumFields);
+
+  const uint8_t* fields_start = ptr;
+  for (auto field : kFields) {
+    uint64_t value = this->*field;
+    std::memcpy(ptr, &value, sizeof(value));
+    ptr += sizeof(value);
+  }
+
+  uint32_t hash = HashFields(fields_start, ptr - fields_start);
+  std::memcpy(ptr, &hash, sizeof(hash));
+  return encoded;
+}
+
+TableProperties TableProperties::Decode(std::span<const uint8_t> encoded) {
+  if (encoded.size() < sizeof(uint32_t) * 2) {
+    throw std::runtime_error("Invalid table properties size");
+  }
+
+  uint32_t num_fields;
+  std::memcpy(&num_fields, encoded.data(), sizeof(num_fields));
+  size_t fields_len = static_cast<size_t>(num_fields) * sizeof(uint64_t);
+  if (encoded.size() < sizeof(uint32_t) + fields_len + sizeof(uint32_t)) {
+    throw std::runtime_error("Invalid table properties size");
+  }
+
+  const uint8_t* fields_start = encoded.data() + sizeof(uint32_t);
+  uint32_t stored_hash;
+  std::memcpy(&stored_hash, fields_start + fields_len, sizeof(stored_hash));
+  if (stored_hash != HashFields(fields_start, fields_len)) {
+    throw std::runtime_error("Table properties hash mismatch");
+  }
+
+  TableProperties props;
+  const uint8_t* ptr = fields_start;
+  for (uint32_t i = 0; i < num_fields && i < kNumFields; i++) {
+    uint64_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    ptr += sizeof(value);
+    props.*kFields[i] = value;
+  }
+  return props;
+}
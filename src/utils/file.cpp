@@ -1,5 +1,6 @@
 #include "utils/file.h"
 
+#include <algorithm>
 #include <cstring>
 #include <format>
 
@@ -25,20 +26,32 @@ size_t File::size() const { return file_->size(); }
 
 void File::set_size(size_t size) { size_ = size; }
 
-File File::CreateAndWrite(std::string_view path, std::span<const uint8_t> buf) {
+File File::CreateAndWrite(std::string_view path, std::span<const uint8_t> buf,
+                          RateLimiter* rate_limiter, IOPriority priority) {
   File f;
   if (!f.file_->CreateAndMap(path, buf.size())) {
     throw std::runtime_error(
         std::format("Failed to create and map file: {}", path));
   }
-  std::memcpy(f.file_->data(), buf.data(), buf.size());
+  auto dst = static_cast<uint8_t*>(f.file_->data());
+  if (rate_limiter) {
+    size_t chunk = std::max<size_t>(rate_limiter->single_burst_bytes(), 1);
+    for (size_t offset = 0; offset < buf.size(); offset += chunk) {
+      size_t length = std::min(chunk, buf.size() - offset);
+      rate_limiter->Request(length, priority);
+      std::memcpy(dst + offset, buf.data() + offset, length);
+      f.file_->SyncRange(offset, length);
+    }
+  } else {
+    std::memcpy(dst, buf.data(), buf.size());
+  }
   f.file_->Sync();
   return f;
 }
 
 File File::Open(std::string_view path) {
   File f;
-  if (!f.file_->Open(path, false)) {
+  if (!f.file_->Open(path, false, true)) {
     throw std::runtime_error(std::format("Failed to open file {}", path));
   }
   return f;
@@ -52,4 +65,10 @@ std::vector<uint8_t> File::ReadToSlice(size_t offset, size_t length) {
   auto ptr = reinterpret_cast<const uint8_t*>(file_->data());
   std::memcpy(result.data(), ptr + offset, length);
   return result;
-}
\ No newline at end of file
+}
+
+void File::Advise(AccessHint hint) { file_->Advise(hint); }
+
+void File::Prefetch(size_t offset, size_t length) {
+  file_->WillNeed(offset, length);
+}
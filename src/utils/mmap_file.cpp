@@ -4,12 +4,13 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cstring>
 
-bool MMapFile::Open(std::string_view path, bool create) {
+bool MMapFile::Open(std::string_view path, bool create, bool read_only) {
   filename_ = std::string(path);
 
-  int flags = O_RDWR;
+  int flags = read_only ? O_RDONLY : O_RDWR;
   if (create) {
     flags |= O_CREAT;
   }
@@ -26,8 +27,8 @@ bool MMapFile::Open(std::string_view path, bool create) {
   file_size_ = st.st_size;
 
   if (file_size_ > 0) {
-    data_ =
-        ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    int prot = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    data_ = ::mmap(nullptr, file_size_, prot, MAP_SHARED, fd_, 0);
     if (data_ == MAP_FAILED) {
       Close();
       return false;
@@ -76,6 +77,18 @@ bool MMapFile::Sync() {
   return true;
 }
 
+bool MMapFile::SyncRange(size_t offset, size_t length) {
+  if (!data_ || data_ == MAP_FAILED || offset >= file_size_) {
+    return true;
+  }
+  length = std::min(length, file_size_ - offset);
+  // msync 要求起始地址按页对齐
+  static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+  size_t aligned = offset / page_size * page_size;
+  auto addr = static_cast<char*>(data_) + aligned;
+  return ::msync(addr, length + (offset - aligned), MS_SYNC) == 0;
+}
+
 bool MMapFile::CreateAndMap(std::string_view path, size_t size) {
   if (fd_ = ::open(path.data(), O_RDWR | O_CREAT | O_TRUNC, 0644); fd_ == -1) {
     return false;
@@ -94,4 +107,35 @@ bool MMapFile::CreateAndMap(std::string_view path, size_t size) {
 
   file_size_ = size;
   return true;
-}
\ No newline at end of file
+}
+
+bool MMapFile::Advise(AccessHint hint) {
+  if (!data_ || data_ == MAP_FAILED) {
+    return true;
+  }
+  int advice = MADV_NORMAL;
+  switch (hint) {
+    case AccessHint::kNormal:
+      advice = MADV_NORMAL;
+      break;
+    case AccessHint::kSequential:
+      advice = MADV_SEQUENTIAL;
+      break;
+    case AccessHint::kRandom:
+      advice = MADV_RANDOM;
+      break;
+  }
+  return ::madvise(data_, file_size_, advice) == 0;
+}
+
+bool MMapFile::WillNeed(size_t offset, size_t length) {
+  if (!data_ || data_ == MAP_FAILED || offset >= file_size_) {
+    return true;
+  }
+  length = std::min(length, file_size_ - offset);
+  // madvise 要求起始地址按页对齐
+  static const size_t page_size = ::sysconf(_SC_PAGESIZE);
+  size_t aligned = offset / page_size * page_size;
+  auto addr = static_cast<char*>(data_) + aligned;
+  return ::madvise(addr, length + (offset - aligned), MADV_WILLNEED) == 0;
+}
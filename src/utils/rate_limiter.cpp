@@ -0,0 +1,125 @@
+#include "utils/rate_limiter.h"
+
+#include <algorithm>
+
+namespace {
+
+// 自动调整时限速的下限是上限的 1 / kAutoTuneRange
+constexpr int64_t kAutoTuneRange = 20;
+
+}  // namespace
+
+RateLimiter::RateLimiter(const RateLimiterOptions& options)
+    : options_(options),
+      max_bytes_per_second_(std::max<int64_t>(options.bytes_per_second, 1)),
+      bytes_per_second_(max_bytes_per_second_),
+      next_refill_(Clock::now()),
+      next_tune_(next_refill_ +
+                 std::chrono::microseconds(options.tune_period_us)) {}
+
+void RateLimiter::Request(size_t bytes, IOPriority priority) {
+  auto pri = static_cast<size_t>(priority);
+  std::unique_lock<std::mutex> lock(mutex_);
+  total_bytes_[pri] += bytes;
+  auto remaining = static_cast<int64_t>(bytes);
+  while (remaining > 0) {
+    int64_t chunk = std::min(remaining, RefillBytesLocked());
+    remaining -= chunk;
+    // 没有排队的请求且令牌足够时直接通过
+    if (queues_[0].empty() && queues_[1].empty() && available_ >= chunk) {
+      available_ -= chunk;
+      continue;
+    }
+    Waiter waiter{chunk};
+    queues_[pri].push_back(&waiter);
+    while (!waiter.granted) {
+      if (has_leader_) {
+        cv_.wait(lock);
+        continue;
+      }
+      // 由一个等待者在补充时刻醒来补充令牌，其余的等它分配
+      has_leader_ = true;
+      cv_.wait_until(lock, next_refill_);
+      auto now = Clock::now();
+      if (now >= next_refill_) {
+        RefillLocked(now);
+      }
+      has_leader_ = false;
+      cv_.notify_all();
+    }
+  }
+}
+
+int64_t RateLimiter::RefillBytesLocked() const {
+  return std::max<int64_t>(
+      bytes_per_second_ * options_.refill_period_us / 1000000, 1);
+}
+
+void RateLimiter::RefillLocked(Clock::time_point now) {
+  if (options_.auto_tuned && now >= next_tune_) {
+    TuneLocked(now);
+  }
+  next_refill_ = now + std::chrono::microseconds(options_.refill_period_us);
+  available_ += RefillBytesLocked();
+
+  for (size_t pri = queues_.size(); pri-- > 0;) {
+    auto& queue = queues_[pri];
+    while (!queue.empty() && available_ >= queue.front()->bytes) {
+      available_ -= queue.front()->bytes;
+      queue.front()->granted = true;
+      queue.pop_front();
+    }
+    if (!queue.empty()) {
+      return;
+    }
+  }
+  // 空闲期间不积攒令牌，避免之后出现超过一个周期的突发
+  available_ = std::min(available_, RefillBytesLocked());
+}
+
+void RateLimiter::TuneLocked(Clock::time_point now) {
+  next_tune_ = now + std::chrono::microseconds(options_.tune_period_us);
+  uint64_t count = latency_count_.exchange(0, std::memory_order_relaxed);
+  uint64_t sum = latency_sum_us_.exchange(0, std::memory_order_relaxed);
+  int64_t min_rate = std::max<int64_t>(max_bytes_per_second_ / kAutoTuneRange, 1);
+  if (count > 0 && sum / count > options_.target_latency_us) {
+    bytes_per_second_ = std::max(bytes_per_second_ * 2 / 3, min_rate);
+  } else if (count == 0 || sum / count * 2 < options_.target_latency_us) {
+    bytes_per_second_ =
+        std::min(bytes_per_second_ + bytes_per_second_ / 4 + 1,
+                 max_bytes_per_second_);
+  }
+}
+
+void RateLimiter::SetBytesPerSecond(int64_t bytes_per_second) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_bytes_per_second_ = std::max<int64_t>(bytes_per_second, 1);
+  bytes_per_second_ = options_.auto_tuned
+                          ? std::min(bytes_per_second_, max_bytes_per_second_)
+                          : max_bytes_per_second_;
+}
+
+int64_t RateLimiter::bytes_per_second() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_per_second_;
+}
+
+int64_t RateLimiter::max_bytes_per_second() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_bytes_per_second_;
+}
+
+size_t RateLimiter::single_burst_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<size_t>(RefillBytesLocked());
+}
+
+void RateLimiter::RecordForegroundLatency(uint64_t micros) {
+  latency_sum_us_.fetch_add(micros, std::memory_order_relaxed);
+  latency_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t RateLimiter::total_bytes_through(IOPriority priority) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_bytes_[static_cast<size_t>(priority)];
+}
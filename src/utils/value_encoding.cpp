@@ -0,0 +1,37 @@
+#include "utils/value_encoding.h"
+
+namespace {
+
+constexpr char kEscape = '\0';
+constexpr char kEscapedValue = '\x01';
+constexpr char kMergeOperand = '\x02';
+
+}  // namespace
+
+std::string EncodeValue(std::string_view value) {
+  if (!ValueNeedsEscape(value)) {
+    return std::string(value);
+  }
+  std::string stored{kEscape, kEscapedValue};
+  stored.append(value);
+  return stored;
+}
+
+std::string EncodeMergeOperand(std::string_view operand) {
+  std::string stored{kEscape, kMergeOperand};
+  stored.append(operand);
+  return stored;
+}
+
+ValueType DecodeValue(std::string_view stored, std::string_view* payload) {
+  if (stored.empty()) {
+    *payload = stored;
+    return ValueType::kDeletion;
+  }
+  if (stored.size() >= 2 && stored[0] == kEscape) {
+    *payload = stored.substr(2);
+    return stored[1] == kMergeOperand ? ValueType::kMerge : ValueType::kValue;
+  }
+  *payload = stored;
+  return ValueType::kValue;
+}
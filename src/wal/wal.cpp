@@ -0,0 +1,573 @@
+#include "wal/wal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <map>
+#include <system_error>
+
+namespace {
+
+constexpr size_t kHeaderSize =
+    sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+// 一次 group commit 合并的最大字节数，超过后剩余的写入者留给下一批
+constexpr size_t kMaxBatchBytes = 1 << 20;
+
+constexpr std::string_view kSegmentPrefix = "wal_";
+constexpr std::string_view kRecyclePrefix = "recycle_";
+constexpr std::string_view kLogSuffix = ".log";
+
+uint32_t HashRecord(const char* data, size_t len) {
+  return std::hash<std::string_view>()(std::string_view(data, len));
+}
+
+template <typename T>
+void PutFixed(std::string* dst, T value) {
+  dst->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool GetFixed(std::string_view* src, T* value) {
+  if (src->size() < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(value, src->data(), sizeof(T));
+  src->remove_prefix(sizeof(T));
+  return true;
+}
+
+// 从 data 开头解析一条属于 log_number 的记录头，返回记录是否完整且校验通过
+bool IsValidRecord(std::string_view data, uint64_t log_number) {
+  std::string_view header = data;
+  uint32_t hash = 0;
+  uint32_t length = 0;
+  uint64_t number = 0;
+  if (!GetFixed(&header, &hash) || !GetFixed(&header, &length) ||
+      !GetFixed(&header, &number) || length == 0 || number != log_number ||
+      header.size() < length) {
+    return false;
+  }
+  return hash == HashRecord(data.data() + sizeof(hash) + sizeof(length),
+                            sizeof(number) + length);
+}
+
+bool GetLengthPrefixed(std::string_view* src, std::string* value) {
+  uint32_t len;
+  if (!GetFixed(src, &len) || src->size() < len) {
+    return false;
+  }
+  value->assign(src->data(), len);
+  src->remove_prefix(len);
+  return true;
+}
+
+std::string EncodePayload(WalRecordType type, uint64_t seq,
+                          std::string_view key, std::string_view value) {
+  std::string payload;
+  payload.reserve(sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t) * 2 +
+                  key.size() + value.size());
+  PutFixed(&payload, static_cast<uint8_t>(type));
+  PutFixed(&payload, seq);
+  PutFixed(&payload, static_cast<uint32_t>(key.size()));
+  payload.append(key);
+  PutFixed(&payload, static_cast<uint32_t>(value.size()));
+  payload.append(value);
+  return payload;
+}
+
+bool DecodePayload(std::string_view payload, WalRecord* record) {
+  uint8_t type;
+  if (!GetFixed(&payload, &type) || !GetFixed(&payload, &record->seq) ||
+      !GetLengthPrefixed(&payload, &record->key) ||
+      !GetLengthPrefixed(&payload, &record->value) || !payload.empty()) {
+    return false;
+  }
+  if (type != static_cast<uint8_t>(WalRecordType::kPut) &&
+      type != static_cast<uint8_t>(WalRecordType::kDelete) &&
+      type != static_cast<uint8_t>(WalRecordType::kMerge)) {
+    return false;
+  }
+  record->type = static_cast<WalRecordType>(type);
+  return true;
+}
+
+// 解析 <prefix><number>.log 形式的文件名
+bool ParseFileName(const std::filesystem::path& path, std::string_view prefix,
+                   uint64_t* number) {
+  auto name = path.filename().string();
+  std::string_view view(name);
+  if (!view.starts_with(prefix) || !view.ends_with(kLogSuffix)) {
+    return false;
+  }
+  view.remove_prefix(prefix.size());
+  view.remove_suffix(kLogSuffix.size());
+  auto [ptr, ec] = std::from_chars(view.data(), view.data() + view.size(),
+                                   *number);
+  return ec == std::errc() && ptr == view.data() + view.size();
+}
+
+Status IOErrorFromErrno(std::string_view context) {
+  return Status::IOError(std::format("{}: {}", context, std::strerror(errno)));
+}
+
+// 新建或改名文件后同步目录，保证文件名本身持久化
+void SyncDir(const std::filesystem::path& dir) {
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+}  // namespace
+
+struct Wal::Writer {
+  std::string payload;
+  uint64_t seq = 0;
+  const std::function<void(uint64_t)>* apply = nullptr;
+  bool done = false;
+  Status status;
+  std::exception_ptr error;
+  std::condition_variable cv;
+};
+
+Wal::Wal(std::filesystem::path dir, const WalOptions& options)
+    : dir_(std::move(dir)), options_(options) {}
+
+Wal::~Wal() {
+  if (sync_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(io_mutex_);
+      stop_ = true;
+    }
+    sync_cv_.notify_one();
+    sync_thread_.join();
+  }
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  if (fd_ >= 0) {
+    if (options_.sync_mode != WalSyncMode::kNone) {
+      SyncLocked();
+    }
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+Status Wal::Open(const std::filesystem::path& dir, const WalOptions& options,
+                 std::unique_ptr<Wal>* wal, uint64_t min_log_number) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    return Status::IOError(ec.message());
+  }
+
+  std::unique_ptr<Wal> result(new Wal(dir, options));
+  uint64_t max_log_number = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    uint64_t number;
+    if (ParseFileName(entry.path(), kSegmentPrefix, &number)) {
+      result->live_segments_.push_back(number);
+      max_log_number = std::max(max_log_number, number);
+    } else if (ParseFileName(entry.path(), kRecyclePrefix, &number)) {
+      result->recycled_.push_back(entry.path());
+      result->next_recycle_id_ =
+          std::max(result->next_recycle_id_, number + 1);
+    }
+  }
+  if (ec) {
+    return Status::IOError(ec.message());
+  }
+  std::sort(result->live_segments_.begin(), result->live_segments_.end());
+
+  {
+    std::lock_guard<std::mutex> lock(result->io_mutex_);
+    result->log_number_ = std::max(max_log_number + 1, min_log_number);
+    auto status = result->NewSegment();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  auto status = result->ReleaseSegmentsBefore(min_log_number);
+  if (!status.ok()) {
+    return status;
+  }
+  if (options.sync_mode == WalSyncMode::kInterval) {
+    result->sync_thread_ = std::thread([w = result.get()] { w->SyncLoop(); });
+  }
+  *wal = std::move(result);
+  return Status::OK();
+}
+
+Status Wal::Replay(const std::filesystem::path& dir,
+                   const std::function<void(const WalRecord&)>& callback,
+                   uint64_t min_log_number) {
+  std::error_code ec;
+  if (!std::filesystem::exists(dir, ec)) {
+    return Status::OK();
+  }
+  std::map<uint64_t, std::filesystem::path> segments;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    uint64_t number;
+    if (ParseFileName(entry.path(), kSegmentPrefix, &number) &&
+        number >= min_log_number) {
+      segments.emplace(number, entry.path());
+    }
+  }
+  if (ec) {
+    return Status::IOError(ec.message());
+  }
+
+  WalRecord record;
+  for (auto segment = segments.begin(); segment != segments.end(); ++segment) {
+    const auto& [log_number, path] = *segment;
+    bool last = std::next(segment) == segments.end();
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return Status::IOError(std::format("open {}", path.string()));
+    }
+    std::string data(std::filesystem::file_size(path), '\0');
+    in.read(data.data(), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<size_t>(in.gcount()));
+
+    std::string_view rest(data);
+    while (rest.size() >= kHeaderSize) {
+      std::string_view header = rest;
+      uint32_t hash = 0;
+      uint32_t length = 0;
+      uint64_t number = 0;
+      // 预分配的空白区域和回收文件中的旧记录表示 segment 结束
+      if (!GetFixed(&header, &hash) || !GetFixed(&header, &length) ||
+          !GetFixed(&header, &number) || length == 0 ||
+          number != log_number) {
+        break;
+      }
+      if (!IsValidRecord(rest, log_number)) {
+        // 写了一半的记录只可能出现在崩溃时的最后一个 segment 末尾。其余
+        // 位置的坏记录如果跳过，之后的写入会在丢掉更早的写入后被回放
+        bool tail = last;
+        for (size_t pos = 1; tail && pos < rest.size(); pos++) {
+          tail = !IsValidRecord(rest.substr(pos), log_number);
+        }
+        if (!tail) {
+          return Status::Corruption(
+              std::format("bad wal record in {}", path.string()));
+        }
+        // 截掉不完整的记录，重启后新的 segment 接在它之后，它不再是最后
+        // 一个 segment
+        std::filesystem::resize_file(path, data.size() - rest.size(), ec);
+        if (ec) {
+          return Status::IOError(ec.message());
+        }
+        break;
+      }
+      if (!DecodePayload(header.substr(0, length), &record)) {
+        return Status::Corruption(
+            std::format("bad wal record in {}", path.string()));
+      }
+      callback(record);
+      rest.remove_prefix(kHeaderSize + length);
+    }
+  }
+  return Status::OK();
+}
+
+Status Wal::AddPut(uint64_t seq, std::string_view key,
+                   std::string_view value) {
+  return AddRecord(EncodePayload(WalRecordType::kPut, seq, key, value));
+}
+
+Status Wal::AddDelete(uint64_t seq, std::string_view key) {
+  return AddRecord(EncodePayload(WalRecordType::kDelete, seq, key, {}));
+}
+
+Status Wal::AddMerge(uint64_t seq, std::string_view key,
+                     std::string_view operand) {
+  return AddRecord(EncodePayload(WalRecordType::kMerge, seq, key, operand));
+}
+
+Status Wal::AddOrdered(WalRecordType type, std::string_view key,
+                       std::string_view value,
+                       const std::function<uint64_t()>& next_seq,
+                       const std::function<void(uint64_t seq)>& apply) {
+  return AddRecord(EncodePayload(type, 0, key, value), &next_seq, &apply);
+}
+
+Status Wal::AddRecord(std::string payload,
+                      const std::function<uint64_t()>* next_seq,
+                      const std::function<void(uint64_t)>* apply) {
+  Writer writer;
+  writer.payload = std::move(payload);
+  writer.apply = apply;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (next_seq) {
+    // seq 紧跟在 payload 开头的 type 之后
+    writer.seq = (*next_seq)();
+    std::memcpy(writer.payload.data() + sizeof(uint8_t), &writer.seq,
+                sizeof(writer.seq));
+  }
+  writers_.push_back(&writer);
+  writer.cv.wait(lock,
+                 [&] { return writer.done || writers_.front() == &writer; });
+  if (writer.done) {
+    if (writer.error) {
+      std::rethrow_exception(writer.error);
+    }
+    return writer.status;
+  }
+
+  // 成为 leader：带上当前排队的写入者一起提交
+  std::vector<Writer*> group;
+  size_t bytes = 0;
+  for (auto* w : writers_) {
+    if (!group.empty() && bytes + w->payload.size() > kMaxBatchBytes) {
+      break;
+    }
+    group.push_back(w);
+    bytes += kHeaderSize + w->payload.size();
+  }
+  lock.unlock();
+
+  Status status;
+  {
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    status = WriteBatch(group);
+  }
+  // 下一个 leader 要等这一批出队后才开始，所以各批的 apply 也按队列顺序
+  if (status.ok()) {
+    for (auto* w : group) {
+      if (w->apply) {
+        try {
+          (*w->apply)(w->seq);
+        } catch (...) {
+          w->error = std::current_exception();
+        }
+      }
+    }
+  }
+
+  lock.lock();
+  for (auto* w : group) {
+    writers_.pop_front();
+    w->status = status;
+    w->done = true;
+    if (w != &writer) {
+      w->cv.notify_one();
+    }
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.notify_one();
+  }
+  lock.unlock();
+  if (writer.error) {
+    std::rethrow_exception(writer.error);
+  }
+  return status;
+}
+
+Status Wal::WriteBatch(const std::vector<Writer*>& group) {
+  if (fd_ < 0) {
+    return Status::IOError("wal is closed");
+  }
+  size_t size = 0;
+  for (auto* w : group) {
+    size += kHeaderSize + w->payload.size();
+  }
+  if (offset_ > 0 && offset_ + size > options_.segment_size) {
+    auto status = CloseSegment();
+    if (!status.ok()) {
+      return status;
+    }
+    log_number_++;
+    status = NewSegment();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  std::string buffer;
+  buffer.reserve(size);
+  for (auto* w : group) {
+    size_t start = buffer.size();
+    PutFixed(&buffer, uint32_t{0});
+    PutFixed(&buffer, static_cast<uint32_t>(w->payload.size()));
+    PutFixed(&buffer, log_number_);
+    buffer.append(w->payload);
+    const char* hashed = buffer.data() + start + sizeof(uint32_t) * 2;
+    uint32_t hash = HashRecord(hashed, sizeof(uint64_t) + w->payload.size());
+    std::memcpy(buffer.data() + start, &hash, sizeof(hash));
+  }
+
+  size_t written = 0;
+  while (written < buffer.size()) {
+    auto n = ::pwrite(fd_, buffer.data() + written, buffer.size() - written,
+                      static_cast<off_t>(offset_ + written));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return IOErrorFromErrno("wal write");
+    }
+    written += static_cast<size_t>(n);
+  }
+  offset_ += written;
+  dirty_ = true;
+  num_batches_++;
+
+  if (options_.sync_mode == WalSyncMode::kEveryWrite) {
+    return SyncLocked();
+  }
+  return Status::OK();
+}
+
+Status Wal::NewSegment() {
+  auto path = SegmentPath(log_number_);
+  if (!recycled_.empty()) {
+    // 复用已释放的文件，空间已经分配好，旧记录的 log_number 对不上会被回放忽略
+    std::error_code ec;
+    std::filesystem::rename(recycled_.back(), path, ec);
+    if (ec) {
+      return Status::IOError(ec.message());
+    }
+    recycled_.pop_back();
+    fd_ = ::open(path.c_str(), O_WRONLY);
+  } else {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ >= 0) {
+      // 预分配失败（如文件系统不支持）只影响性能
+      ::posix_fallocate(fd_, 0, static_cast<off_t>(options_.segment_size));
+    }
+  }
+  if (fd_ < 0) {
+    return IOErrorFromErrno(std::format("open {}", path.string()));
+  }
+  SyncDir(dir_);
+  offset_ = 0;
+  dirty_ = false;
+  return Status::OK();
+}
+
+Status Wal::CloseSegment() {
+  Status status;
+  if (options_.sync_mode != WalSyncMode::kNone) {
+    status = SyncLocked();
+  }
+  ::close(fd_);
+  fd_ = -1;
+  live_segments_.push_back(log_number_);
+  return status;
+}
+
+Status Wal::SyncLocked() {
+  if (!dirty_ || fd_ < 0) {
+    return Status::OK();
+  }
+  if (::fdatasync(fd_) != 0) {
+    return IOErrorFromErrno("wal sync");
+  }
+  dirty_ = false;
+  return Status::OK();
+}
+
+Status Wal::Sync() {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return SyncLocked();
+}
+
+Status Wal::SwitchSegment(uint64_t* log_number) {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  auto status = CloseSegment();
+  if (!status.ok()) {
+    return status;
+  }
+  log_number_++;
+  status = NewSegment();
+  if (!status.ok()) {
+    return status;
+  }
+  *log_number = log_number_;
+  return Status::OK();
+}
+
+Status Wal::ReleaseSegmentsBefore(uint64_t log_number) {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  auto end = std::lower_bound(live_segments_.begin(), live_segments_.end(),
+                              log_number);
+  std::error_code ec;
+  for (auto it = live_segments_.begin(); it != end; ++it) {
+    auto path = SegmentPath(*it);
+    if (recycled_.size() < options_.max_recycled_segments) {
+      auto recycle_path = RecyclePath(next_recycle_id_++);
+      std::filesystem::rename(path, recycle_path, ec);
+      if (!ec) {
+        recycled_.push_back(std::move(recycle_path));
+      }
+    } else {
+      std::filesystem::remove(path, ec);
+    }
+    if (ec) {
+      live_segments_.erase(live_segments_.begin(), it);
+      return Status::IOError(ec.message());
+    }
+  }
+  live_segments_.erase(live_segments_.begin(), end);
+  SyncDir(dir_);
+  return Status::OK();
+}
+
+uint64_t Wal::current_log_number() const {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return log_number_;
+}
+
+size_t Wal::num_live_segments() const {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return live_segments_.size() + 1;
+}
+
+size_t Wal::num_recycled_segments() const {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return recycled_.size();
+}
+
+uint64_t Wal::num_batches() const {
+  std::lock_guard<std::mutex> lock(io_mutex_);
+  return num_batches_;
+}
+
+void Wal::SyncLoop() {
+  auto interval = std::chrono::milliseconds(options_.sync_interval_ms);
+  std::unique_lock<std::mutex> lock(io_mutex_);
+  while (!stop_) {
+    sync_cv_.wait_for(lock, interval, [&] { return stop_; });
+    if (stop_ || !dirty_ || fd_ < 0) {
+      continue;
+    }
+    // 在 dup 出的描述符上同步，fdatasync 期间不阻塞写入者
+    int fd = ::dup(fd_);
+    if (fd < 0) {
+      continue;
+    }
+    dirty_ = false;
+    lock.unlock();
+    ::fdatasync(fd);
+    ::close(fd);
+    lock.lock();
+  }
+}
+
+std::filesystem::path Wal::SegmentPath(uint64_t log_number) const {
+  return dir_ / std::format("{}{:06}{}", kSegmentPrefix, log_number,
+                            kLogSuffix);
+}
+
+std::filesystem::path Wal::RecyclePath(uint64_t id) const {
+  return dir_ / std::format("{}{:06}{}", kRecyclePrefix, id, kLogSuffix);
+}
@@ -4,6 +4,7 @@
 #include <format>
 
 #include "block/block.h"
+#include "block/block_cache.h"
 #include "block/block_iterator.h"
 
 class BlockTest : public ::testing::Test {
@@ -107,6 +108,81 @@ TEST_F(BlockTest, LargeDataTest) {
   }
 }
 
+TEST_F(BlockTest, MultiGetTest) {
+  Block block;
+  const int n = 500;
+  for (int i = 0; i < n; i++) {
+    block.AddEntry(std::format("key{:04}", i), std::format("value{}", i));
+  }
+
+  std::vector<std::string> keys;
+  for (int i = n - 1; i >= 0; i--) {
+    keys.push_back(std::format("key{:04}", i));
+  }
+  keys.push_back("missing");
+
+  auto results = block.MultiGetValueBinary(keys);
+  ASSERT_EQ(results.size(), keys.size());
+  for (int i = 0; i < n; i++) {
+    EXPECT_EQ(results[i].value(), std::format("value{}", n - 1 - i));
+  }
+  EXPECT_FALSE(results.back().has_value());
+}
+
+TEST_F(BlockTest, SeekTest) {
+  auto block = std::make_shared<Block>();
+  for (int i = 0; i < 100; i += 2) {
+    block->AddEntry(std::format("key{:03}", i), std::format("value{}", i));
+  }
+
+  BlockIterator it(block);
+  it.Seek("key010");
+  EXPECT_EQ((*it).first, "key010");
+  it.Seek("key011");
+  EXPECT_EQ((*it).first, "key012");
+  it.Seek("a");
+  EXPECT_EQ((*it).first, "key000");
+  it.Seek("key999");
+  EXPECT_TRUE(it.IsEnd());
+
+  it.SeekForPrev("key011");
+  EXPECT_EQ((*it).first, "key010");
+  it.SeekForPrev("key999");
+  EXPECT_EQ((*it).first, "key098");
+  it.SeekForPrev("a");
+  EXPECT_TRUE(it.IsEnd());
+
+  BlockIterator from_key(block, "key051");
+  EXPECT_EQ((*from_key).first, "key052");
+}
+
+TEST_F(BlockTest, ReverseIteration) {
+  auto block = std::make_shared<Block>();
+  for (int i = 0; i < 50; i++) {
+    block->AddEntry(std::format("key{:03}", i), std::format("value{}", i));
+  }
+
+  BlockIterator it(block);
+  int i = 49;
+  for (it.SeekToLast(); it.Valid(); it.Prev()) {
+    EXPECT_EQ(it.key(), std::format("key{:03}", i));
+    EXPECT_EQ(it.value(), std::format("value{}", i));
+    i--;
+  }
+  EXPECT_EQ(i, -1);
+
+  it.SeekForPrev("key0105");
+  EXPECT_EQ(it.key(), "key010");
+  it.Prev();
+  EXPECT_EQ(it.key(), "key009");
+  it.Next();
+  EXPECT_EQ(it.key(), "key010");
+
+  BlockIterator empty(std::make_shared<Block>());
+  empty.SeekToLast();
+  EXPECT_FALSE(empty.Valid());
+}
+
 TEST_F(BlockTest, ErrorHandingTest) {
   std::vector<uint8_t> invalid_data = {1, 2, 3};
   EXPECT_THROW(Block::Decode(invalid_data), std::runtime_error);
@@ -115,6 +191,25 @@ TEST_F(BlockTest, ErrorHandingTest) {
   EXPECT_THROW(Block::Decode(empty_data), std::runtime_error);
 }
 
+TEST_F(BlockTest, LargeValue) {
+  // v3 的 value_len 为 4 字节，可以保存超过 64KB 的 value
+  std::string large(100000, 'v');
+  Block block(1 << 20, kFormatV3);
+  ASSERT_TRUE(block.AddEntry("a", "small"));
+  ASSERT_TRUE(block.AddEntry("b", large));
+  auto decoded = Block::Decode(block.Encode(kFormatV3), false, kFormatV3);
+  EXPECT_EQ(decoded->GetValueBinary("a").value(), "small");
+  EXPECT_EQ(decoded->GetValueBinary("b").value(), large);
+  EXPECT_THROW(block.Encode(kFormatV2), std::runtime_error);
+
+  // 更早的格式不能表示，拒绝而不是截断
+  Block v2_block(kBlockSize, kFormatV2);
+  EXPECT_THROW(v2_block.AddEntry("b", large), std::runtime_error);
+  EXPECT_THROW(v2_block.AddEntry(std::string(70000, 'k'), "v"),
+               std::runtime_error);
+  EXPECT_TRUE(v2_block.IsEmpty());
+}
+
 TEST_F(BlockTest, IteratorTest) {
   auto block = std::make_shared<Block>();
 
@@ -154,4 +249,37 @@ TEST_F(BlockTest, IteratorTest) {
     EXPECT_EQ(value, test_data[count].second);
     count++;
   }
-}
\ No newline at end of file
+}
+TEST(BlockCacheTest, LruEviction) {
+  auto make_block = [](int n) {
+    auto block = std::make_shared<Block>();
+    for (int i = 0; i < n; i++) {
+      block->AddEntry(std::format("key{:03}", i), "value");
+    }
+    return block;
+  };
+  auto block = make_block(10);
+  // 容量恰好能放下 3 个 block
+  BlockCache cache(block->size() * 3);
+
+  for (size_t i = 0; i < 3; i++) {
+    cache.Insert(1, i, make_block(10));
+  }
+  EXPECT_EQ(cache.usage(), block->size() * 3);
+  // 访问 block 0 使其变为最近使用，插入第 4 个时淘汰 block 1
+  EXPECT_NE(cache.Lookup(1, 0), nullptr);
+  cache.Insert(1, 3, make_block(10));
+  EXPECT_NE(cache.Lookup(1, 0), nullptr);
+  EXPECT_EQ(cache.Lookup(1, 1), nullptr);
+  EXPECT_NE(cache.Lookup(1, 2), nullptr);
+  EXPECT_NE(cache.Lookup(1, 3), nullptr);
+  EXPECT_EQ(cache.hits(), 4);
+  EXPECT_EQ(cache.misses(), 1);
+
+  // 不同 SST 的同一下标互不影响
+  cache.Insert(2, 0, make_block(10));
+  cache.EraseSst(1);
+  EXPECT_EQ(cache.Lookup(1, 0), nullptr);
+  EXPECT_NE(cache.Lookup(2, 0), nullptr);
+  EXPECT_EQ(cache.usage(), block->size());
+}
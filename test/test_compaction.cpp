@@ -0,0 +1,430 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lsm/compaction.h"
+#include "sst/sst_iterator.h"
+#include "utils/thread_pool.h"
+
+namespace {
+
+// 用逗号把操作数追加到已有的值之后
+class AppendOperator final : public MergeOperator {
+ public:
+  std::string Merge(std::string_view, std::optional<std::string_view> existing,
+                    std::string_view operand) const override {
+    if (!existing) {
+      return std::string(operand);
+    }
+    return std::format("{},{}", *existing, operand);
+  }
+  const char* Name() const override { return "append"; }
+};
+
+}  // namespace
+
+class CompactionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directory(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  static LevelFileMeta File(size_t id, std::string first, std::string last,
+                            uint64_t size = 100) {
+    return LevelFileMeta{id, std::move(first), std::move(last), size};
+  }
+
+  static std::shared_ptr<Version> MakeVersion(
+      const std::vector<std::pair<size_t, LevelFileMeta>>& files) {
+    VersionBuilder builder{Version()};
+    VersionEdit edit;
+    for (const auto& [level, file] : files) {
+      edit.AddFile(level, file);
+    }
+    builder.Apply(edit);
+    return builder.Finish();
+  }
+
+  // 在 table_cache 中构建一个 SST，返回它的元信息
+  LevelFileMeta BuildSst(
+      TableCache& cache, size_t id,
+      const std::vector<std::pair<std::string, std::string>>& kvs) {
+    SSTBuilder builder(kBlockSize);
+    for (const auto& [k, v] : kvs) {
+      builder.Add(k, v);
+    }
+    auto sst = std::make_shared<SST>(
+        builder.Build(id, cache.SstPath(id).string(), nullptr));
+    cache.Insert(sst);
+    return LevelFileMeta::FromSst(*sst);
+  }
+
+  const std::filesystem::path dir_ = "test_compaction";
+};
+
+TEST_F(CompactionTest, ScoreAndLevelTargets) {
+  CompactionOptions options;
+  options.l0_compaction_trigger = 4;
+  options.max_bytes_for_level_base = 1000;
+  options.level_size_multiplier = 10;
+  LeveledCompactionPicker picker(options);
+  EXPECT_EQ(picker.MaxBytesForLevel(1), 1000);
+  EXPECT_EQ(picker.MaxBytesForLevel(3), 100000);
+
+  auto version = MakeVersion({{0, File(1, "a", "b")},
+                              {0, File(2, "a", "b")},
+                              {1, File(3, "a", "b", 1500)},
+                              {2, File(4, "a", "b", 5000)}});
+  EXPECT_DOUBLE_EQ(picker.Score(*version, 0), 0.5);
+  EXPECT_DOUBLE_EQ(picker.Score(*version, 1), 1.5);
+  EXPECT_DOUBLE_EQ(picker.Score(*version, 2), 0.5);
+
+  auto compaction = picker.Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->level, 1);
+  EXPECT_EQ(compaction->output_level, 2);
+  EXPECT_EQ(compaction->output_level_inputs.size(), 1);
+}
+
+TEST_F(CompactionTest, PickL0WithOverlappingL1) {
+  CompactionOptions options;
+  options.l0_compaction_trigger = 2;
+  LeveledCompactionPicker picker(options);
+  auto version = MakeVersion({{0, File(1, "c", "f")},
+                              {0, File(2, "e", "h")},
+                              {1, File(3, "a", "b")},
+                              {1, File(4, "d", "e")},
+                              {1, File(5, "g", "k")},
+                              {1, File(6, "m", "z")}});
+  auto compaction = picker.Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->level, 0);
+  EXPECT_EQ(compaction->inputs.size(), 2);
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{1, 2, 4, 5}));
+  EXPECT_FALSE(compaction->IsTrivialMove());
+
+  // 输入文件正在被其他 compaction 使用时不能选
+  EXPECT_FALSE(picker.Pick(*version, {5}).has_value());
+}
+
+TEST_F(CompactionTest, RoundRobinAndTrivialMove) {
+  CompactionOptions options;
+  options.max_bytes_for_level_base = 100;
+  LeveledCompactionPicker picker(options);
+  auto version = MakeVersion({{1, File(1, "a", "c")},
+                              {1, File(2, "d", "f")},
+                              {1, File(3, "g", "i")},
+                              {2, File(4, "e", "h")}});
+  std::vector<size_t> picked;
+  for (int i = 0; i < 4; i++) {
+    auto compaction = picker.Pick(*version, {});
+    ASSERT_TRUE(compaction.has_value());
+    picked.push_back(compaction->inputs[0].sst_id);
+  }
+  EXPECT_EQ(picked, (std::vector<size_t>{1, 2, 3, 1}));
+
+  auto compaction = picker.Pick(*version, {2});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->inputs[0].sst_id, 3);
+  EXPECT_FALSE(compaction->IsTrivialMove());
+  compaction = picker.Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->inputs[0].sst_id, 1);
+  EXPECT_TRUE(compaction->IsTrivialMove());
+}
+
+TEST_F(CompactionTest, JobMergesAndDropsDeletions) {
+  auto cache = std::make_shared<TableCache>(dir_);
+  auto l0_old = BuildSst(*cache, 1, {{"a", "1"}, {"b", "1"}, {"c", "1"}});
+  auto l0_new = BuildSst(*cache, 2, {{"a", "2"}, {"c", ""}, {"x", ""}});
+  auto l1 = BuildSst(*cache, 3, {{"b", "0"}, {"d", "0"}});
+  // L2 中有 x，x 的删除标记需要保留
+  auto l2 = BuildSst(*cache, 4, {{"x", "0"}});
+  auto version = MakeVersion({{0, l0_old}, {0, l0_new}, {1, l1}, {2, l2}});
+
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 1;
+  compaction.inputs = version->files(0);
+  compaction.output_level_inputs = version->files(1);
+  compaction.max_output_file_size = 1;
+
+  size_t next_id = 10;
+  CompactionOptions options;
+  CompactionJob job(compaction, version, cache, [&] { return next_id++; },
+                    options);
+  VersionEdit edit;
+  ASSERT_TRUE(job.Run(&edit).ok());
+  EXPECT_EQ(job.num_dropped_deletions(), 1);
+  EXPECT_EQ(job.num_output_entries(), 4);
+  EXPECT_EQ(edit.deleted_files.size(), 3);
+
+  // max_output_file_size 很小，每条记录一个输出文件
+  std::map<std::string, std::string> merged;
+  for (const auto& [level, file] : edit.new_files) {
+    EXPECT_EQ(level, 1);
+    for (SstIterator it(cache->Get(file.sst_id)); it.Valid(); it.Next()) {
+      merged.emplace(it.key(), it.value());
+    }
+  }
+  std::map<std::string, std::string> expected{
+      {"a", "2"}, {"b", "1"}, {"d", "0"}, {"x", ""}};
+  EXPECT_EQ(merged, expected);
+}
+
+TEST_F(CompactionTest, JobMergeOperands) {
+  auto cache = std::make_shared<TableCache>(dir_);
+  auto l0_old = BuildSst(*cache, 1,
+                         {{"a", EncodeValue("x")},
+                          {"b", EncodeMergeOperand("1")},
+                          {"c", EncodeMergeOperand("1")},
+                          {"d", ""}});
+  auto l0_new = BuildSst(*cache, 2,
+                         {{"a", EncodeMergeOperand("y")},
+                          {"b", EncodeMergeOperand("2")},
+                          {"c", EncodeMergeOperand("2")},
+                          {"d", EncodeMergeOperand("z")}});
+  // L2 中有 c，c 的操作数只能合成一个操作数
+  auto l2 = BuildSst(*cache, 3, {{"c", EncodeValue("0")}});
+  auto version = MakeVersion({{0, l0_old}, {0, l0_new}, {2, l2}});
+
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 1;
+  compaction.inputs = version->files(0);
+
+  size_t next_id = 10;
+  CompactionOptions options;
+  // 没有 MergeOperator 时不能丢弃任何操作数
+  CompactionJob no_operator(compaction, version, cache,
+                            [&] { return next_id++; }, options);
+  VersionEdit edit;
+  EXPECT_TRUE(no_operator.Run(&edit).IsInvalidArgument());
+
+  CompactionJob job(compaction, version, cache, [&] { return next_id++; },
+                    options);
+  job.SetMergeOperator(std::make_shared<AppendOperator>());
+  ASSERT_TRUE(job.Run(&edit).ok());
+  EXPECT_EQ(job.num_output_entries(), 4);
+  // c 的两个操作数合成一个，其余的全部作用在旧值上
+  EXPECT_EQ(job.num_merged_operands(), 5);
+  ASSERT_EQ(edit.new_files.size(), 1);
+  std::map<std::string, std::string> merged;
+  for (SstIterator it(cache->Get(edit.new_files[0].second.sst_id));
+       it.Valid(); it.Next()) {
+    merged.emplace(it.key(), it.value());
+  }
+  std::map<std::string, std::string> expected{
+      {"a", EncodeValue("x,y")},
+      {"b", EncodeValue("1,2")},
+      {"c", EncodeMergeOperand("1,2")},
+      {"d", EncodeValue("z")}};
+  EXPECT_EQ(merged, expected);
+}
+
+TEST_F(CompactionTest, JobFailureRemovesOutputs) {
+  auto cache = std::make_shared<TableCache>(dir_);
+  // 前面的记录足够写出多个输出文件，最后的操作数使 compaction 失败
+  std::vector<std::pair<std::string, std::string>> kvs;
+  for (int i = 0; i < 200; i++) {
+    kvs.emplace_back(std::format("key{:03}", i), std::string(100, 'v'));
+  }
+  kvs.emplace_back("zzz", EncodeMergeOperand("1"));
+  auto version = MakeVersion({{0, BuildSst(*cache, 1, kvs)}});
+
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 1;
+  compaction.inputs = version->files(0);
+  compaction.max_output_file_size = 1;
+
+  size_t next_id = 10;
+  CompactionJob job(compaction, version, cache, [&] { return next_id++; },
+                    CompactionOptions());
+  VersionEdit edit;
+  EXPECT_TRUE(job.Run(&edit).IsInvalidArgument());
+  EXPECT_TRUE(edit.new_files.empty());
+  ASSERT_GT(next_id, 10);
+  for (size_t id = 10; id < next_id; id++) {
+    EXPECT_FALSE(std::filesystem::exists(cache->SstPath(id)));
+  }
+  EXPECT_TRUE(std::filesystem::exists(cache->SstPath(1)));
+}
+
+TEST_F(CompactionTest, JobSubcompactions) {
+  auto cache = std::make_shared<TableCache>(dir_);
+  std::map<std::string, std::string> expected;
+  std::vector<std::pair<size_t, LevelFileMeta>> files;
+  // 两个 L0 文件覆盖整个 key 空间，L1 有两个文件
+  for (size_t id = 1; id <= 2; id++) {
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (int i = 0; i < 2000; i += static_cast<int>(id)) {
+      auto key = std::format("key{:05}", i);
+      auto value = std::format("value{}_{}", id, i);
+      kvs.emplace_back(key, value);
+      expected[key] = value;
+    }
+    files.emplace_back(0, BuildSst(*cache, id, kvs));
+  }
+  for (size_t id = 3; id <= 4; id++) {
+    std::vector<std::pair<std::string, std::string>> kvs;
+    for (size_t i = (id - 3) * 1500; i < (id - 2) * 1500; i += 3) {
+      auto key = std::format("key{:05}", i);
+      kvs.emplace_back(key, "old");
+      expected.emplace(key, "old");
+    }
+    files.emplace_back(1, BuildSst(*cache, id, kvs));
+  }
+  auto version = MakeVersion(files);
+
+  Compaction compaction;
+  compaction.level = 0;
+  compaction.output_level = 1;
+  compaction.inputs = version->files(0);
+  compaction.output_level_inputs = version->files(1);
+  compaction.max_output_file_size = 16 * 1024;
+
+  std::atomic<size_t> next_id = 10;
+  CompactionOptions options;
+  options.max_subcompactions = 4;
+  ThreadPool pool(options.max_subcompactions - 1);
+  CompactionJob job(compaction, version, cache, [&] { return next_id++; },
+                    options);
+  job.SetThreadPool(&pool);
+  VersionEdit edit;
+  ASSERT_TRUE(job.Run(&edit).ok());
+  EXPECT_EQ(job.num_subcompactions(), 4);
+  EXPECT_EQ(job.num_output_entries(), expected.size());
+  EXPECT_EQ(edit.deleted_files.size(), 4);
+
+  // 各子范围的输出互不重叠，合起来与单线程归并的结果相同
+  VersionBuilder builder(*version);
+  builder.Apply(edit);
+  auto output = builder.Finish();
+  const auto& outputs = output->files(1);
+  ASSERT_EQ(outputs.size(), edit.new_files.size());
+  for (size_t i = 1; i < outputs.size(); i++) {
+    EXPECT_LT(outputs[i - 1].last_key, outputs[i].first_key);
+  }
+  std::map<std::string, std::string> merged;
+  for (const auto& file : outputs) {
+    for (SstIterator it(cache->Get(file.sst_id)); it.Valid(); it.Next()) {
+      merged.emplace(it.key(), it.value());
+    }
+  }
+  EXPECT_EQ(merged, expected);
+
+  // 输出到 L0 时不切分
+  compaction.output_level = 0;
+  compaction.output_level_inputs.clear();
+  CompactionJob l0_job(compaction, version, cache, [&] { return next_id++; },
+                       options);
+  VersionEdit l0_edit;
+  ASSERT_TRUE(l0_job.Run(&l0_edit).ok());
+  EXPECT_EQ(l0_job.num_subcompactions(), 1);
+}
+
+TEST_F(CompactionTest, UniversalPicker) {
+  CompactionOptions options;
+  options.style = CompactionStyle::kUniversal;
+  options.l0_compaction_trigger = 4;
+  auto picker = NewCompactionPicker(options);
+
+  auto run = [](size_t id, uint64_t size) {
+    return LevelFileMeta{id, "a", "z", size, id};
+  };
+  // 段数未达到 trigger
+  auto version = MakeVersion({{0, run(1, 1000)}, {0, run(2, 10)}});
+  EXPECT_FALSE(picker->Pick(*version, {}).has_value());
+
+  // 最新的三个段大小相近，最旧的段很大：只合并新的三个，保留删除标记
+  version = MakeVersion({{0, run(1, 10000)},
+                         {0, run(2, 100)},
+                         {0, run(3, 100)},
+                         {0, run(4, 100)}});
+  auto compaction = picker->Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->output_level, 0);
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{2, 3, 4}));
+  EXPECT_FALSE(compaction->may_drop_deletions);
+  EXPECT_FALSE(compaction->IsTrivialMove());
+  EXPECT_FALSE(picker->Pick(*version, {3}).has_value());
+
+  // 空间放大超过 200%：全量合并
+  version = MakeVersion({{0, run(1, 100)},
+                         {0, run(2, 150)},
+                         {0, run(3, 40)},
+                         {0, run(4, 20)}});
+  compaction = picker->Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{1, 2, 3, 4}));
+  EXPECT_TRUE(compaction->may_drop_deletions);
+
+  // 大小差距都很大：合并最新的段使段数回到 trigger 以下
+  version = MakeVersion({{0, run(1, 100000)},
+                         {0, run(2, 10000)},
+                         {0, run(3, 1000)},
+                         {0, run(4, 100)}});
+  compaction = picker->Pick(*version, {});
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{3, 4}));
+}
+
+TEST_F(CompactionTest, FifoPicker) {
+  CompactionOptions options;
+  options.style = CompactionStyle::kFifo;
+  options.fifo_ttl_seconds = 100;
+  options.fifo_max_table_files_size = 250;
+  FifoCompactionPicker picker(options);
+
+  auto file = [](size_t id, uint64_t size, uint64_t creation_time) {
+    return LevelFileMeta{id, "a", "z", size, id, creation_time};
+  };
+  constexpr uint64_t kNow = 10000;
+  // 都没有过期且总大小未超限
+  auto version = MakeVersion({{0, file(1, 100, kNow - 50)},
+                              {0, file(2, 100, kNow - 10)}});
+  EXPECT_FALSE(picker.PickAt(*version, {}, kNow).has_value());
+
+  // 过期的文件和超出总大小的最旧文件一起删除，creation_time 未知的不按时间删除
+  version = MakeVersion({{0, file(1, 100, 0)},
+                         {0, file(2, 100, kNow - 200)},
+                         {0, file(3, 100, kNow - 50)},
+                         {0, file(4, 100, kNow - 40)},
+                         {0, file(5, 100, kNow - 10)}});
+  auto compaction = picker.PickAt(*version, {}, kNow);
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_TRUE(compaction->deletion_only);
+  EXPECT_FALSE(compaction->IsTrivialMove());
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{1, 2, 3}));
+  EXPECT_FALSE(picker.PickAt(*version, {5}, kNow).has_value());
+
+  // 时间窗口：已经结束的窗口中相邻的文件合并，当前窗口不动
+  options.fifo_ttl_seconds = 0;
+  options.fifo_max_table_files_size = 0;
+  options.fifo_time_window_seconds = 1000;
+  FifoCompactionPicker window_picker(options);
+  version = MakeVersion({{0, file(1, 100, 7100)},
+                         {0, file(2, 100, 8100)},
+                         {0, file(3, 100, 8500)},
+                         {0, file(4, 100, 8900)},
+                         {0, file(5, 100, 9100)},
+                         {0, file(6, 100, 9200)}});
+  compaction = window_picker.PickAt(*version, {}, kNow - 500);
+  ASSERT_TRUE(compaction.has_value());
+  EXPECT_FALSE(compaction->deletion_only);
+  EXPECT_EQ(compaction->output_level, 0);
+  EXPECT_EQ(compaction->InputIds(), (std::vector<size_t>{2, 3, 4}));
+  EXPECT_FALSE(compaction->may_drop_deletions);
+  version = MakeVersion({{0, file(1, 100, 7100)},
+                         {0, file(5, 100, 9100)},
+                         {0, file(6, 100, 9200)}});
+  EXPECT_FALSE(window_picker.PickAt(*version, {}, kNow - 500).has_value());
+}
@@ -0,0 +1,937 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lsm/engine.h"
+
+namespace {
+
+// 把值和操作数都看作十进制整数，相加得到新值
+class CounterOperator final : public MergeOperator {
+ public:
+  std::string Merge(std::string_view, std::optional<std::string_view> existing,
+                    std::string_view operand) const override {
+    int64_t base = existing ? std::stoll(std::string(*existing)) : 0;
+    return std::to_string(base + std::stoll(std::string(operand)));
+  }
+  const char* Name() const override { return "counter"; }
+};
+
+class AppendOperator final : public MergeOperator {
+ public:
+  std::string Merge(std::string_view, std::optional<std::string_view> existing,
+                    std::string_view operand) const override {
+    std::string result(existing.value_or(""));
+    result.append(operand);
+    return result;
+  }
+  const char* Name() const override { return "append"; }
+};
+
+}  // namespace
+
+class EngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::filesystem::remove_all("test_data");
+  }
+
+  void TearDown() override { std::filesystem::remove_all("test_data"); }
+};
+
+TEST_F(EngineTest, BasicOperations) {
+  LSMEngine engine("test_data");
+
+  engine.Put("key1", "value1");
+  EXPECT_EQ(engine.Get("key1").value(), "value1");
+
+  engine.Put("key1", "new_value");
+  EXPECT_EQ(engine.Get("key1").value(), "new_value");
+
+  engine.Remove("key1");
+  EXPECT_FALSE(engine.Get("key1").has_value());
+  EXPECT_FALSE(engine.Get("non exits").has_value());
+}
+
+TEST_F(EngineTest, GetFromSst) {
+  LSMEngine engine("test_data");
+  for (int i = 0; i < 100; i++) {
+    engine.Put(std::format("key{:03}", i), std::format("value{}", i));
+  }
+  engine.Flush();
+
+  for (int i = 0; i < 100; i++) {
+    std::string value;
+    auto status = engine.Get(std::format("key{:03}", i), &value);
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(value, std::format("value{}", i));
+  }
+
+  std::string value;
+  EXPECT_TRUE(engine.Get("key", &value).IsNotFound());
+  EXPECT_TRUE(engine.Get("key0505", &value).IsNotFound());
+  EXPECT_TRUE(engine.Get("zzz", &value).IsNotFound());
+}
+
+TEST_F(EngineTest, RemoveShadowsSst) {
+  LSMEngine engine("test_data");
+  engine.Put("key1", "value1");
+  engine.Put("key2", "value2");
+  engine.Flush();
+
+  engine.Remove("key1");
+  EXPECT_FALSE(engine.Get("key1").has_value());
+  EXPECT_EQ(engine.Get("key2").value(), "value2");
+}
+
+TEST_F(EngineTest, ParallelScan) {
+  LSMEngine engine("test_data");
+  std::map<std::string, std::string> expected;
+  // 多个 L0 文件的 key 范围重叠，memtable 中还有覆盖和删除
+  for (int round = 0; round < 3; round++) {
+    for (int i = round; i < 3000; i += 2) {
+      auto key = std::format("key{:05}", i);
+      auto value = std::format("value{}_{}", i, round);
+      engine.Put(key, value);
+      expected[key] = value;
+    }
+    engine.Flush();
+  }
+  for (int i = 0; i < 3000; i += 7) {
+    auto key = std::format("key{:05}", i);
+    engine.Remove(key);
+    expected.erase(key);
+  }
+  engine.Put("key00001", "latest");
+  expected["key00001"] = "latest";
+
+  auto splits = engine.SplitRange("", "", 8);
+  EXPECT_GT(splits.size(), 1);
+  EXPECT_TRUE(std::is_sorted(splits.begin(), splits.end()));
+
+  ScanOptions options;
+  options.num_threads = 4;
+  options.ordered = true;
+  std::vector<std::pair<std::string, std::string>> ordered;
+  auto status = engine.ParallelScan(
+      "", "", options, [&](std::string_view k, std::string_view v) {
+        ordered.emplace_back(k, v);
+        return true;
+      });
+  ASSERT_TRUE(status.ok());
+  std::vector<std::pair<std::string, std::string>> want(expected.begin(),
+                                                        expected.end());
+  EXPECT_EQ(ordered, want);
+
+  // 无序模式在工作线程上回调，结果集合相同
+  options.ordered = false;
+  std::mutex mutex;
+  std::map<std::string, std::string> unordered;
+  status = engine.ParallelScan(
+      "key01000", "key02000", options,
+      [&](std::string_view k, std::string_view v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_TRUE(unordered.emplace(k, v).second);
+        return true;
+      });
+  ASSERT_TRUE(status.ok());
+  std::map<std::string, std::string> want_range(
+      expected.lower_bound("key01000"), expected.lower_bound("key02000"));
+  EXPECT_EQ(unordered, want_range);
+
+  // 后台预读不影响结果
+  options.prefetch_threads = 2;
+  std::vector<std::pair<std::string, std::string>> prefetched;
+  status = engine.ParallelScan(
+      "", "", options, [&](std::string_view k, std::string_view v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        prefetched.emplace_back(k, v);
+        return true;
+      });
+  ASSERT_TRUE(status.ok());
+  std::sort(prefetched.begin(), prefetched.end());
+  EXPECT_EQ(prefetched, want);
+
+  // 回调返回 false 时停止
+  options.ordered = true;
+  size_t count = 0;
+  status = engine.ParallelScan("", "", options,
+                               [&](std::string_view, std::string_view) {
+                                 return ++count < 10;
+                               });
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(count, 10);
+}
+
+TEST_F(EngineTest, ParallelScanSharesSuperVersion) {
+  LSMEngine engine("test_data");
+  for (int i = 0; i < 3000; i++) {
+    engine.Put(std::format("key{:05}", i), "old");
+  }
+  engine.Flush();
+  engine.Put("key00000", "mem");
+  ASSERT_GT(engine.SplitRange("", "", 4).size(), 1);
+
+  // 扫描开始后冻结活跃 memtable，之后的写入进入新的 memtable，还没开始
+  // 的分片也看不到
+  ScanOptions options;
+  options.num_threads = 1;
+  options.ordered = true;
+  std::map<std::string, std::string> scanned;
+  auto status = engine.ParallelScan(
+      "", "", options, [&](std::string_view k, std::string_view v) {
+        if (scanned.empty()) {
+          engine.Flush();
+          engine.Put("key02999", "new");
+        }
+        scanned.emplace(k, v);
+        return true;
+      });
+  ASSERT_TRUE(status.ok());
+  ASSERT_EQ(scanned.size(), 3000);
+  EXPECT_EQ(scanned["key00000"], "mem");
+  EXPECT_EQ(scanned["key02999"], "old");
+}
+
+TEST_F(EngineTest, RecoverFromWal) {
+  {
+    LSMEngine engine("test_data");
+    engine.Put("key1", "value1");
+    engine.Put("key2", "value2");
+    engine.Remove("key1");
+  }
+  {
+    LSMEngine engine("test_data");
+    EXPECT_FALSE(engine.Get("key1").has_value());
+    EXPECT_EQ(engine.Get("key2").value(), "value2");
+    engine.Put("key3", "value3");
+  }
+  LSMEngine engine("test_data");
+  EXPECT_EQ(engine.Get("key2").value(), "value2");
+  EXPECT_EQ(engine.Get("key3").value(), "value3");
+  ASSERT_NE(engine.wal_, nullptr);
+  EXPECT_EQ(engine.wal_->num_live_segments(), 3);
+
+  // Flush 之后旧的 segment 被释放，不再回放
+  engine.Flush();
+  EXPECT_EQ(engine.wal_->num_live_segments(), 1);
+  EXPECT_TRUE(engine.GetSuperVersion()->mem->total_size() == 0);
+}
+
+TEST_F(EngineTest, RecoverSstsFromManifest) {
+  // 关闭后台 compaction，保持 L0 的文件个数
+  EngineOptions base_options;
+  base_options.compaction.max_background_compactions = 0;
+  {
+    LSMEngine engine("test_data", base_options);
+    for (int i = 0; i < 100; i++) {
+      engine.Put(std::format("key{:03}", i), std::format("value{}", i));
+      if (i % 25 == 24) {
+        engine.Flush();
+      }
+    }
+    engine.Remove("key010");
+    engine.Flush();
+  }
+
+  for (size_t open_threads : {0, 4}) {
+    auto options = base_options;
+    options.open_threads = open_threads;
+    LSMEngine engine("test_data", options);
+    EXPECT_EQ(engine.versions_.current()->files(0).size(), 5);
+    EXPECT_EQ(engine.table_cache_->num_open(), open_threads == 0 ? 0 : 5);
+    EXPECT_EQ(engine.GetSuperVersion()->mem->total_size(), 0);
+    EXPECT_EQ(engine.Get("key000").value(), "value0");
+    EXPECT_EQ(engine.Get("key099").value(), "value99");
+  }
+
+  // 新的文件编号不会覆盖已有的 SST
+  LSMEngine engine("test_data", base_options);
+  engine.Put("key100", "value100");
+  engine.Flush();
+  EXPECT_EQ(engine.versions_.current()->files(0).back().sst_id, 5);
+  EXPECT_EQ(engine.Get("key050").value(), "value50");
+  EXPECT_EQ(engine.Get("key100").value(), "value100");
+}
+
+TEST_F(EngineTest, SequenceNumbers) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  {
+    LSMEngine engine("test_data", options);
+    for (int i = 0; i < 10; i++) {
+      engine.Put(std::format("key{:02}", i), "v");
+    }
+    engine.Remove("key00");
+    engine.Flush();
+    const auto& l0 = engine.GetSuperVersion()->current->files(0);
+    ASSERT_EQ(l0.size(), 1);
+    const auto& properties = engine.table_cache_->Get(l0[0].sst_id)->properties();
+    EXPECT_EQ(properties.min_seq, 1);
+    EXPECT_EQ(properties.max_seq, 11);
+  }
+
+  // WAL 已经释放，重新打开后序列号从 MANIFEST 中记录的位置继续
+  LSMEngine engine("test_data", options);
+  engine.Put("key99", "v");
+  engine.Flush();
+  auto version = engine.GetSuperVersion()->current;
+  ASSERT_EQ(version->files(0).size(), 2);
+  const auto& properties =
+      engine.table_cache_->Get(version->files(0)[1].sst_id)->properties();
+  EXPECT_EQ(properties.min_seq, 12);
+  EXPECT_EQ(properties.max_seq, 12);
+
+  // compaction 的输出覆盖所有输入的序列号范围
+  Compaction to_l1;
+  to_l1.inputs = version->files(0);
+  ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+  for (const auto& file : engine.GetSuperVersion()->current->files(1)) {
+    const auto& merged = engine.table_cache_->Get(file.sst_id)->properties();
+    EXPECT_EQ(merged.min_seq, 1);
+    EXPECT_EQ(merged.max_seq, 12);
+  }
+}
+
+TEST_F(EngineTest, FailedFlushKeepsData) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  {
+    LSMEngine engine("test_data", options);
+    engine.Put("key1", "value1");
+    // 在下一个 SST 的路径上放一个目录，使写 SST 失败
+    auto blocked = engine.SstPath(engine.versions_.NewFileNumber() + 1);
+    std::filesystem::create_directory(blocked);
+    EXPECT_THROW(engine.Flush(), std::runtime_error);
+    // 冻结的 memtable 仍然可读
+    EXPECT_EQ(engine.Get("key1").value(), "value1");
+    EXPECT_EQ(engine.GetSuperVersion()->imm.size(), 1);
+
+    // 下一次 Flush 先刷出之前失败的 memtable，再刷出新的
+    std::filesystem::remove(blocked);
+    engine.Put("key2", "value2");
+    engine.Flush();
+    EXPECT_TRUE(engine.GetSuperVersion()->imm.empty());
+    EXPECT_EQ(engine.GetSuperVersion()->current->files(0).size(), 2);
+
+    // 失败后直接关闭，数据只在 WAL 中
+    engine.Put("key3", "value3");
+    blocked = engine.SstPath(engine.versions_.NewFileNumber() + 1);
+    std::filesystem::create_directory(blocked);
+    EXPECT_THROW(engine.Flush(), std::runtime_error);
+    engine.Put("key4", "value4");
+    std::filesystem::remove(blocked);
+  }
+  LSMEngine engine("test_data", options);
+  for (int i = 1; i <= 4; i++) {
+    EXPECT_EQ(engine.Get(std::format("key{}", i)).value(),
+              std::format("value{}", i));
+  }
+}
+
+TEST_F(EngineTest, DeleteOrphanFilesOnOpen) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  std::filesystem::path live;
+  {
+    LSMEngine engine("test_data", options);
+    engine.Put("key", "value");
+    engine.Flush();
+    live = engine.SstPath(engine.GetSuperVersion()->current->files(0)[0].sst_id);
+  }
+  // 模拟崩溃前写完但没有记录到 MANIFEST 的输出
+  std::filesystem::copy_file(live, "test_data/sst_100");
+  std::filesystem::copy_file(live, "test_data/sst_1000");
+
+  LSMEngine engine("test_data", options);
+  EXPECT_TRUE(std::filesystem::exists(live));
+  EXPECT_FALSE(std::filesystem::exists("test_data/sst_100"));
+  EXPECT_FALSE(std::filesystem::exists("test_data/sst_1000"));
+  EXPECT_EQ(engine.Get("key").value(), "value");
+}
+
+TEST_F(EngineTest, IteratorPinsFilesAcrossRestart) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  std::map<std::string, std::string> expected;
+  {
+    LSMEngine engine("test_data", options);
+    for (int i = 0; i < 200; i++) {
+      auto key = std::format("key{:03}", i);
+      engine.Put(key, std::string(32, 'a'));
+      expected[key] = std::string(32, 'a');
+      if (i == 99) {
+        engine.Flush();
+      }
+    }
+    engine.Flush();
+    Compaction to_l1;
+    to_l1.inputs = engine.GetSuperVersion()->current->files(0);
+    to_l1.max_output_file_size = 1024;
+    ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+  }
+
+  // 重启后的第一个 Version 被迭代器持有，L1 的文件在遍历时才打开，
+  // 之后的 compaction 不能删掉它们
+  LSMEngine engine("test_data", options);
+  ASSERT_GT(engine.GetSuperVersion()->current->files(1).size(), 1);
+  auto iter = engine.NewIterator();
+  for (int i = 0; i < 200; i++) {
+    engine.Put(std::format("key{:03}", i), "b");
+  }
+  engine.Flush();
+  Compaction to_l1;
+  to_l1.inputs = engine.GetSuperVersion()->current->files(0);
+  to_l1.output_level_inputs = engine.GetSuperVersion()->current->files(1);
+  ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+  engine.DeleteObsoleteFiles();
+
+  std::map<std::string, std::string> seen;
+  for (; iter.Valid(); iter.Next()) {
+    seen.emplace(iter.key(), iter.value());
+  }
+  EXPECT_EQ(seen, expected);
+  EXPECT_EQ(engine.Get("key100").value(), "b");
+}
+
+TEST_F(EngineTest, LeveledCompaction) {
+  EngineOptions options;
+  options.compaction.l0_compaction_trigger = 2;
+  options.compaction.target_file_size = 8 * 1024;
+  options.compaction.max_bytes_for_level_base = 32 * 1024;
+  options.compaction.level_size_multiplier = 4;
+  options.compaction.max_background_compactions = 2;
+  options.compaction.max_subcompactions = 3;
+
+  std::map<std::string, std::string> expected;
+  {
+    LSMEngine engine("test_data", options);
+    for (int round = 0; round < 20; round++) {
+      for (int i = 0; i < 300; i++) {
+        auto key = std::format("key{:05}", (i * 7919 + round * 31) % 3000);
+        auto value = std::format("value{}_{}", round, i);
+        engine.Put(key, value);
+        expected[key] = value;
+      }
+      for (int i = 0; i < 20; i++) {
+        auto key = std::format("key{:05}", (round * 100 + i * 13) % 3000);
+        engine.Remove(key);
+        expected.erase(key);
+      }
+      engine.Flush();
+    }
+    ASSERT_TRUE(engine.WaitForCompactions().ok());
+
+    auto version = engine.versions_.current();
+    EXPECT_LT(version->files(0).size(), 2);
+    EXPECT_GT(version->num_files(), version->files(0).size());
+    for (size_t level = 1; level < version->num_levels(); level++) {
+      const auto& files = version->files(level);
+      for (size_t i = 1; i < files.size(); i++) {
+        EXPECT_LT(files[i - 1].last_key, files[i].first_key);
+      }
+    }
+
+    // 被合并掉的文件已经从磁盘删除
+    size_t num_ssts = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("test_data")) {
+      if (entry.path().filename().string().starts_with("sst_")) {
+        num_ssts++;
+      }
+    }
+    EXPECT_EQ(num_ssts, version->num_files());
+
+    for (int i = 0; i < 3000; i++) {
+      auto key = std::format("key{:05}", i);
+      auto it = expected.find(key);
+      if (it == expected.end()) {
+        EXPECT_FALSE(engine.Get(key).has_value()) << key;
+      } else {
+        EXPECT_EQ(engine.Get(key).value_or(""), it->second) << key;
+      }
+    }
+
+    std::map<std::string, std::string> scanned;
+    ScanOptions scan_options;
+    scan_options.num_threads = 4;
+    ASSERT_TRUE(engine
+                    .ParallelScan("", "", scan_options,
+                                  [&](std::string_view k, std::string_view v) {
+                                    static std::mutex mutex;
+                                    std::lock_guard<std::mutex> lock(mutex);
+                                    scanned.emplace(k, v);
+                                    return true;
+                                  })
+                    .ok());
+    EXPECT_EQ(scanned, expected);
+  }
+
+  LSMEngine engine("test_data", options);
+  for (const auto& [key, value] : expected) {
+    EXPECT_EQ(engine.Get(key).value_or(""), value) << key;
+  }
+}
+
+TEST_F(EngineTest, UniversalCompaction) {
+  EngineOptions options;
+  options.compaction.style = CompactionStyle::kUniversal;
+  options.compaction.l0_compaction_trigger = 4;
+
+  std::map<std::string, std::string> expected;
+  auto scan_all = [](LSMEngine& engine) {
+    std::map<std::string, std::string> scanned;
+    ScanOptions scan_options;
+    scan_options.num_threads = 1;
+    EXPECT_TRUE(engine
+                    .ParallelScan("", "", scan_options,
+                                  [&](std::string_view k, std::string_view v) {
+                                    scanned.emplace(k, v);
+                                    return true;
+                                  })
+                    .ok());
+    return scanned;
+  };
+  {
+    LSMEngine engine("test_data", options);
+    for (int round = 0; round < 30; round++) {
+      for (int i = 0; i < 100; i++) {
+        auto key = std::format("key{:04}", (i * 37 + round * 101) % 1000);
+        auto value = std::format("value{}_{}", round, i);
+        engine.Put(key, value);
+        expected[key] = value;
+      }
+      auto removed = std::format("key{:04}", (round * 101) % 1000);
+      engine.Remove(removed);
+      expected.erase(removed);
+      engine.Flush();
+      ASSERT_TRUE(engine.WaitForCompactions().ok());
+      // 段数始终保持在 trigger 以下，L1 及以下不会有数据
+      auto version = engine.versions_.current();
+      EXPECT_LT(version->files(0).size(), 4);
+      EXPECT_EQ(version->num_files(), version->files(0).size());
+    }
+    EXPECT_EQ(scan_all(engine), expected);
+  }
+
+  LSMEngine engine("test_data", options);
+  EXPECT_EQ(scan_all(engine), expected);
+  // 所有数据都在互相重叠的 L0 段中，点查必须从新到旧
+  for (int i = 0; i < 1000; i++) {
+    auto key = std::format("key{:04}", i);
+    auto it = expected.find(key);
+    if (it == expected.end()) {
+      EXPECT_FALSE(engine.Get(key).has_value()) << key;
+    } else {
+      EXPECT_EQ(engine.Get(key).value_or(""), it->second) << key;
+    }
+  }
+}
+
+TEST_F(EngineTest, FifoCompaction) {
+  EngineOptions options;
+  options.compaction.style = CompactionStyle::kFifo;
+  options.compaction.fifo_max_table_files_size = 0;
+
+  // 先量出一轮数据的文件大小，总大小上限设为三轮多一点
+  auto put_round = [](LSMEngine& engine, int round) {
+    for (int i = 0; i < 200; i++) {
+      engine.Put(std::format("r{:02}_{:04}", round, i),
+                 std::string(100, 'a' + round % 26));
+    }
+    engine.Flush();
+  };
+  uint64_t round_size;
+  {
+    LSMEngine engine("test_data", options);
+    put_round(engine, 0);
+    ASSERT_TRUE(engine.WaitForCompactions().ok());
+    round_size = engine.versions_.current()->level_size(0);
+  }
+  std::filesystem::remove_all("test_data");
+  options.compaction.fifo_max_table_files_size = round_size * 3 + round_size / 2;
+
+  {
+    LSMEngine engine("test_data", options);
+    for (int round = 0; round < 10; round++) {
+      put_round(engine, round);
+      ASSERT_TRUE(engine.WaitForCompactions().ok());
+      auto version = engine.versions_.current();
+      EXPECT_LE(version->level_size(0),
+                options.compaction.fifo_max_table_files_size);
+      EXPECT_EQ(version->num_files(), version->files(0).size());
+    }
+    EXPECT_EQ(engine.versions_.current()->files(0).size(), 3);
+  }
+
+  LSMEngine engine("test_data", options);
+  size_t num_ssts = 0;
+  for (const auto& entry : std::filesystem::directory_iterator("test_data")) {
+    if (entry.path().filename().string().starts_with("sst_")) {
+      num_ssts++;
+    }
+  }
+  EXPECT_EQ(num_ssts, 3);
+  // 只剩最新的三轮
+  for (int round = 0; round < 10; round++) {
+    EXPECT_EQ(engine.Get(std::format("r{:02}_{:04}", round, 7)).has_value(),
+              round >= 7)
+        << round;
+  }
+}
+
+TEST_F(EngineTest, FifoTtlWithoutWrites) {
+  EngineOptions options;
+  options.compaction.style = CompactionStyle::kFifo;
+  options.compaction.fifo_ttl_seconds = 2;
+  options.compaction.fifo_check_interval_ms = 50;
+  LSMEngine engine("test_data", options);
+  engine.Put("key", "value");
+  engine.Flush();
+  ASSERT_TRUE(engine.WaitForCompactions().ok());
+  // creation_time 以秒为单位，TTL 为 2 秒时至少还要 1 秒才过期
+  ASSERT_EQ(engine.GetSuperVersion()->current->files(0).size(), 1);
+
+  // 之后没有写入，过期的文件由定时调度删除
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!engine.GetSuperVersion()->current->files(0).empty() &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  EXPECT_TRUE(engine.GetSuperVersion()->current->files(0).empty());
+  EXPECT_FALSE(engine.Get("key").has_value());
+}
+
+TEST_F(EngineTest, RateLimitedBackgroundWrites) {
+  EngineOptions options;
+  options.compaction.l0_compaction_trigger = 2;
+  options.rate_limiter = std::make_shared<RateLimiter>();
+  LSMEngine engine("test_data", options);
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < 500; i++) {
+      engine.Put(std::format("key{:04}", i), std::format("value{}", round));
+    }
+    engine.Flush();
+  }
+  ASSERT_TRUE(engine.WaitForCompactions().ok());
+  EXPECT_EQ(engine.Get("key0123").value_or(""), "value3");
+
+  // Flush 走高优先级，compaction 走低优先级
+  const auto& limiter = *options.rate_limiter;
+  EXPECT_GT(limiter.total_bytes_through(IOPriority::kHigh), 0);
+  EXPECT_GT(limiter.total_bytes_through(IOPriority::kLow), 0);
+}
+
+TEST_F(EngineTest, ConcurrentReadsDuringFlushAndCompaction) {
+  EngineOptions options;
+  options.compaction.l0_compaction_trigger = 2;
+  options.compaction.max_background_compactions = 2;
+  LSMEngine engine("test_data", options);
+  constexpr int kNumKeys = 500;
+  for (int i = 0; i < kNumKeys; i++) {
+    engine.Put(std::format("key{:04}", i), "round0");
+  }
+
+  // 读者持续点查，任何时刻每个 key 都必须可见：Flush 和 compaction 切换
+  // memtable 和文件集合时不能出现数据暂时丢失的中间状态
+  std::atomic<bool> stop{false};
+  std::atomic<int> missing{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&, t] {
+      for (int i = t; !stop; i = (i + 7) % kNumKeys) {
+        auto value = engine.Get(std::format("key{:04}", i));
+        if (!value || !value->starts_with("round")) {
+          missing++;
+        }
+      }
+    });
+  }
+  for (int round = 1; round <= 10; round++) {
+    for (int i = 0; i < kNumKeys; i++) {
+      engine.Put(std::format("key{:04}", i), std::format("round{}", round));
+    }
+    engine.Flush();
+  }
+  ASSERT_TRUE(engine.WaitForCompactions().ok());
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(missing, 0);
+  EXPECT_EQ(engine.GetSuperVersion()->imm.size(), 0);
+}
+
+TEST_F(EngineTest, L0NewestFirstLookup) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  LSMEngine engine("test_data", options);
+  engine.Put("a", "old");
+  engine.Put("b", "old");
+  engine.Put("z", "old");
+  engine.Flush();
+  engine.Put("a", "new");
+  engine.Remove("b");
+  engine.Flush();
+  engine.Put("m", "only");
+  engine.Flush();
+  ASSERT_EQ(engine.GetSuperVersion()->current->files(0).size(), 3);
+
+  // 较新的 L0 文件中的值和删除标记遮蔽较旧文件中的同一个 key
+  EXPECT_EQ(engine.Get("a").value_or(""), "new");
+  EXPECT_FALSE(engine.Get("b").has_value());
+  EXPECT_EQ(engine.Get("z").value_or(""), "old");
+  EXPECT_EQ(engine.Get("m").value_or(""), "only");
+  EXPECT_FALSE(engine.Get("n").has_value());
+
+  // key 范围包含 "m" 的只有第三个文件 [m, m] 和第一个文件 [a, z]，第二个
+  // 文件 [a, b] 不会被访问
+  std::vector<size_t> candidates;
+  engine.GetSuperVersion()->current->L0FilesContaining("m", &candidates);
+  EXPECT_EQ(candidates, (std::vector<size_t>{2, 0}));
+}
+
+TEST_F(EngineTest, ScanAndIterator) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  LSMEngine engine("test_data", options);
+  // 数据分布在 L1、L0 和 memtable 中，新的版本和删除标记遮蔽旧的
+  std::map<std::string, std::string> expected;
+  for (int i = 0; i < 100; i++) {
+    auto key = std::format("key{:03}", i);
+    engine.Put(key, "v1");
+    expected[key] = "v1";
+  }
+  engine.Flush();
+  auto version = engine.GetSuperVersion()->current;
+  Compaction to_l1;
+  to_l1.inputs = version->files(0);
+  ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+  for (int i = 0; i < 100; i += 3) {
+    auto key = std::format("key{:03}", i);
+    engine.Put(key, "v2");
+    expected[key] = "v2";
+  }
+  engine.Flush();
+  for (int i = 0; i < 100; i += 5) {
+    auto key = std::format("key{:03}", i);
+    engine.Remove(key);
+    expected.erase(key);
+  }
+  engine.Put("key050", "v3");
+  expected["key050"] = "v3";
+  version = engine.GetSuperVersion()->current;
+  ASSERT_EQ(version->files(0).size(), 1);
+  ASSERT_EQ(version->files(1).size(), 1);
+
+  std::vector<std::pair<std::string, std::string>> result;
+  ASSERT_TRUE(engine.Scan("", "", 1000, &result).ok());
+  EXPECT_EQ(result, (std::vector<std::pair<std::string, std::string>>(
+                        expected.begin(), expected.end())));
+
+  result.clear();
+  ASSERT_TRUE(engine.Scan("key010", "key020", 5, &result).ok());
+  std::vector<std::pair<std::string, std::string>> bounded(
+      expected.lower_bound("key010"), expected.lower_bound("key020"));
+  bounded.resize(5);
+  EXPECT_EQ(result, bounded);
+
+  // 迭代器持有创建时的 memtable 和 Version，之后的 Flush、compaction 以及
+  // 写入新 memtable 的数据都看不到
+  ReadOptions read_options;
+  read_options.lower_bound = "key020";
+  read_options.upper_bound = "key030";
+  auto iter = engine.NewIterator(read_options);
+  engine.Flush();
+  engine.Put("key021", "later");
+  engine.Remove("key022");
+  engine.Flush();
+  Compaction to_l1_again;
+  to_l1_again.inputs = engine.GetSuperVersion()->current->files(0);
+  to_l1_again.output_level_inputs = engine.GetSuperVersion()->current->files(1);
+  ASSERT_TRUE(engine.DoCompaction(to_l1_again).ok());
+  engine.DeleteObsoleteFiles();
+
+  std::vector<std::pair<std::string, std::string>> forward;
+  for (; iter.Valid(); iter.Next()) {
+    forward.emplace_back(iter.key(), iter.value());
+  }
+  std::vector<std::pair<std::string, std::string>> snapshot(
+      expected.lower_bound("key020"), expected.lower_bound("key030"));
+  EXPECT_EQ(forward, snapshot);
+
+  // 反向遍历和 Seek
+  std::vector<std::pair<std::string, std::string>> backward;
+  for (iter.SeekToLast(); iter.Valid(); iter.Prev()) {
+    backward.emplace_back(iter.key(), iter.value());
+  }
+  std::reverse(backward.begin(), backward.end());
+  EXPECT_EQ(backward, snapshot);
+  ASSERT_TRUE(iter.Seek("key025").ok());
+  EXPECT_EQ(iter.key(), "key026");
+  ASSERT_TRUE(iter.SeekForPrev("key025").ok());
+  EXPECT_EQ(iter.key(), "key024");
+  EXPECT_FALSE(iter.Seek("key030").ok());
+
+  // 新的迭代器看到最新的数据
+  auto latest = engine.NewIterator(read_options);
+  ASSERT_TRUE(latest.Seek("key021").ok());
+  EXPECT_EQ(latest.value(), "later");
+  latest.Next();
+  EXPECT_EQ(latest.key(), "key023");
+}
+
+TEST_F(EngineTest, MergeOperator) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  // 没有 MergeOperator 时不能写入操作数
+  {
+    LSMEngine engine("test_data", options);
+    EXPECT_THROW(engine.Merge("a", "1"), std::invalid_argument);
+  }
+  std::filesystem::remove_all("test_data");
+
+  options.merge_operator = std::make_shared<CounterOperator>();
+  {
+    LSMEngine engine("test_data", options);
+    // memtable 中已有值时立即合并
+    engine.Put("a", "10");
+    engine.Merge("a", "1");
+    engine.Merge("a", "2");
+    EXPECT_EQ(engine.Get("a").value(), "13");
+    // 删除之后从空值开始
+    engine.Remove("a");
+    engine.Merge("a", "7");
+    EXPECT_EQ(engine.Get("a").value(), "7");
+
+    // 旧值在 SST 中，操作数在读取时才与它合并
+    engine.Put("b", "100");
+    engine.Flush();
+    engine.Merge("b", "5");
+    engine.Merge("b", "6");
+    EXPECT_EQ(engine.Get("b").value(), "111");
+    // 只有操作数，分布在 memtable 和 SST 中
+    engine.Merge("c", "3");
+    engine.Flush();
+    engine.Merge("c", "4");
+    EXPECT_EQ(engine.Get("c").value(), "7");
+    // 以 0x00 开头的值与操作数的编码不冲突
+    engine.Put("z", std::string("\0raw", 4));
+    EXPECT_EQ(engine.Get("z").value(), std::string("\0raw", 4));
+
+    using KVs = std::vector<std::pair<std::string, std::string>>;
+    KVs expected{{"a", "7"},
+                 {"b", "111"},
+                 {"c", "7"},
+                 {"z", std::string("\0raw", 4)}};
+    KVs result;
+    ASSERT_TRUE(engine.Scan("", "", 10, &result).ok());
+    EXPECT_EQ(result, expected);
+    KVs backward;
+    auto iter = engine.NewIterator();
+    for (iter.SeekToLast(); iter.Valid(); iter.Prev()) {
+      backward.emplace_back(iter.key(), iter.value());
+    }
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(backward, expected);
+
+    // compaction 把操作数与更旧的值合并成一个值
+    engine.Flush();
+    Compaction to_l1;
+    to_l1.inputs = engine.GetSuperVersion()->current->files(0);
+    ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+    engine.DeleteObsoleteFiles();
+    const auto& l1 = engine.GetSuperVersion()->current->files(1);
+    ASSERT_EQ(l1.size(), 1);
+    std::string stored;
+    ASSERT_TRUE(engine.table_cache_->Get(l1[0].sst_id)->Get("b", &stored).ok());
+    EXPECT_EQ(stored, "111");
+    EXPECT_EQ(engine.Get("c").value(), "7");
+
+    // 之后的操作数只在 WAL 中
+    engine.Merge("b", "1000");
+    engine.Merge("d", "1");
+  }
+  LSMEngine engine("test_data", options);
+  EXPECT_EQ(engine.Get("b").value(), "1111");
+  EXPECT_EQ(engine.Get("d").value(), "1");
+  std::vector<std::pair<std::string, std::string>> scanned;
+  ScanOptions scan_options;
+  scan_options.ordered = true;
+  ASSERT_TRUE(engine
+                  .ParallelScan("", "", scan_options,
+                                [&](std::string_view k, std::string_view v) {
+                                  scanned.emplace_back(k, v);
+                                  return true;
+                                })
+                  .ok());
+  EXPECT_EQ(scanned.size(), 5);
+  EXPECT_EQ(scanned[1], std::make_pair(std::string("b"), std::string("1111")));
+}
+
+TEST_F(EngineTest, MergeLargeValue) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  options.merge_operator = std::make_shared<AppendOperator>();
+  std::string expected = "base";
+  {
+    LSMEngine engine("test_data", options);
+    engine.Put("k", "base");
+    engine.Flush();
+    // 每个操作数 8KB，分散在多个 L0 文件中，compaction 合并后超过 64KB
+    for (int i = 0; i < 10; i++) {
+      std::string operand(8192, static_cast<char>('a' + i));
+      engine.Merge("k", operand);
+      expected += operand;
+      engine.Flush();
+    }
+    Compaction to_l1;
+    to_l1.inputs = engine.GetSuperVersion()->current->files(0);
+    ASSERT_TRUE(engine.DoCompaction(to_l1).ok());
+    engine.DeleteObsoleteFiles();
+    const auto& l1 = engine.GetSuperVersion()->current->files(1);
+    ASSERT_EQ(l1.size(), 1);
+    std::string stored;
+    ASSERT_TRUE(engine.table_cache_->Get(l1[0].sst_id)->Get("k", &stored).ok());
+    EXPECT_EQ(stored, expected);
+  }
+  LSMEngine engine("test_data", options);
+  EXPECT_EQ(engine.Get("k").value(), expected);
+}
+
+TEST_F(EngineTest, ConcurrentMergesReplayInOrder) {
+  EngineOptions options;
+  options.compaction.max_background_compactions = 0;
+  options.merge_operator = std::make_shared<AppendOperator>();
+  std::string before;
+  {
+    LSMEngine engine("test_data", options);
+    constexpr int kThreads = 8;
+    constexpr int kPerThread = 200;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kPerThread; i++) {
+          engine.Merge("k", std::string(1, static_cast<char>('a' + t)));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    before = engine.Get("k").value();
+    ASSERT_EQ(before.size(), kThreads * kPerThread);
+  }
+  // 操作数按 WAL 中的顺序写入 memtable，回放得到和重启前相同的结果
+  LSMEngine engine("test_data", options);
+  EXPECT_EQ(engine.Get("k").value(), before);
+}
@@ -0,0 +1,315 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <format>
+#include <map>
+#include <random>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "block/block.h"
+#include "block/block_iterator.h"
+#include "iterator/any_iterator.h"
+#include "iterator/iterator.h"
+#include "iterator/merge_iterator.h"
+#include "iterator/two_merge_iterator.h"
+#include "memtable/memtable.h"
+#include "memtable/memtable_iterator.h"
+
+static_assert(KVIterator<BlockIterator>);
+static_assert(KVIterator<MemTableIterator>);
+static_assert(KVIterator<AnyIterator>);
+static_assert(KVIterator<MergeIterator<BlockIterator>>);
+static_assert(KVIterator<TwoMergeIterator<MemTableIterator, BlockIterator>>);
+
+namespace {
+
+template <KVIterator It>
+std::vector<std::pair<std::string, std::string>> Collect(It& it) {
+  std::vector<std::pair<std::string, std::string>> result;
+  for (; it.Valid(); it.Next()) {
+    result.emplace_back(it.key(), it.value());
+  }
+  return result;
+}
+
+}  // namespace
+
+class IteratorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // 偶数 key 在较旧的 block 中，3 的倍数在较新的 memtable 中
+    block_ = std::make_shared<Block>();
+    for (int i = 0; i < 20; i += 2) {
+      block_->AddEntry(std::format("key{:02}", i), std::format("old{}", i));
+    }
+    for (int i = 0; i < 20; i += 3) {
+      memtable_.Put(std::format("key{:02}", i), std::format("new{}", i));
+    }
+  }
+
+  std::shared_ptr<Block> block_;
+  MemTable memtable_;
+};
+
+TEST_F(IteratorTest, TwoMergeNewerWins) {
+  TwoMergeIterator merged(memtable_.begin(), BlockIterator(block_));
+  auto result = Collect(merged);
+
+  std::vector<std::pair<std::string, std::string>> expected;
+  for (int i = 0; i < 20; i++) {
+    if (i % 3 == 0) {
+      expected.emplace_back(std::format("key{:02}", i), std::format("new{}", i));
+    } else if (i % 2 == 0) {
+      expected.emplace_back(std::format("key{:02}", i), std::format("old{}", i));
+    }
+  }
+  EXPECT_EQ(result, expected);
+}
+
+TEST_F(IteratorTest, TwoMergeSeek) {
+  TwoMergeIterator merged(memtable_.begin(), BlockIterator(block_));
+  EXPECT_TRUE(merged.Seek("key05").ok());
+  EXPECT_EQ(merged.key(), "key06");
+  EXPECT_EQ(merged.value(), "new6");
+  merged.Next();
+  EXPECT_EQ(merged.key(), "key08");
+  EXPECT_TRUE(merged.Seek("key99").IsNotFound());
+  EXPECT_FALSE(merged.Valid());
+
+  merged.SeekToFirst();
+  EXPECT_EQ(merged.key(), "key00");
+  EXPECT_EQ(merged.value(), "new0");
+}
+
+TEST_F(IteratorTest, AnyIterator) {
+  // 模板组合的迭代器和继承 BaseIterator 的迭代器都可以被擦除成同一类型
+  std::vector<AnyIterator> iters;
+  iters.emplace_back(
+      TwoMergeIterator(memtable_.begin(), BlockIterator(block_)));
+  iters.emplace_back(BlockIterator(block_));
+
+  EXPECT_EQ(Collect(iters[0]).size(), 13);
+  EXPECT_EQ(Collect(iters[1]).size(), 10);
+
+  BaseIterator& base = iters[1];
+  EXPECT_TRUE(base.Seek("key03").ok());
+  EXPECT_EQ(base.key(), "key04");
+  EXPECT_EQ(base.value(), "old4");
+
+  AnyIterator empty;
+  EXPECT_FALSE(empty.Valid());
+  EXPECT_TRUE(empty.Seek("key").IsNotFound());
+}
+
+TEST_F(IteratorTest, TwoMergeReverse) {
+  TwoMergeIterator merged(memtable_.begin(), BlockIterator(block_));
+  auto forward = Collect(merged);
+
+  std::vector<std::pair<std::string, std::string>> backward;
+  for (merged.SeekToLast(); merged.Valid(); merged.Prev()) {
+    backward.emplace_back(merged.key(), merged.value());
+  }
+  std::reverse(backward.begin(), backward.end());
+  EXPECT_EQ(forward, backward);
+
+  // 切换方向
+  EXPECT_TRUE(merged.Seek("key06").ok());
+  merged.Prev();
+  EXPECT_EQ(merged.key(), "key04");
+  merged.Next();
+  EXPECT_EQ(merged.key(), "key06");
+  EXPECT_EQ(merged.value(), "new6");
+  EXPECT_TRUE(merged.SeekForPrev("key07").ok());
+  EXPECT_EQ(merged.key(), "key06");
+  EXPECT_EQ(merged.value(), "new6");
+}
+
+TEST(MergeIteratorTest, NewestWins) {
+  // 第 i 个 block 包含所有 i 的倍数，value 记录来源，下标小的更新
+  std::vector<BlockIterator> children;
+  for (int i = 1; i <= 5; i++) {
+    auto block = std::make_shared<Block>();
+    for (int k = 0; k < 30; k += i) {
+      block->AddEntry(std::format("key{:02}", k), std::format("src{}", i));
+    }
+    children.emplace_back(block);
+  }
+  MergeIterator merged(std::move(children));
+
+  auto result = Collect(merged);
+  ASSERT_EQ(result.size(), 30);
+  for (int k = 0; k < 30; k++) {
+    EXPECT_EQ(result[k].first, std::format("key{:02}", k));
+    // key 只在 block 1 中出现，其余 block 的旧版本被跳过
+    EXPECT_EQ(result[k].second, "src1");
+  }
+
+  EXPECT_TRUE(merged.Seek("key07").ok());
+  EXPECT_EQ(merged.key(), "key07");
+  EXPECT_TRUE(merged.Seek("key99").IsNotFound());
+  merged.SeekToFirst();
+  EXPECT_EQ(merged.key(), "key00");
+}
+
+TEST(MergeIteratorTest, VisitVersions) {
+  // 第 i 个 block 包含所有 i 的倍数，前三个归并后再与第四个归并
+  auto make_block = [](int i) {
+    auto block = std::make_shared<Block>();
+    for (int k = 0; k < 30; k += i) {
+      block->AddEntry(std::format("key{:02}", k), std::format("src{}", i));
+    }
+    return block;
+  };
+  std::vector<BlockIterator> children;
+  for (int i = 1; i <= 3; i++) {
+    children.emplace_back(make_block(i));
+  }
+  TwoMergeIterator merged(MergeIterator(std::move(children)),
+                          BlockIterator(make_block(4)));
+
+  auto versions_of = [&](int k) {
+    std::vector<std::string> expected;
+    for (int i = 1; i <= 4; i++) {
+      if (k % i == 0) {
+        expected.push_back(std::format("src{}", i));
+      }
+    }
+    return expected;
+  };
+  auto visit_all = [&] {
+    std::vector<std::string> versions;
+    EXPECT_TRUE(VisitVersions(merged, [&](std::string_view value) {
+      versions.emplace_back(value);
+      return true;
+    }));
+    return versions;
+  };
+
+  // 正向和反向遍历时当前 key 的所有版本都可以从新到旧访问到
+  for (int k = 0; merged.Valid(); merged.Next(), k++) {
+    ASSERT_EQ(merged.key(), std::format("key{:02}", k));
+    EXPECT_EQ(visit_all(), versions_of(k));
+  }
+  for (int k = 29; k >= 0; k--) {
+    if (k == 29) {
+      merged.SeekToLast();
+    } else {
+      merged.Prev();
+    }
+    ASSERT_EQ(merged.key(), std::format("key{:02}", k));
+    EXPECT_EQ(visit_all(), versions_of(k));
+  }
+
+  // visit 返回 false 时停止
+  ASSERT_TRUE(merged.Seek("key12").ok());
+  int visited = 0;
+  EXPECT_FALSE(VisitVersions(merged, [&](std::string_view) {
+    return ++visited < 2;
+  }));
+  EXPECT_EQ(visited, 2);
+}
+
+TEST(MergeIteratorTest, Empty) {
+  MergeIterator<BlockIterator> none;
+  EXPECT_FALSE(none.Valid());
+  EXPECT_TRUE(none.Seek("a").IsNotFound());
+
+  MergeIterator<BlockIterator> single({BlockIterator(std::make_shared<Block>())});
+  EXPECT_FALSE(single.Valid());
+}
+
+TEST(MergeIteratorTest, RandomAgainstMap) {
+  std::mt19937 rng(42);
+  for (int n : {1, 2, 3, 7, 16, 33}) {
+    std::map<std::string, std::string> expected;
+    std::vector<std::map<std::string, std::string>> sources(n);
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < 20; j++) {
+        sources[i][std::format("key{:03}", rng() % 200)] =
+            std::format("v{}", i);
+      }
+    }
+    // 从旧到新覆盖，得到期望结果
+    for (int i = n - 1; i >= 0; i--) {
+      for (const auto& [k, v] : sources[i]) {
+        expected[k] = v;
+      }
+    }
+
+    std::vector<BlockIterator> children;
+    for (const auto& source : sources) {
+      auto block = std::make_shared<Block>();
+      for (const auto& [k, v] : source) {
+        block->AddEntry(k, v);
+      }
+      children.emplace_back(block);
+    }
+    MergeIterator merged(std::move(children));
+
+    auto result = Collect(merged);
+    std::vector<std::pair<std::string, std::string>> want(expected.begin(),
+                                                          expected.end());
+    EXPECT_EQ(result, want) << "n = " << n;
+  }
+}
+
+TEST(MergeIteratorTest, RandomBidirectional) {
+  std::mt19937 rng(7);
+  for (int n : {1, 2, 5, 16}) {
+    std::map<std::string, std::string> expected;
+    std::vector<std::map<std::string, std::string>> sources(n);
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < 30; j++) {
+        sources[i][std::format("key{:03}", rng() % 100)] =
+            std::format("v{}", i);
+      }
+    }
+    for (int i = n - 1; i >= 0; i--) {
+      for (const auto& [k, v] : sources[i]) {
+        expected[k] = v;
+      }
+    }
+
+    std::vector<BlockIterator> children;
+    for (const auto& source : sources) {
+      auto block = std::make_shared<Block>();
+      for (const auto& [k, v] : source) {
+        block->AddEntry(k, v);
+      }
+      children.emplace_back(block);
+    }
+    MergeIterator merged(std::move(children));
+
+    // 随机地前后移动，与 std::map 的迭代器对照
+    auto want = expected.begin();
+    merged.SeekToFirst();
+    for (int step = 0; step < 500; step++) {
+      ASSERT_EQ(merged.Valid(), want != expected.end()) << "n = " << n;
+      if (!merged.Valid()) {
+        merged.SeekToFirst();
+        want = expected.begin();
+        continue;
+      }
+      ASSERT_EQ(merged.key(), want->first);
+      ASSERT_EQ(merged.value(), want->second);
+      if (rng() % 2 == 0 || want == expected.begin()) {
+        merged.Next();
+        ++want;
+      } else {
+        merged.Prev();
+        --want;
+      }
+    }
+
+    std::vector<std::pair<std::string, std::string>> backward;
+    for (merged.SeekToLast(); merged.Valid(); merged.Prev()) {
+      backward.emplace_back(merged.key(), merged.value());
+    }
+    std::vector<std::pair<std::string, std::string>> reversed(
+        expected.rbegin(), expected.rend());
+    EXPECT_EQ(backward, reversed) << "n = " << n;
+  }
+}
@@ -1,10 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <format>
 #include <string>
 #include <thread>
 #include <vector>
 
-#include "memtable/iterator.h"
+#include "memtable/memtable_iterator.h"
 #include "memtable/memtable.h"
 
 TEST(MemTableTest, BasicOperations) {
@@ -91,6 +93,86 @@ TEST(MemTableTest, MultipleFrozenTables) {
   EXPECT_EQ(table.Get("key3"), "value3");
 }
 
+TEST(MemTableTest, MultiGet) {
+  MemTable table;
+
+  table.Put("key1", "value1");
+  table.Put("key2", "value2");
+  table.FrozenCurrentTable();
+
+  table.Put("key2", "new_value2");
+  table.Remove("key1");
+  table.Put("key3", "value3");
+
+  std::vector<std::string> keys = {"key1", "key2", "key3", "key4"};
+  auto results = table.MultiGet(keys);
+  ASSERT_EQ(results.size(), keys.size());
+  EXPECT_FALSE(results[0].has_value());
+  EXPECT_EQ(results[1].value(), "new_value2");
+  EXPECT_EQ(results[2].value(), "value3");
+  EXPECT_FALSE(results[3].has_value());
+}
+
+TEST(MemTableTest, IteratorSeek) {
+  MemTable table;
+  table.Put("key1", "value1");
+  table.Put("key3", "value3");
+  table.FrozenCurrentTable();
+  table.Put("key5", "value5");
+  table.Remove("key3");
+
+  auto it = table.begin();
+  it.Seek("key2");
+  EXPECT_EQ((*it).first, "key5");
+  it.Seek("key1");
+  EXPECT_EQ((*it).first, "key1");
+  it.Seek("key6");
+  EXPECT_TRUE(it.IsEnd());
+
+  it.SeekForPrev("key4");
+  EXPECT_EQ((*it).first, "key1");
+  it.SeekForPrev("key0");
+  EXPECT_TRUE(it.IsEnd());
+}
+
+TEST(MemTableTest, IteratorReverse) {
+  MemTable table;
+  table.Put("key1", "value1");
+  table.Put("key2", "value2");
+  table.Put("key3", "value3");
+  table.Remove("key2");
+
+  auto it = table.begin();
+  it.SeekToLast();
+  EXPECT_EQ(it.key(), "key3");
+  it.Prev();
+  // 删除的 key 在反向遍历时同样被跳过
+  EXPECT_EQ(it.key(), "key1");
+  it.Prev();
+  EXPECT_FALSE(it.Valid());
+}
+
+TEST(MemTableTest, IteratorBounds) {
+  MemTable table;
+  for (int i = 0; i < 10; i++) {
+    table.Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+  table.FrozenCurrentTable();
+  table.Put("key3", "new_value3");
+
+  ReadOptions options;
+  options.lower_bound = "key3";
+  options.upper_bound = "key6";
+  auto it = table.NewIterator(options);
+  std::vector<std::pair<std::string, std::string>> result;
+  for (; it.Valid(); it.Next()) {
+    result.emplace_back(it.key(), it.value());
+  }
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"key3", "new_value3"}, {"key4", "value4"}, {"key5", "value5"}};
+  EXPECT_EQ(result, expected);
+}
+
 TEST(MemTableTest, IteratorComplexOperations) {
   MemTable table;
 
@@ -147,6 +229,39 @@ TEST(MemTableTest, IteratorComplexOperations) {
   EXPECT_FALSE(table.Get("key3").has_value());
 }
 
+TEST(MemTableTest, IteratorConcurrentWrites) {
+  MemTable table;
+  for (int i = 0; i < 1000; i += 2) {
+    table.Put(std::format("key{:04}", i), "v1");
+  }
+
+  // 覆盖写换成新节点，迭代器持有的旧节点不变
+  auto it = table.begin();
+  ASSERT_TRUE(it.Valid());
+  std::string_view value = it.value();
+  table.Put("key0000", "v2");
+  EXPECT_EQ(value, "v1");
+  EXPECT_EQ(table.Get("key0000").value(), "v2");
+
+  // 遍历期间并发写入：已有的 key 都能遍历到且保持有序
+  std::thread writer([&] {
+    for (int i = 0; i < 1000; i++) {
+      table.Put(std::format("key{:04}", i), "v3");
+    }
+  });
+  std::vector<std::string> keys;
+  for (it.SeekToFirst(); it.Valid(); it.Next()) {
+    keys.emplace_back(it.key());
+  }
+  writer.join();
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  EXPECT_EQ(std::adjacent_find(keys.begin(), keys.end()), keys.end());
+  for (int i = 0; i < 1000; i += 2) {
+    EXPECT_TRUE(std::binary_search(keys.begin(), keys.end(),
+                                   std::format("key{:04}", i)));
+  }
+}
+
 TEST(MemTableTest, ConcurrentOperations) {
   MemTable table;
   const int num_readers = 4;
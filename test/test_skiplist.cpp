@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <format>
 #include <latch>
 #include <string>
 #include <unordered_set>
@@ -77,6 +78,92 @@ TEST(SkipListTest, LargeScaleRemove) {
   }
 }
 
+TEST(SkipListTest, MultiGet) {
+  SkipList s(16);
+  const int n = 1000;
+  for (int i = 0; i < n; i += 2) {
+    s.Put("key" + std::to_string(i), "value" + std::to_string(i));
+  }
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back("key" + std::to_string(i));
+  }
+
+  for (size_t group_size : {1, 4, 16}) {
+    auto results = s.MultiGet(keys, group_size);
+    ASSERT_EQ(results.size(), keys.size());
+    for (int i = 0; i < n; i++) {
+      if (i % 2 == 0) {
+        EXPECT_EQ(results[i].value(), "value" + std::to_string(i));
+      } else {
+        EXPECT_FALSE(results[i].has_value());
+      }
+    }
+  }
+
+  // 只查找部分下标
+  std::vector<size_t> indices{3, 0, 998, 999};
+  auto subset = s.MultiGet(keys, indices);
+  ASSERT_EQ(subset.size(), indices.size());
+  EXPECT_FALSE(subset[0].has_value());
+  EXPECT_EQ(subset[1].value(), "value0");
+  EXPECT_EQ(subset[2].value(), "value998");
+  EXPECT_FALSE(subset[3].has_value());
+
+  EXPECT_TRUE(s.MultiGet({}).empty());
+}
+
+TEST(SkipListTest, Seek) {
+  SkipList s(16);
+  s.Put("key1", "value1");
+  s.Put("key3", "value3");
+  s.Put("key5", "value5");
+
+  EXPECT_EQ(s.Seek("key3").key(), "key3");
+  EXPECT_EQ(s.Seek("key2").key(), "key3");
+  EXPECT_EQ(s.Seek("a").key(), "key1");
+  EXPECT_EQ(s.Seek("key6"), s.end());
+
+  EXPECT_EQ(s.SeekForPrev("key3").key(), "key3");
+  EXPECT_EQ(s.SeekForPrev("key4").key(), "key3");
+  EXPECT_EQ(s.SeekForPrev("z").key(), "key5");
+  EXPECT_EQ(s.SeekForPrev("a"), s.end());
+}
+
+TEST(SkipListTest, ReverseIteration) {
+  SkipList s(16);
+  for (int i = 0; i < 100; i++) {
+    s.Put(std::format("key{:03}", i), std::format("value{}", i));
+  }
+  // 删除会修正后继节点的 backward 指针
+  for (int i = 0; i < 100; i += 3) {
+    s.Remove(std::format("key{:03}", i));
+  }
+
+  std::vector<std::string> forward;
+  for (auto it = s.begin(); it != s.end(); ++it) {
+    forward.emplace_back(it.key());
+  }
+  std::vector<std::string> backward;
+  for (auto it = s.SeekToLast(); it != s.end(); --it) {
+    backward.emplace_back(it.key());
+  }
+  std::reverse(backward.begin(), backward.end());
+  EXPECT_EQ(forward, backward);
+  EXPECT_EQ(forward.size(), 66);
+
+  auto it = s.SeekForPrev("key050");
+  EXPECT_EQ(it.key(), "key050");
+  --it;
+  EXPECT_EQ(it.key(), "key049");
+  --it;
+  EXPECT_EQ(it.key(), "key047");
+
+  SkipList empty(16);
+  EXPECT_EQ(empty.SeekToLast(), empty.end());
+}
+
 TEST(SkipListTest, DuplicateInsert) {
   SkipList s(16);
   s.Put("key1", "value1");
@@ -4,7 +4,12 @@
 #include <string>
 #include <format>
 
+#include "sst/block_prefetcher.h"
+#include "sst/l0_iterator.h"
+#include "sst/level_iterator.h"
 #include "sst/sst.h"
+#include "sst/sst_iterator.h"
+#include "utils/value_encoding.h"
 
 class SSTTest : public ::testing::Test {
  protected:
@@ -38,7 +43,7 @@ TEST_F(SSTTest, BasicReadAndWrite) {
   EXPECT_EQ(sst.first_key(), "key1");
   EXPECT_EQ(sst.last_key(), "key3");
   EXPECT_EQ(sst.sst_id(), 1);
-  EXPECT_EQ(sst.sst_size(), 82);
+  EXPECT_EQ(sst.sst_size(), 196);
 
   auto block = sst.ReadBlock(0);
   EXPECT_TRUE(block != nullptr);
@@ -73,7 +78,82 @@ TEST_F(SSTTest, KeySearch) {
   EXPECT_TRUE(value.has_value());
   EXPECT_EQ(*value, "value50");
 
-  EXPECT_THROW(sst.FindBlockIdx("key9999"), std::runtime_error);
+  EXPECT_EQ(sst.FindBlockIdx("key9999"), sst.num_blocks());
+  EXPECT_EQ(sst.FindBlockIdx("a"), 0);
+}
+
+TEST_F(SSTTest, IteratorSeek) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 100; i += 2) {
+    builder.Add(std::format("key{:04}", i), "value" + std::to_string(i));
+  }
+  auto sst = std::make_shared<SST>(builder.Build(1, "test_data/seek.sst"));
+
+  SstIterator it(sst);
+  EXPECT_TRUE(it.Seek("key0050").ok());
+  EXPECT_EQ(it.key(), "key0050");
+  // 落在两个 key 之间，定位到后一个
+  EXPECT_TRUE(it.Seek("key0051").ok());
+  EXPECT_EQ(it.key(), "key0052");
+  EXPECT_TRUE(it.Seek("a").ok());
+  EXPECT_EQ(it.key(), "key0000");
+  EXPECT_TRUE(it.Seek("key9999").IsNotFound());
+  EXPECT_TRUE(it.IsEnd());
+
+  EXPECT_TRUE(it.SeekForPrev("key0051").ok());
+  EXPECT_EQ(it.key(), "key0050");
+  EXPECT_TRUE(it.SeekForPrev("key9999").ok());
+  EXPECT_EQ(it.key(), "key0098");
+  EXPECT_TRUE(it.SeekForPrev("a").IsNotFound());
+
+  // Seek 之后可以继续顺序遍历，跨越 block 边界
+  int count = 0;
+  for (auto iter = sst->Iterator("key0031"); iter != sst->end(); ++iter) {
+    EXPECT_EQ(iter.key(), std::format("key{:04}", 32 + count * 2));
+    count++;
+  }
+  EXPECT_EQ(count, 34);
+}
+
+TEST_F(SSTTest, IteratorProtocol) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 100; i++) {
+    builder.Add(std::format("key{:04}", i), std::format("value{:04}", i));
+  }
+  auto sst = std::make_shared<SST>(builder.Build(1, "test_data/proto.sst"));
+
+  // 通过基类接口遍历，key()/value() 不拷贝
+  SstIterator sst_it(sst);
+  BaseIterator& it = sst_it;
+  int count = 0;
+  for (it.SeekToFirst(); it.Valid(); it.Next()) {
+    EXPECT_EQ(it.key(), std::format("key{:04}", count));
+    EXPECT_EQ(it.value(), std::format("value{:04}", count));
+    count++;
+  }
+  EXPECT_EQ(count, 100);
+  EXPECT_THROW(it.key(), std::runtime_error);
+
+  // 后置 ++ 返回的副本不受原迭代器后续移动的影响
+  SstIterator a(sst, "key0015");
+  auto b = a++;
+  EXPECT_EQ(b.key(), "key0015");
+  EXPECT_EQ(a.key(), "key0016");
+}
+
+TEST_F(SSTTest, GetStatus) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 100; i += 2) {
+    builder.Add(std::format("key{:04}", i), "value" + std::to_string(i));
+  }
+  auto sst = builder.Build(1, "test_data/status.sst");
+
+  std::string value;
+  EXPECT_TRUE(sst.Get("key0050", &value).ok());
+  EXPECT_EQ(value, "value50");
+  EXPECT_TRUE(sst.Get("key0051", &value).IsNotFound());
+  EXPECT_TRUE(sst.Get("a", &value).IsNotFound());
+  EXPECT_TRUE(sst.Get("key9999", &value).IsNotFound());
 }
 
 TEST_F(SSTTest, MetaData) {
@@ -102,6 +182,117 @@ TEST_F(SSTTest, ReopenSST) {
   EXPECT_EQ(sst.num_blocks(), reopen_sst.num_blocks());
 }
 
+TEST_F(SSTTest, TableProperties) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 20; i++) {
+    auto key = std::format("key{:04}", i);
+    builder.Add(key, i % 5 == 0 ? "" : "value", 100 + i);
+  }
+  auto sst = builder.Build(1, "test_data/props.sst");
+
+  const auto& props = sst.properties();
+  EXPECT_EQ(props.num_entries, 20);
+  EXPECT_EQ(props.num_deletions, 4);
+  EXPECT_EQ(props.raw_key_size, 20 * 7);
+  EXPECT_EQ(props.raw_value_size, 16 * 5);
+  EXPECT_EQ(props.min_seq, 100);
+  EXPECT_EQ(props.max_seq, 119);
+  EXPECT_EQ(props.filter_size, 0);
+  EXPECT_GT(props.data_size, 0);
+  EXPECT_GT(props.creation_time, 0);
+  EXPECT_GT(props.compression_ratio(), 0.0);
+
+  auto reopen_sst = SST::Open(1, File::Open("test_data/props.sst"));
+  EXPECT_EQ(reopen_sst.properties(), props);
+  EXPECT_EQ(reopen_sst.num_blocks(), sst.num_blocks());
+}
+
+TEST_F(SSTTest, FormatVersions) {
+  for (uint32_t version : {kFormatV1, kFormatV2, kFormatV3}) {
+    SSTBuilder builder(256, version);
+    for (int i = 0; i < 100; i++) {
+      builder.Add(std::format("key{:04}", i), "value" + std::to_string(i));
+    }
+    auto path = std::format("test_data/v{}.sst", version);
+    auto sst = builder.Build(1, path);
+    EXPECT_EQ(sst.format_version(), version);
+
+    auto reopen_sst = SST::Open(1, File::Open(path));
+    EXPECT_EQ(reopen_sst.format_version(), version);
+    EXPECT_EQ(reopen_sst.num_blocks(), sst.num_blocks());
+    EXPECT_EQ(reopen_sst.first_key(), "key0000");
+    EXPECT_EQ(reopen_sst.last_key(), "key0099");
+    EXPECT_EQ(reopen_sst.properties().num_entries, 100);
+
+    for (size_t i = 0; i < reopen_sst.num_blocks(); i++) {
+      EXPECT_FALSE(reopen_sst.ReadBlock(i)->IsEmpty());
+    }
+  }
+}
+
+TEST_F(SSTTest, LegacyValues) {
+  using namespace std::string_literals;
+  // v3 之前的文件保存原始的值，以 0x00 开头的值读出时转义，不会被当成
+  // Merge 操作数
+  std::vector<std::pair<std::string, std::string>> kvs = {
+      {"a", "\0\x02operand"s}, {"b", "\0\x01x"s}, {"c", "\0"s},
+      {"d", ""}, {"e", "plain"}};
+  for (uint32_t version : {kFormatV1, kFormatV2, kFormatV3}) {
+    SSTBuilder builder(256, version);
+    for (const auto& [key, value] : kvs) {
+      builder.Add(key, value);
+    }
+    auto path = std::format("test_data/values_v{}.sst", version);
+    builder.Build(1, path);
+    auto sst = std::make_shared<SST>(SST::Open(1, File::Open(path)));
+    EXPECT_EQ(sst->values_encoded(), version >= kFormatV3);
+
+    std::vector<std::string> expected;
+    for (const auto& [key, value] : kvs) {
+      expected.push_back(version >= kFormatV3 ? value : EncodeValue(value));
+    }
+    std::vector<std::string> got;
+    for (SstIterator it(sst); it.Valid(); it.Next()) {
+      got.emplace_back(it.value());
+    }
+    EXPECT_EQ(got, expected);
+
+    for (size_t i = 0; i < kvs.size(); i++) {
+      std::string value;
+      ASSERT_TRUE(sst->Get(kvs[i].first, &value).ok());
+      EXPECT_EQ(value, expected[i]);
+      if (version < kFormatV3) {
+        std::string_view payload;
+        EXPECT_EQ(DecodeValue(value, &payload),
+                  kvs[i].second.empty() ? ValueType::kDeletion
+                                        : ValueType::kValue);
+        EXPECT_EQ(payload, kvs[i].second);
+      }
+    }
+  }
+}
+
+TEST_F(SSTTest, LargeBlock) {
+  // 单个 block 超过 64KB，只有 v2 格式能表示
+  SSTBuilder builder(1 << 20);
+  for (int i = 0; i < 1000; i++) {
+    builder.Add(std::format("key{:04}", i), std::string(100, 'v'));
+  }
+  auto sst = builder.Build(1, "test_data/large_block.sst");
+  EXPECT_EQ(sst.num_blocks(), 1);
+
+  auto reopen_sst = SST::Open(1, File::Open("test_data/large_block.sst"));
+  auto block = reopen_sst.ReadBlock(0);
+  EXPECT_EQ(block->GetFirstKey(), "key0000");
+
+  SSTBuilder v1_builder(1 << 20, kFormatV1);
+  for (int i = 0; i < 1000; i++) {
+    v1_builder.Add(std::format("key{:04}", i), std::string(100, 'v'));
+  }
+  EXPECT_THROW(v1_builder.Build(2, "test_data/large_block_v1.sst"),
+               std::runtime_error);
+}
+
 TEST_F(SSTTest, LargeTest) {
   SSTBuilder builder(4096);
 
@@ -126,4 +317,266 @@ TEST_F(SSTTest, LargeTest) {
     EXPECT_TRUE(value.has_value());
     EXPECT_EQ(*value, std::string(100, 'v') + std::to_string(i));
   }
-}
\ No newline at end of file
+}
+TEST_F(SSTTest, L0Iterator) {
+  // 三个 key 范围重叠的 SST，id 越大越新
+  std::vector<std::shared_ptr<SST>> ssts;
+  for (int id = 0; id < 3; id++) {
+    SSTBuilder builder(64);
+    for (int i = id * 10; i < id * 10 + 30; i++) {
+      builder.Add(std::format("key{:04}", i), std::format("sst{}", id));
+    }
+    ssts.push_back(std::make_shared<SST>(
+        builder.Build(id, std::format("test_data/l0_{}.sst", id))));
+  }
+
+  std::vector<SstIterator> children;
+  for (auto it = ssts.rbegin(); it != ssts.rend(); ++it) {
+    children.emplace_back(*it);
+  }
+  L0Iterator iter(std::move(children));
+
+  int count = 0;
+  for (; iter.Valid(); iter.Next()) {
+    EXPECT_EQ(iter.key(), std::format("key{:04}", count));
+    int newest = std::min(count / 10, 2);
+    EXPECT_EQ(iter.value(), std::format("sst{}", newest));
+    count++;
+  }
+  EXPECT_EQ(count, 50);
+}
+
+TEST_F(SSTTest, LevelIterator) {
+  // 10 个互不重叠的 SST，每个 10 个 key
+  std::vector<LevelFileMeta> files;
+  for (int id = 0; id < 10; id++) {
+    SSTBuilder builder(64);
+    for (int i = id * 10; i < id * 10 + 10; i++) {
+      builder.Add(std::format("key{:04}", i * 2), std::format("value{}", i));
+    }
+    auto sst = builder.Build(id, std::format("test_data/level_{}.sst", id));
+    files.push_back(LevelFileMeta::FromSst(sst));
+  }
+
+  std::vector<size_t> opened;
+  auto opener = [&](size_t sst_id) {
+    opened.push_back(sst_id);
+    auto path = std::format("test_data/level_{}.sst", sst_id);
+    return std::make_shared<SST>(SST::Open(sst_id, File::Open(path)));
+  };
+
+  LevelIterator iter(files, opener);
+  // 构造时只打开第一个文件
+  EXPECT_EQ(opened, std::vector<size_t>{0});
+
+  int count = 0;
+  for (; iter.Valid(); iter.Next()) {
+    EXPECT_EQ(iter.key(), std::format("key{:04}", count * 2));
+    EXPECT_EQ(iter.value(), std::format("value{}", count));
+    count++;
+  }
+  EXPECT_EQ(count, 100);
+  EXPECT_EQ(opened.size(), 10);
+
+  // Seek 二分定位到目标文件，只打开这一个文件
+  opened.clear();
+  EXPECT_TRUE(iter.Seek("key0101").ok());
+  EXPECT_EQ(iter.key(), "key0102");
+  EXPECT_EQ(opened, std::vector<size_t>{5});
+  // 落在两个文件之间的 key 定位到后一个文件的第一条记录
+  EXPECT_TRUE(iter.Seek("key0039").ok());
+  EXPECT_EQ(iter.key(), "key0040");
+  EXPECT_EQ(iter.file_idx(), 2);
+  EXPECT_TRUE(iter.Seek("key9999").IsNotFound());
+  EXPECT_FALSE(iter.Valid());
+
+  EXPECT_TRUE(iter.SeekForPrev("key0039").ok());
+  EXPECT_EQ(iter.key(), "key0038");
+  EXPECT_TRUE(iter.SeekForPrev("a").IsNotFound());
+
+  LevelIterator empty({}, opener);
+  EXPECT_FALSE(empty.Valid());
+}
+
+TEST_F(SSTTest, ReverseIteration) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 100; i++) {
+    builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+  }
+  auto sst = std::make_shared<SST>(builder.Build(1, "test_data/reverse.sst"));
+  ASSERT_GT(sst->num_blocks(), 1);
+
+  // 反向遍历跨越 block 边界
+  SstIterator it(sst);
+  int i = 99;
+  for (it.SeekToLast(); it.Valid(); it.Prev()) {
+    EXPECT_EQ(it.key(), std::format("key{:04}", i));
+    i--;
+  }
+  EXPECT_EQ(i, -1);
+
+  // 正反方向交替
+  EXPECT_TRUE(it.Seek("key0050").ok());
+  it.Prev();
+  EXPECT_EQ(it.key(), "key0049");
+  it.Next();
+  it.Next();
+  EXPECT_EQ(it.key(), "key0051");
+}
+
+TEST_F(SSTTest, LevelIteratorReverse) {
+  std::vector<std::shared_ptr<SST>> ssts;
+  std::vector<LevelFileMeta> files;
+  for (int id = 0; id < 5; id++) {
+    SSTBuilder builder(64);
+    for (int i = id * 10; i < id * 10 + 10; i++) {
+      builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+    }
+    ssts.push_back(std::make_shared<SST>(
+        builder.Build(id, std::format("test_data/rlevel_{}.sst", id))));
+    files.push_back(LevelFileMeta::FromSst(*ssts.back()));
+  }
+
+  LevelIterator iter(files, [&](size_t id) { return ssts[id]; });
+  int i = 49;
+  for (iter.SeekToLast(); iter.Valid(); iter.Prev()) {
+    EXPECT_EQ(iter.key(), std::format("key{:04}", i));
+    i--;
+  }
+  EXPECT_EQ(i, -1);
+
+  EXPECT_TRUE(iter.SeekForPrev("key0030").ok());
+  iter.Prev();
+  EXPECT_EQ(iter.key(), "key0029");
+  EXPECT_EQ(iter.file_idx(), 2);
+}
+
+TEST_F(SSTTest, IteratorBounds) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 100; i++) {
+    builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+  }
+  auto sst = std::make_shared<SST>(builder.Build(1, "test_data/bounds.sst"));
+
+  ReadOptions options;
+  options.lower_bound = "key0020";
+  options.upper_bound = "key0030";
+
+  SstIterator it(sst, options);
+  std::vector<std::string> keys;
+  for (; it.Valid(); it.Next()) {
+    keys.emplace_back(it.key());
+  }
+  ASSERT_EQ(keys.size(), 10);
+  EXPECT_EQ(keys.front(), "key0020");
+  EXPECT_EQ(keys.back(), "key0029");
+
+  // 反向遍历同样止于下界
+  int count = 0;
+  for (it.SeekToLast(); it.Valid(); it.Prev()) {
+    EXPECT_EQ(it.key(), std::format("key{:04}", 29 - count));
+    count++;
+  }
+  EXPECT_EQ(count, 10);
+
+  // Seek 的目标会被限制在范围内
+  EXPECT_TRUE(it.Seek("a").ok());
+  EXPECT_EQ(it.key(), "key0020");
+  EXPECT_TRUE(it.Seek("key0030").IsNotFound());
+  EXPECT_TRUE(it.SeekForPrev("z").ok());
+  EXPECT_EQ(it.key(), "key0029");
+  EXPECT_TRUE(it.SeekForPrev("key0019").IsNotFound());
+}
+
+TEST_F(SSTTest, LevelIteratorBounds) {
+  std::vector<LevelFileMeta> files;
+  for (int id = 0; id < 10; id++) {
+    SSTBuilder builder(64);
+    for (int i = id * 10; i < id * 10 + 10; i++) {
+      builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+    }
+    auto sst = builder.Build(id, std::format("test_data/blevel_{}.sst", id));
+    files.push_back(LevelFileMeta::FromSst(sst));
+  }
+
+  std::vector<size_t> opened;
+  auto opener = [&](size_t sst_id) {
+    opened.push_back(sst_id);
+    auto path = std::format("test_data/blevel_{}.sst", sst_id);
+    return std::make_shared<SST>(SST::Open(sst_id, File::Open(path)));
+  };
+
+  ReadOptions options;
+  options.lower_bound = "key0035";
+  options.upper_bound = "key0050";
+  LevelIterator iter(files, opener, options);
+  int count = 0;
+  for (; iter.Valid(); iter.Next()) {
+    EXPECT_EQ(iter.key(), std::format("key{:04}", 35 + count));
+    count++;
+  }
+  EXPECT_EQ(count, 15);
+  // 上界之后的文件 5 不会被打开
+  EXPECT_EQ(opened, (std::vector<size_t>{3, 4}));
+
+  opened.clear();
+  count = 0;
+  for (iter.SeekToLast(); iter.Valid(); iter.Prev()) {
+    count++;
+  }
+  EXPECT_EQ(count, 15);
+  EXPECT_EQ(opened, (std::vector<size_t>{4, 3}));
+}
+
+TEST_F(SSTTest, IteratorReadahead) {
+  SSTBuilder builder(64);
+  for (int i = 0; i < 500; i++) {
+    builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+  }
+  auto sst = std::make_shared<SST>(builder.Build(1, "test_data/ahead.sst"));
+  sst->SetAccessHint(AccessHint::kSequential);
+
+  // 预读只是提示，开启与关闭时遍历结果相同
+  for (size_t max_blocks : {0, 1, 4, 64}) {
+    ReadOptions options;
+    options.max_readahead_blocks = max_blocks;
+    options.upper_bound = "key0400";
+    SstIterator it(sst, options);
+    int count = 0;
+    for (; it.Valid(); it.Next()) {
+      EXPECT_EQ(it.key(), std::format("key{:04}", count));
+      count++;
+    }
+    EXPECT_EQ(count, 400);
+  }
+}
+
+TEST_F(SSTTest, BlockCacheAndPrefetcher) {
+  auto cache = std::make_shared<BlockCache>(1 << 20);
+  SSTBuilder builder(64);
+  for (int i = 0; i < 300; i++) {
+    builder.Add(std::format("key{:04}", i), std::format("value{}", i));
+  }
+  auto sst =
+      std::make_shared<SST>(builder.Build(1, "test_data/cache.sst", cache));
+
+  // 第二次读取同一个 block 命中缓存
+  auto block = sst->ReadBlock(3);
+  EXPECT_EQ(sst->ReadBlock(3), block);
+  EXPECT_EQ(cache->hits(), 1);
+
+  ReadOptions options;
+  options.prefetcher = std::make_shared<BlockPrefetcher>(2);
+  options.prefetch_blocks = 4;
+  SstIterator it(sst, options);
+  int count = 0;
+  for (; it.Valid(); it.Next()) {
+    EXPECT_EQ(it.key(), std::format("key{:04}", count));
+    count++;
+  }
+  EXPECT_EQ(count, 300);
+  // 扫描结束后所有 block 都已在缓存中
+  for (size_t i = 0; i < sst->num_blocks(); i++) {
+    EXPECT_NE(cache->Lookup(1, i), nullptr);
+  }
+}
@@ -1,9 +1,18 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <future>
 #include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include "utils/file.h"
+#include "utils/mmap_file.h"
+#include "utils/rate_limiter.h"
+#include "utils/thread_pool.h"
 
 class FileTest : public ::testing::Test {
  protected:
@@ -107,4 +116,134 @@ TEST_F(FileTest, MoveSemantics) {
 
   auto read_data = file2.ReadToSlice(0, data.size());
   EXPECT_EQ(read_data, data);
-}
\ No newline at end of file
+}
+TEST_F(FileTest, AccessHints) {
+  std::string path = "test_data/hint.data";
+  auto data = GenerateRandomData(64 * 1024);
+  File::CreateAndWrite(path, data);
+
+  MMapFile mmap_file;
+  ASSERT_TRUE(mmap_file.Open(path, false, true));
+  EXPECT_TRUE(mmap_file.Advise(AccessHint::kSequential));
+  EXPECT_TRUE(mmap_file.Advise(AccessHint::kRandom));
+  EXPECT_TRUE(mmap_file.Advise(AccessHint::kNormal));
+  // 非页对齐的范围和越界的长度都可以
+  EXPECT_TRUE(mmap_file.WillNeed(100, 10000));
+  EXPECT_TRUE(mmap_file.WillNeed(60 * 1024, 1 << 20));
+
+  // 只读打开的文件仍可正常读取
+  auto file = File::Open(path);
+  file.Advise(AccessHint::kSequential);
+  file.Prefetch(0, data.size());
+  EXPECT_EQ(file.ReadToSlice(0, data.size()), data);
+}
+
+TEST_F(FileTest, RateLimitedWrite) {
+  RateLimiterOptions options;
+  options.bytes_per_second = 1 << 20;
+  options.refill_period_us = 10 * 1000;
+  RateLimiter limiter(options);
+  auto data = GenerateRandomData(200 * 1024);
+
+  // 200KB 按 1MB/s 写出至少需要约 0.2 秒
+  auto start = std::chrono::steady_clock::now();
+  auto file = File::CreateAndWrite("test_data/limited", data, &limiter,
+                                   IOPriority::kHigh);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(150));
+  EXPECT_EQ(file.ReadToSlice(0, data.size()), data);
+  EXPECT_EQ(limiter.total_bytes_through(IOPriority::kHigh), data.size());
+  EXPECT_EQ(limiter.total_bytes_through(IOPriority::kLow), 0);
+}
+
+TEST(RateLimiterTest, HighPriorityFirst) {
+  RateLimiterOptions options;
+  options.bytes_per_second = 4 << 20;
+  options.refill_period_us = 1000;
+  RateLimiter limiter(options);
+  EXPECT_EQ(limiter.single_burst_bytes(), 4194);
+
+  // 两个线程都不停地申请，排队时总是先满足高优先级
+  std::atomic<bool> stop{false};
+  auto run = [&](IOPriority priority) {
+    while (!stop) {
+      limiter.Request(4096, priority);
+    }
+  };
+  std::thread low(run, IOPriority::kLow);
+  std::thread high(run, IOPriority::kHigh);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  stop = true;
+  high.join();
+  low.join();
+  EXPECT_GT(limiter.total_bytes_through(IOPriority::kHigh),
+            2 * limiter.total_bytes_through(IOPriority::kLow));
+
+  limiter.SetBytesPerSecond(1 << 20);
+  EXPECT_EQ(limiter.bytes_per_second(), 1 << 20);
+  EXPECT_EQ(limiter.single_burst_bytes(), 1048);
+}
+
+TEST(RateLimiterTest, AutoTune) {
+  RateLimiterOptions options;
+  options.bytes_per_second = 10 << 20;
+  options.refill_period_us = 1000;
+  options.auto_tuned = true;
+  options.target_latency_us = 1000;
+  options.tune_period_us = 5000;
+  RateLimiter limiter(options);
+  // 每次申请前记录一次前台延迟，为 0 时不记录
+  auto request_for = [&](std::chrono::milliseconds duration,
+                         uint64_t latency_us) {
+    auto deadline = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < deadline) {
+      if (latency_us > 0) {
+        limiter.RecordForegroundLatency(latency_us);
+      }
+      limiter.Request(limiter.single_burst_bytes(), IOPriority::kLow);
+    }
+  };
+
+  // 前台延迟持续高于目标时降速，最低到上限的 1/20
+  request_for(std::chrono::milliseconds(200), 5000);
+  EXPECT_EQ(limiter.bytes_per_second(), (10 << 20) / 20);
+
+  // 延迟在目标附近时保持不变
+  request_for(std::chrono::milliseconds(50), 800);
+  EXPECT_EQ(limiter.bytes_per_second(), (10 << 20) / 20);
+
+  // 没有前台读时逐步恢复到上限
+  request_for(std::chrono::milliseconds(200), 0);
+  EXPECT_EQ(limiter.bytes_per_second(), 10 << 20);
+  EXPECT_EQ(limiter.max_bytes_per_second(), 10 << 20);
+}
+
+TEST(ThreadPoolTest, SubmitAndWait) {
+  ThreadPool pool(4);
+  std::atomic<int> counter{0};
+  std::vector<std::future<int>> futures;
+  for (int i = 0; i < 100; i++) {
+    futures.push_back(pool.Submit([i, &counter] {
+      counter++;
+      return i * i;
+    }));
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(futures[i].get(), i * i);
+  }
+  EXPECT_EQ(counter, 100);
+
+  auto failed = pool.Submit([]() -> int { throw std::runtime_error("boom"); });
+  EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, DrainOnDestroy) {
+  std::atomic<int> counter{0};
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 50; i++) {
+      pool.Submit([&counter] { counter++; });
+    }
+  }
+  EXPECT_EQ(counter, 50);
+}
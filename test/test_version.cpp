@@ -0,0 +1,228 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lsm/version.h"
+
+class VersionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directory(dir_);
+  }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  static LevelFileMeta File(size_t id, std::string first, std::string last) {
+    return LevelFileMeta{id, std::move(first), std::move(last), id * 100};
+  }
+
+  const std::filesystem::path dir_ = "test_version";
+};
+
+TEST_F(VersionTest, EditEncodeDecode) {
+  VersionEdit edit;
+  edit.log_number = 7;
+  edit.next_file_number = 42;
+  edit.last_sequence = 1000;
+  edit.AddFile(0, File(3, "a", "m"));
+  auto file = File(5, "n", "z");
+  file.epoch = 9;
+  file.creation_time = 1700000000;
+  edit.AddFile(2, file);
+  edit.DeleteFile(1, 4);
+
+  VersionEdit decoded;
+  ASSERT_TRUE(VersionEdit::Decode(edit.Encode(), &decoded));
+  EXPECT_EQ(decoded.log_number, 7);
+  EXPECT_EQ(decoded.next_file_number, 42);
+  EXPECT_EQ(decoded.last_sequence, 1000);
+  ASSERT_EQ(decoded.new_files.size(), 2);
+  EXPECT_EQ(decoded.new_files[1].first, 2);
+  EXPECT_EQ(decoded.new_files[1].second.sst_id, 5);
+  EXPECT_EQ(decoded.new_files[1].second.first_key, "n");
+  EXPECT_EQ(decoded.new_files[1].second.last_key, "z");
+  EXPECT_EQ(decoded.new_files[1].second.file_size, 500);
+  EXPECT_EQ(decoded.new_files[1].second.epoch, 9);
+  EXPECT_EQ(decoded.new_files[1].second.creation_time, 1700000000);
+  ASSERT_EQ(decoded.deleted_files.size(), 1);
+  EXPECT_EQ(decoded.deleted_files[0], std::make_pair(size_t{1}, size_t{4}));
+
+  auto encoded = edit.Encode();
+  EXPECT_FALSE(VersionEdit::Decode(encoded.substr(0, encoded.size() - 1),
+                                   &decoded));
+}
+
+TEST_F(VersionTest, BuilderKeepsLevelOrder) {
+  Version base;
+  VersionBuilder builder(base);
+  VersionEdit edit;
+  edit.AddFile(0, File(1, "k", "p"));
+  edit.AddFile(0, File(2, "a", "c"));
+  edit.AddFile(1, File(3, "m", "z"));
+  edit.AddFile(1, File(4, "a", "f"));
+  builder.Apply(edit);
+  VersionEdit remove;
+  remove.DeleteFile(0, 1);
+  builder.Apply(remove);
+  auto version = builder.Finish();
+
+  // L0 保持写入顺序，L1 按 first_key 排序
+  ASSERT_EQ(version->files(0).size(), 1);
+  EXPECT_EQ(version->files(0)[0].sst_id, 2);
+  ASSERT_EQ(version->files(1).size(), 2);
+  EXPECT_EQ(version->files(1)[0].sst_id, 4);
+  EXPECT_EQ(version->files(1)[1].sst_id, 3);
+  EXPECT_EQ(version->num_files(), 3);
+  EXPECT_EQ(version->level_size(1), 700);
+}
+
+TEST_F(VersionTest, L0IntervalIndex) {
+  // 随机的重叠区间，与逐个检查的结果比较
+  std::mt19937 rng(42);
+  VersionEdit edit;
+  std::vector<LevelFileMeta> files;
+  for (size_t id = 1; id <= 200; id++) {
+    int a = static_cast<int>(rng() % 1000);
+    int b = a + static_cast<int>(rng() % 100);
+    auto file = File(id, std::format("{:04}", a), std::format("{:04}", b));
+    file.epoch = id;
+    files.push_back(file);
+    edit.AddFile(0, file);
+  }
+  VersionBuilder builder{Version()};
+  builder.Apply(edit);
+  auto version = builder.Finish();
+
+  std::vector<size_t> result;
+  for (int k = 0; k < 1100; k++) {
+    auto key = std::format("{:04}", k);
+    std::vector<size_t> expected;
+    for (auto file = files.rbegin(); file != files.rend(); ++file) {
+      if (file->first_key <= key && key <= file->last_key) {
+        expected.push_back(file->sst_id);
+      }
+    }
+    version->L0FilesContaining(key, &result);
+    std::vector<size_t> ids;
+    for (size_t idx : result) {
+      ids.push_back(version->files(0)[idx].sst_id);
+    }
+    EXPECT_EQ(ids, expected) << key;
+  }
+
+  Version empty;
+  empty.L0FilesContaining("a", &result);
+  EXPECT_TRUE(result.empty());
+}
+
+TEST_F(VersionTest, RecoverFromManifest) {
+  {
+    VersionSet versions(dir_);
+    ASSERT_TRUE(versions.Recover().ok());
+    for (int i = 0; i < 100; i++) {
+      VersionEdit edit;
+      auto id = versions.NewFileNumber();
+      edit.AddFile(0, File(id, std::format("k{:03}", i), "z"));
+      if (i % 2 == 1) {
+        edit.DeleteFile(0, id - 1);
+      }
+      edit.log_number = i;
+      ASSERT_TRUE(versions.LogAndApply(&edit).ok());
+    }
+    EXPECT_EQ(versions.current()->files(0).size(), 50);
+  }
+
+  VersionSet versions(dir_);
+  ASSERT_TRUE(versions.Recover().ok());
+  auto version = versions.current();
+  ASSERT_EQ(version->files(0).size(), 50);
+  for (size_t i = 0; i < 50; i++) {
+    EXPECT_EQ(version->files(0)[i].sst_id, i * 2 + 1);
+  }
+  EXPECT_EQ(versions.log_number(), 99);
+  EXPECT_EQ(versions.NewFileNumber(), 100);
+}
+
+TEST_F(VersionTest, TornManifestTail) {
+  {
+    VersionSet versions(dir_);
+    ASSERT_TRUE(versions.Recover().ok());
+    for (int i = 0; i < 3; i++) {
+      VersionEdit edit;
+      edit.AddFile(0, File(versions.NewFileNumber(), "a", "b"));
+      ASSERT_TRUE(versions.LogAndApply(&edit).ok());
+    }
+  }
+  auto size = std::filesystem::file_size(dir_ / "MANIFEST");
+  std::filesystem::resize_file(dir_ / "MANIFEST", size - 3);
+
+  VersionSet versions(dir_);
+  ASSERT_TRUE(versions.Recover().ok());
+  EXPECT_EQ(versions.current()->files(0).size(), 2);
+}
+
+TEST_F(VersionTest, TornTailIsTruncatedBeforeAppend) {
+  {
+    VersionSet versions(dir_);
+    ASSERT_TRUE(versions.Recover().ok());
+    for (int i = 0; i < 3; i++) {
+      VersionEdit edit;
+      edit.AddFile(0, File(versions.NewFileNumber(), "a", "b"));
+      ASSERT_TRUE(versions.LogAndApply(&edit).ok());
+    }
+  }
+  // 最后一条记录写了一半，之后是预分配的零：只丢掉最后一条 edit，
+  // 之后追加的记录仍能回放
+  auto size = std::filesystem::file_size(dir_ / "MANIFEST");
+  std::filesystem::resize_file(dir_ / "MANIFEST", size - 20);
+  std::filesystem::resize_file(dir_ / "MANIFEST", size + 64);
+  {
+    VersionSet versions(dir_);
+    ASSERT_TRUE(versions.Recover().ok());
+    EXPECT_TRUE(versions.recovered_torn_tail());
+    EXPECT_EQ(versions.current()->files(0).size(), 2);
+    VersionEdit edit;
+    edit.AddFile(0, File(versions.NewFileNumber(), "c", "d"));
+    ASSERT_TRUE(versions.LogAndApply(&edit).ok());
+  }
+  VersionSet versions(dir_);
+  ASSERT_TRUE(versions.Recover().ok());
+  EXPECT_FALSE(versions.recovered_torn_tail());
+  EXPECT_EQ(versions.current()->files(0).size(), 3);
+}
+
+TEST_F(VersionTest, CorruptManifestMiddle) {
+  {
+    VersionSet versions(dir_);
+    ASSERT_TRUE(versions.Recover().ok());
+    for (int i = 0; i < 3; i++) {
+      VersionEdit edit;
+      edit.AddFile(0, File(versions.NewFileNumber(), "a", "b"));
+      ASSERT_TRUE(versions.LogAndApply(&edit).ok());
+    }
+  }
+  // 翻转第一条记录中的一个字节，后面还有完整的记录，不能当作尾部忽略
+  std::string before;
+  {
+    std::ifstream in(dir_ / "MANIFEST", std::ios::binary);
+    before.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  std::string corrupted = before;
+  corrupted[10] ^= 0x01;
+  {
+    std::ofstream out(dir_ / "MANIFEST", std::ios::binary | std::ios::trunc);
+    out.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+  }
+
+  VersionSet versions(dir_);
+  EXPECT_TRUE(versions.Recover().IsCorruption());
+  // MANIFEST 没有被重写
+  std::ifstream in(dir_ / "MANIFEST", std::ios::binary);
+  std::string after(std::istreambuf_iterator<char>(in), {});
+  EXPECT_EQ(after, corrupted);
+}
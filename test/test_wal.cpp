@@ -0,0 +1,274 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wal/wal.h"
+
+class WalTest : public ::testing::Test {
+ protected:
+  void SetUp() override { std::filesystem::remove_all(dir_); }
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::vector<WalRecord> ReplayAll() {
+    std::vector<WalRecord> records;
+    auto status = Wal::Replay(
+        dir_, [&](const WalRecord& record) { records.push_back(record); });
+    EXPECT_TRUE(status.ok()) << status.ToString();
+    return records;
+  }
+
+  WalOptions SmallOptions() {
+    WalOptions options;
+    options.segment_size = 4096;
+    return options;
+  }
+
+  const std::filesystem::path dir_ = "test_wal";
+};
+
+TEST_F(WalTest, AppendAndReplay) {
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(1, "key1", "value1").ok());
+    ASSERT_TRUE(wal->AddPut(2, "key2", "").ok());
+    ASSERT_TRUE(wal->AddDelete(3, "key1").ok());
+  }
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), 3);
+  EXPECT_EQ(records[0].type, WalRecordType::kPut);
+  EXPECT_EQ(records[0].seq, 1);
+  EXPECT_EQ(records[0].key, "key1");
+  EXPECT_EQ(records[0].value, "value1");
+  EXPECT_EQ(records[1].value, "");
+  EXPECT_EQ(records[2].type, WalRecordType::kDelete);
+  EXPECT_EQ(records[2].key, "key1");
+}
+
+TEST_F(WalTest, SegmentRollover) {
+  std::unique_ptr<Wal> wal;
+  ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+  for (int i = 0; i < 200; i++) {
+    ASSERT_TRUE(
+        wal->AddPut(i, std::format("key{:03}", i), std::string(50, 'v')).ok());
+  }
+  EXPECT_GT(wal->num_live_segments(), 1);
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), 200);
+  for (int i = 0; i < 200; i++) {
+    EXPECT_EQ(records[i].seq, i);
+  }
+}
+
+TEST_F(WalTest, TornTailIsIgnored) {
+  std::filesystem::path segment;
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(1, "key1", "value1").ok());
+    ASSERT_TRUE(wal->AddPut(2, "key2", "value2").ok());
+    segment = dir_ / std::format("wal_{:06}.log", wal->current_log_number());
+  }
+
+  // 破坏第二条记录的最后一个字节，模拟崩溃时只写了一半
+  std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+  size_t record_size = 16 + 1 + 8 + 4 + 4 + 4 + 6;
+  file.seekp(record_size * 2 - 1);
+  file.put('x');
+  file.close();
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].key, "key1");
+
+  // 回放截掉了坏的尾部，重启后写入新 segment 不会让它变成中间的坏记录
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(3, "key3", "value3").ok());
+  }
+  records = ReplayAll();
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[1].key, "key3");
+}
+
+TEST_F(WalTest, CorruptionBeforeLastSegment) {
+  std::filesystem::path segment;
+  uint64_t log_number = 0;
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(1, "key1", "value1").ok());
+    ASSERT_TRUE(wal->AddPut(2, "key2", "value2").ok());
+    segment = dir_ / std::format("wal_{:06}.log", wal->current_log_number());
+    ASSERT_TRUE(wal->SwitchSegment(&log_number).ok());
+    ASSERT_TRUE(wal->AddPut(3, "key3", "value3").ok());
+  }
+
+  // 第一个 segment 中间的坏记录不能被当作结束，否则会跳过 key2 回放 key3
+  std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+  size_t record_size = 16 + 1 + 8 + 4 + 4 + 4 + 6;
+  file.seekp(record_size * 2 - 1);
+  file.put('x');
+  file.close();
+
+  std::vector<WalRecord> records;
+  auto status = Wal::Replay(
+      dir_, [&](const WalRecord& record) { records.push_back(record); });
+  EXPECT_TRUE(status.IsCorruption()) << status.ToString();
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].key, "key1");
+
+  // 同一个 segment 中坏记录之后还有完整记录时同样是损坏
+  std::filesystem::remove_all(dir_);
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(1, "key1", "value1").ok());
+    ASSERT_TRUE(wal->AddPut(2, "key2", "value2").ok());
+    segment = dir_ / std::format("wal_{:06}.log", wal->current_log_number());
+  }
+  file.open(segment, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(record_size - 1);
+  file.put('x');
+  file.close();
+  status = Wal::Replay(dir_, [](const WalRecord&) {});
+  EXPECT_TRUE(status.IsCorruption()) << status.ToString();
+}
+
+TEST_F(WalTest, ReleaseAndRecycle) {
+  std::unique_ptr<Wal> wal;
+  auto options = SmallOptions();
+  options.max_recycled_segments = 1;
+  ASSERT_TRUE(Wal::Open(dir_, options, &wal).ok());
+
+  ASSERT_TRUE(wal->AddPut(1, "old1", "value").ok());
+  uint64_t log_number;
+  ASSERT_TRUE(wal->SwitchSegment(&log_number).ok());
+  ASSERT_TRUE(wal->AddPut(2, "old2", "value").ok());
+  ASSERT_TRUE(wal->SwitchSegment(&log_number).ok());
+  EXPECT_EQ(wal->num_live_segments(), 3);
+
+  ASSERT_TRUE(wal->ReleaseSegmentsBefore(log_number).ok());
+  EXPECT_EQ(wal->num_live_segments(), 1);
+  EXPECT_EQ(wal->num_recycled_segments(), 1);
+  EXPECT_TRUE(ReplayAll().empty());
+
+  // 新的 segment 复用回收的文件，文件中的旧记录不会被回放
+  ASSERT_TRUE(wal->AddPut(3, "new", "value").ok());
+  ASSERT_TRUE(wal->SwitchSegment(&log_number).ok());
+  EXPECT_EQ(wal->num_recycled_segments(), 0);
+  ASSERT_TRUE(wal->AddPut(4, "n", "v").ok());
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].key, "new");
+  EXPECT_EQ(records[1].key, "n");
+}
+
+TEST_F(WalTest, ReopenKeepsUnreleasedSegments) {
+  {
+    std::unique_ptr<Wal> wal;
+    ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+    ASSERT_TRUE(wal->AddPut(1, "key1", "value1").ok());
+  }
+  std::unique_ptr<Wal> wal;
+  ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+  EXPECT_EQ(wal->num_live_segments(), 2);
+  ASSERT_TRUE(wal->AddPut(2, "key2", "value2").ok());
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].key, "key1");
+  EXPECT_EQ(records[1].key, "key2");
+}
+
+TEST_F(WalTest, GroupCommit) {
+  std::unique_ptr<Wal> wal;
+  WalOptions options;
+  options.sync_mode = WalSyncMode::kEveryWrite;
+  ASSERT_TRUE(Wal::Open(dir_, options, &wal).ok());
+
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; i++) {
+        auto status = wal->AddPut(t * kPerThread + i,
+                                  std::format("key{}_{}", t, i), "value");
+        EXPECT_TRUE(status.ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(wal->num_batches(), kThreads * kPerThread);
+
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), kThreads * kPerThread);
+  // 同一个线程的写入保持提交顺序
+  std::vector<int> next(kThreads, 0);
+  for (const auto& record : records) {
+    int t = record.seq / kPerThread;
+    EXPECT_EQ(record.seq % kPerThread, next[t]++);
+  }
+}
+
+TEST_F(WalTest, OrderedApply) {
+  std::unique_ptr<Wal> wal;
+  ASSERT_TRUE(Wal::Open(dir_, SmallOptions(), &wal).ok());
+
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 200;
+  std::atomic<uint64_t> next_seq{1};
+  std::vector<uint64_t> applied;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; i++) {
+        // apply 由 leader 串行调用，不需要额外加锁
+        auto status = wal->AddOrdered(
+            WalRecordType::kPut, std::format("key{}_{}", t, i), "value",
+            [&] { return next_seq++; },
+            [&](uint64_t seq) { applied.push_back(seq); });
+        EXPECT_TRUE(status.ok());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // apply 的顺序、seq 的顺序和回放的顺序一致
+  auto records = ReplayAll();
+  ASSERT_EQ(records.size(), kThreads * kPerThread);
+  ASSERT_EQ(applied.size(), records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(records[i].seq, i + 1);
+    EXPECT_EQ(applied[i], i + 1);
+  }
+}
+
+TEST_F(WalTest, IntervalSync) {
+  std::unique_ptr<Wal> wal;
+  WalOptions options;
+  options.sync_mode = WalSyncMode::kInterval;
+  options.sync_interval_ms = 5;
+  ASSERT_TRUE(Wal::Open(dir_, options, &wal).ok());
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(wal->AddPut(i, std::format("key{}", i), "value").ok());
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  wal.reset();
+  EXPECT_EQ(ReplayAll().size(), 100);
+}
@@ -5,10 +5,16 @@ set_languages("c++20")
 add_rules("mode.debug", "mode.release")
 add_requires("gtest")
 
+target("iterator")
+    set_kind("static")
+    add_files("src/iterator/*.cpp")
+    add_includedirs("include", {public = true})
+
 target("utils")
     set_kind("static")
     add_files("src/utils/*.cpp")
     add_includedirs("include", {public = true})
+    add_syslinks("pthread", {public = true})
 
 target("skiplist")
     set_kind("static")
@@ -18,12 +24,14 @@ target("skiplist")
 target("memtable")
     set_kind("static")
     add_deps("skiplist")
+    add_deps("iterator")
     add_files("src/memtable/*.cpp")
     add_includedirs("include", {public = true})
 
 target("block")
     set_kind("static")
     -- add_deps("skiplist")
+    add_deps("iterator")
     add_files("src/block/*.cpp")
     add_includedirs("include", {public = true})
 
@@ -34,6 +42,20 @@ target("sst")
     add_files("src/sst/*.cpp")
     add_includedirs("include", {public = true})
 
+target("wal")
+    set_kind("static")
+    add_files("src/wal/*.cpp")
+    add_includedirs("include", {public = true})
+    add_syslinks("pthread", {public = true})
+
+target("lsm")
+    set_kind("static")
+    add_deps("memtable")
+    add_deps("sst")
+    add_deps("wal")
+    add_files("src/lsm/*.cpp")
+    add_includedirs("include", {public = true})
+
 target("test_skiplist")
     set_kind("binary")
     set_group("tests")
@@ -74,4 +96,40 @@ target("test_sst")
     set_group("tests")
     add_files("test/test_sst.cpp")
     add_deps("sst")
-    add_packages("gtest")
\ No newline at end of file
+    add_packages("gtest")
+
+target("test_engine")
+    set_kind("binary")
+    set_group("tests")
+    add_files("test/test_engine.cpp")
+    add_deps("lsm")
+    add_packages("gtest")
+
+target("test_version")
+    set_kind("binary")
+    set_group("tests")
+    add_files("test/test_version.cpp")
+    add_deps("lsm")
+    add_packages("gtest")
+
+target("test_compaction")
+    set_kind("binary")
+    set_group("tests")
+    add_files("test/test_compaction.cpp")
+    add_deps("lsm")
+    add_packages("gtest")
+
+target("test_wal")
+    set_kind("binary")
+    set_group("tests")
+    add_files("test/test_wal.cpp")
+    add_deps("wal")
+    add_packages("gtest")
+
+target("test_iterator")
+    set_kind("binary")
+    set_group("tests")
+    add_files("test/test_iterator.cpp")
+    add_deps("memtable")
+    add_deps("block")
+    add_packages("gtest")